@@ -0,0 +1,139 @@
+// benchmark/chunked_benchmark.cc
+// Throughput of decoding a large chunked body, 1 GiB of 4 KiB chunks by
+// default, streamed to the parser 64 KiB a read as from the socket.
+// The content is counted and dropped instead of being kept, so that only the
+// decoding is measured.
+// Usage: chunked_benchmark [size (MiB)] [chunk size (bytes)] [read size (KiB)]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "webcc/request.h"
+#include "webcc/message_parser.h"
+
+// Count the content without keeping it.
+class CountBodyHandler : public webcc::BodyHandler {
+public:
+  explicit CountBodyHandler(webcc::Message* message)
+      : webcc::BodyHandler(message) {
+  }
+
+  void AddContent(const char* data, std::size_t length) override {
+    count_ += length;
+  }
+
+  void AddContent(const std::string& data) override {
+    count_ += data.size();
+  }
+
+  std::size_t GetContentLength() const override {
+    return count_;
+  }
+
+  bool Finish() override {
+    return true;
+  }
+
+private:
+  std::size_t count_ = 0;
+};
+
+class ChunkedParser : public webcc::MessageParser {
+public:
+  std::size_t GetContentLength() const {
+    return body_handler_->GetContentLength();
+  }
+
+private:
+  bool OnHeadersEnd() override {
+    return true;
+  }
+
+  bool ParseStartLine(std::string_view line) override {
+    return true;
+  }
+
+  void CreateBodyHandler() override {
+    body_handler_.reset(new CountBodyHandler{ message_ });
+  }
+};
+
+int main(int argc, const char* argv[]) {
+  std::size_t size = 1024;  // MiB
+  std::size_t chunk_size = 4096;
+  std::size_t read_size = 64;  // KiB
+  if (argc > 1) {
+    size = std::stoul(argv[1]);
+  }
+  if (argc > 2) {
+    chunk_size = std::stoul(argv[2]);
+  }
+  if (argc > 3) {
+    read_size = std::stoul(argv[3]);
+  }
+  size *= 1024 * 1024;
+  read_size *= 1024;
+
+  // A run of chunks, repeated until the size.
+  const std::size_t kChunks = 64;
+  char chunk_size_line[32];
+  std::snprintf(chunk_size_line, sizeof(chunk_size_line), "%zx\r\n",
+                chunk_size);
+  std::string run;
+  for (std::size_t i = 0; i < kChunks; ++i) {
+    run.append(chunk_size_line);
+    run.append(chunk_size, static_cast<char>('a' + i % 26));
+    run.append("\r\n");
+  }
+  const std::size_t runs = std::max<std::size_t>(size / (chunk_size * kChunks),
+                                                 1);
+
+  // The run repeated, so that a read across the end of a run is contiguous.
+  std::string runs2 = run;
+  while (runs2.size() < run.size() + read_size) {
+    runs2.append(run);
+  }
+
+  const std::string headers =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  const std::string last_chunk = "0\r\n\r\n";
+
+  webcc::Request request;
+  ChunkedParser parser;
+  parser.Init(&request);
+
+  auto start = std::chrono::steady_clock::now();
+
+  bool ok = parser.Parse(headers.data(), headers.size());
+
+  const std::size_t total = run.size() * runs;
+  for (std::size_t off = 0; off < total && ok; off += read_size) {
+    std::size_t length = std::min(read_size, total - off);
+    ok = parser.Parse(runs2.data() + off % run.size(), length);
+  }
+
+  ok = ok && parser.Parse(last_chunk.data(), last_chunk.size());
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const std::size_t content_length = chunk_size * kChunks * runs;
+
+  if (!ok || !parser.finished() ||
+      parser.GetContentLength() != content_length) {
+    std::printf("Failed to parse\n");
+    return 1;
+  }
+
+  const double mib = static_cast<double>(content_length) / (1024 * 1024);
+  std::printf("Content: %.0f MiB, chunk size: %zu, read size: %zu\n", mib,
+              chunk_size, read_size);
+  std::printf("Decoding: %.2f s, %.0f MiB/s\n", elapsed.count(),
+              mib / elapsed.count());
+
+  return 0;
+}
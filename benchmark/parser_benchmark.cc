@@ -0,0 +1,190 @@
+// benchmark/parser_benchmark.cc
+// Throughput of the scanning for the delimiters with the scalar code, SSE2 and
+// AVX2 (up to the one supported by the CPU):
+// - Find CRLF in a large body with long lines, e.g., a text file uploaded.
+// - Parse realistic request header blocks (the end of the headers, the lines).
+// - Parse a large chunked body and a large multipart body.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "webcc/internal/scan.h"
+#include "webcc/request.h"
+#include "webcc/request_parser.h"
+
+using webcc::internal::ScanLevel;
+
+static const webcc::RouteInfo* ViewMatcher(const std::string& method,
+                                           const std::string& url_path,
+                                           webcc::UrlArgs* args) {
+  return nullptr;
+}
+
+template <typename Func>
+static double Seconds(Func&& func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Text of random lines, 60 to 200 chars each.
+static std::string MakeText(std::size_t size) {
+  std::mt19937 rg{ 1234 };
+  std::uniform_int_distribution<int> line_size{ 60, 200 };
+  std::uniform_int_distribution<int> letter{ 'a', 'z' };
+
+  std::string text;
+  text.reserve(size + 256);
+  while (text.size() < size) {
+    for (int n = line_size(rg); n > 0; --n) {
+      text.push_back(static_cast<char>(letter(rg)));
+    }
+    text.append("\r\n");
+  }
+  return text;
+}
+
+// Headers sent by a browser.
+static const char kHeaderBlock[] =
+    "GET /api/v1/books?sort=title&page=2 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,"
+    "image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/books/index.html\r\n"
+    "Cookie: session=4f1c8a2be0d94b7e9a6c3d5f2e1b0a98; theme=dark; "
+    "_ga=GA1.2.1234567890.1700000000\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+// Parse the data read `read_size` bytes at a time.
+static bool Parse(webcc::RequestParser& parser, webcc::Request& request,
+                  const std::string& data, std::size_t read_size) {
+  parser.Init(&request, ViewMatcher);
+  for (std::size_t off = 0; off < data.size(); off += read_size) {
+    std::size_t length = std::min(read_size, data.size() - off);
+    if (!parser.Parse(data.data() + off, length)) {
+      return false;
+    }
+  }
+  return parser.finished();
+}
+
+int main(int argc, const char* argv[]) {
+  // The size of the bodies in MiB.
+  std::size_t size = 16;
+  if (argc > 1) {
+    size = std::stoul(argv[1]);
+  }
+  size *= 1024 * 1024;
+
+  const std::size_t kReadSize = 64 * 1024;
+  const std::size_t kRequests = 200000;
+
+  const std::string text = MakeText(size);
+
+  std::string chunked =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n";
+  for (std::size_t off = 0; off < text.size(); off += 8192) {
+    std::size_t length = std::min<std::size_t>(8192, text.size() - off);
+    char chunk_size[32];
+    std::snprintf(chunk_size, sizeof(chunk_size), "%zx\r\n", length);
+    chunked.append(chunk_size);
+    chunked.append(text, off, length);
+    chunked.append("\r\n");
+  }
+  chunked.append("0\r\n\r\n");
+
+  const std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+  std::string form_data;
+  form_data.append("--" + boundary + "\r\n");
+  form_data.append(
+      "Content-Disposition: form-data; name=\"file\"; "
+      "filename=\"book.txt\"\r\n"
+      "Content-Type: text/plain\r\n\r\n");
+  form_data.append(text);
+  form_data.append("\r\n--" + boundary + "--\r\n");
+
+  std::string multipart =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Type: multipart/form-data; boundary=" + boundary + "\r\n"
+      "Content-Length: " + std::to_string(form_data.size()) + "\r\n\r\n";
+  multipart.append(form_data);
+
+  const double mib = static_cast<double>(text.size()) / (1024 * 1024);
+
+  std::printf("Body: %.1f MiB, headers: %zu bytes, read size: %zu\n", mib,
+              sizeof(kHeaderBlock) - 1, kReadSize);
+  std::printf("Default: %s, supported: %s\n",
+              webcc::internal::GetScanLevelName(
+                  webcc::internal::GetScanLevel()),
+              webcc::internal::GetScanLevelName(
+                  webcc::internal::GetSupportedScanLevel()));
+  std::printf("%8s %16s %16s %16s %18s\n", "level", "find (MiB/s)",
+              "headers (/s)", "chunked (MiB/s)", "multipart (MiB/s)");
+
+  for (ScanLevel level :
+       { ScanLevel::kScalar, ScanLevel::kSse2, ScanLevel::kAvx2 }) {
+    webcc::internal::SetScanLevel(level);
+    if (webcc::internal::GetScanLevel() != level) {
+      break;  // Not supported
+    }
+
+    std::size_t lines = 0;
+    double find_seconds = Seconds([&text, &lines]() {
+      for (std::size_t pos = webcc::internal::FindCRLF(text);
+           pos != std::string::npos;
+           pos = webcc::internal::FindCRLF(text, pos + 2)) {
+        ++lines;
+      }
+    });
+
+    const std::string headers{ kHeaderBlock };
+    bool ok = true;
+    double headers_seconds = Seconds([&headers, &ok, kRequests]() {
+      // The request is reused as by a keep-alive connection.
+      webcc::RequestParser parser;
+      webcc::Request request;
+      for (std::size_t i = 0; i < kRequests && ok; ++i) {
+        request.Clear();
+        ok = Parse(parser, request, headers, headers.size());
+      }
+    });
+
+    double chunked_seconds = Seconds([&chunked, &ok, kReadSize]() {
+      webcc::RequestParser parser;
+      webcc::Request request;
+      ok = ok && Parse(parser, request, chunked, kReadSize);
+    });
+
+    double multipart_seconds = Seconds([&multipart, &ok, kReadSize]() {
+      webcc::RequestParser parser;
+      webcc::Request request;
+      ok = ok && Parse(parser, request, multipart, kReadSize);
+    });
+
+    if (!ok) {
+      std::printf("Failed to parse\n");
+      return 1;
+    }
+
+    std::printf("%8s %16.0f %16.0f %16.0f %18.0f\n",
+                webcc::internal::GetScanLevelName(level),
+                mib / find_seconds, kRequests / headers_seconds,
+                mib / chunked_seconds, mib / multipart_seconds);
+  }
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+// benchmark/queue_benchmark.cc
+// Throughput of Queue (std::list + mutex + condition variable) vs. RingQueue
+// (lock-free ring buffer) with 1, 4, 16 and 64 producers and consumers.
+// The messages are shared pointers, like the connections in the server.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "webcc/queue.h"
+#include "webcc/ring_queue.h"
+
+using Message = std::shared_ptr<int>;
+
+// Push `count` messages in total by `threads` producers while `threads`
+// consumers pop them.
+// Return the number of messages per second.
+template <typename QueueType>
+static double Measure(QueueType& queue, std::size_t threads,
+                      std::size_t count) {
+  auto message = std::make_shared<int>(0);
+
+  std::atomic_size_t popped = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> consumers;
+  for (std::size_t i = 0; i < threads; ++i) {
+    consumers.emplace_back([&queue, &popped]() {
+      std::size_t n = 0;
+      while (queue.PopOrWait() != nullptr) {
+        ++n;
+      }
+      popped += n;
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (std::size_t i = 0; i < threads; ++i) {
+    producers.emplace_back([&queue, &message, threads, count]() {
+      for (std::size_t n = count / threads; n > 0; --n) {
+        queue.Push(message);
+      }
+    });
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  // A null message stops a consumer.
+  for (std::size_t i = 0; i < threads; ++i) {
+    queue.Push({});
+  }
+
+  for (auto& t : consumers) {
+    t.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  return popped / elapsed.count();
+}
+
+int main(int argc, const char* argv[]) {
+  std::size_t count = 1000000;
+  if (argc > 1) {
+    count = std::stoul(argv[1]);
+  }
+
+  std::printf("Messages: %zu\n", count);
+  std::printf("%8s %16s %16s %8s\n", "threads", "Queue (msg/s)",
+              "RingQueue (msg/s)", "ratio");
+
+  for (std::size_t threads : { 1, 4, 16, 64 }) {
+    webcc::Queue<Message> queue;
+    double queue_rate = Measure(queue, threads, count);
+
+    webcc::RingQueue<Message> ring_queue{ 4096 };
+    double ring_queue_rate = Measure(ring_queue, threads, count);
+
+    std::printf("%8zu %16.0f %16.0f %8.2f\n", threads, queue_rate,
+                ring_queue_rate, ring_queue_rate / queue_rate);
+  }
+
+  return 0;
+}
@@ -0,0 +1,212 @@
+// benchmark/server_benchmark.cc
+// Loopback throughput of the server with 1 to N loops, in the normal or the
+// sharded mode.
+// In the normal mode, `loops` threads run the same io_context and `loops`
+// workers share the same queue. In the sharded mode, each of the `loops`
+// shards has its own io_context, acceptor and queue, and one worker.
+// With `inline`, the view is non-blocking and handled in the loop threads
+// without going through the queue and the workers.
+// With a pipeline depth larger than 1, each client sends that many requests at
+// once before reading the responses (HTTP/1.1 pipelining).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/write.hpp"
+
+#include "webcc/response.h"
+#include "webcc/response_builder.h"
+#include "webcc/response_parser.h"
+#include "webcc/server.h"
+
+using tcp = boost::asio::ip::tcp;
+
+constexpr std::uint16_t kPort = 8080;
+
+class HelloView : public webcc::View {
+public:
+  explicit HelloView(bool non_blocking) : non_blocking_(non_blocking) {
+  }
+
+  webcc::ResponsePtr Handle(webcc::RequestPtr request) override {
+    return webcc::ResponseBuilder{}.OK().Body("Hello, World!")();
+  }
+
+  bool NonBlocking(const std::string& method) override {
+    return non_blocking_;
+  }
+
+private:
+  bool non_blocking_;
+};
+
+struct Result {
+  double rps = 0;          // Requests per second
+  double p50_latency = 0;  // Median latency in microseconds
+};
+
+// A keep-alive client sending `depth` requests at a time until `stop`.
+// Save the latency (in microseconds) of each request to `latencies`.
+static void ClientRoutine(const std::atomic_bool* stop, std::size_t depth,
+                          std::vector<double>* latencies) {
+  static const std::string kRequest =
+      "GET / HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Connection: Keep-Alive\r\n\r\n";
+
+  std::string requests;
+  for (std::size_t i = 0; i < depth; ++i) {
+    requests += kRequest;
+  }
+
+  try {
+    boost::asio::io_context io_context;
+    tcp::socket socket{ io_context };
+    socket.connect({ boost::asio::ip::make_address("127.0.0.1"), kPort });
+    socket.set_option(tcp::no_delay(true));
+
+    std::vector<char> buffer(webcc::kBufferSize);
+
+    while (!*stop) {
+      auto start = std::chrono::steady_clock::now();
+
+      boost::asio::write(socket, boost::asio::buffer(requests));
+
+      // The data read but not parsed yet.
+      std::size_t offset = 0;
+      std::size_t length = 0;
+
+      for (std::size_t i = 0; i < depth; ++i) {
+        webcc::Response response;
+        webcc::ResponseParser parser;
+        parser.Init(&response);
+
+        while (!parser.finished()) {
+          if (length == 0) {
+            offset = 0;
+            length = socket.read_some(boost::asio::buffer(buffer));
+          }
+          if (!parser.Parse(buffer.data() + offset, length)) {
+            std::cerr << "Invalid response" << std::endl;
+            return;
+          }
+          offset += parser.consumed();
+          length -= parser.consumed();
+        }
+
+        std::chrono::duration<double, std::micro> latency =
+            std::chrono::steady_clock::now() - start;
+        latencies->push_back(latency.count());
+      }
+    }
+
+  } catch (const std::exception& e) {
+    std::cerr << "Client error: " << e.what() << std::endl;
+  }
+}
+
+// Run the server and the clients for some seconds.
+static Result Measure(std::size_t loops, bool sharded, bool non_blocking,
+                      std::size_t clients, std::size_t depth, int seconds) {
+  webcc::Server server{ tcp::v4(), kPort };
+  server.set_sharded(sharded);
+  server.Route("/", std::make_shared<HelloView>(non_blocking));
+
+  std::size_t workers = sharded ? 1 : loops;
+
+  std::thread server_thread{ [&server, workers, loops]() {
+    server.Run(workers, loops);
+  } };
+
+  // Wait for the server to listen.
+  while (!server.IsRunning()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  std::atomic_bool stop = false;
+  std::vector<std::vector<double>> latencies(clients);
+
+  std::vector<std::thread> client_threads;
+  for (std::size_t i = 0; i < clients; ++i) {
+    client_threads.emplace_back(ClientRoutine, &stop, depth, &latencies[i]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+
+  for (auto& t : client_threads) {
+    t.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  server.Stop();
+  server_thread.join();
+
+  std::vector<double> all;
+  for (auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+
+  Result result;
+  if (!all.empty()) {
+    auto mid = all.begin() + all.size() / 2;
+    std::nth_element(all.begin(), mid, all.end());
+    result.rps = all.size() / elapsed.count();
+    result.p50_latency = *mid;
+  }
+  return result;
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "Usage: server_benchmark <max_loops> [clients] [seconds] "
+                 "[normal|sharded] [inline] [depth]"
+              << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  $ server_benchmark 8 64 5 sharded" << std::endl;
+    std::cout << "  $ server_benchmark 8 64 5 sharded inline 16" << std::endl;
+    return 1;
+  }
+
+  // NOTE: The logger is not initialized to keep the output clean.
+
+  std::size_t max_loops = std::stoul(argv[1]);
+  std::size_t clients = argc > 2 ? std::stoul(argv[2]) : 64;
+  int seconds = argc > 3 ? std::stoi(argv[3]) : 5;
+  bool sharded = argc > 4 ? std::string{ argv[4] } == "sharded" : true;
+  bool non_blocking = argc > 5 && std::string{ argv[5] } == "inline";
+  std::size_t depth = argc > 6 ? std::max(std::stoul(argv[6]), 1ul) : 1;
+
+  std::printf("Mode: %s%s, clients: %zu, depth: %zu, seconds: %d\n",
+              sharded ? "sharded" : "normal", non_blocking ? " inline" : "",
+              clients, depth, seconds);
+  std::printf("%8s %14s %10s %14s\n", "loops", "requests/s", "speedup",
+              "p50 (us)");
+
+  double base = 0;
+
+  for (std::size_t loops = 1; loops <= max_loops; ++loops) {
+    Result result =
+        Measure(loops, sharded, non_blocking, clients, depth, seconds);
+    if (loops == 1) {
+      base = result.rps;
+    }
+    std::printf("%8zu %14.1f %10.2f %14.1f\n", loops, result.rps,
+                base > 0 ? result.rps / base : 0, result.p50_latency);
+  }
+
+  return 0;
+}
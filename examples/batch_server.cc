@@ -0,0 +1,109 @@
+// examples/batch_server.cc
+// A server which hands the requests over to a batch processor running in its
+// own thread. The view defers the responses and the batch processor completes
+// them, the worker is released right away.
+// Try:
+//   $ for i in $(seq 20); do curl http://localhost:8080/ & done
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "webcc/logger.h"
+#include "webcc/response_builder.h"
+#include "webcc/server.h"
+
+// Process the pending requests in batches, at most every 10 milliseconds.
+class Batcher {
+public:
+  Batcher() : thread_(&Batcher::Routine, this) {
+  }
+
+  ~Batcher() {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      stopped_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  void Add(webcc::RequestPtr request, webcc::ResponseCallback callback) {
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      pending_.push_back({ request, std::move(callback) });
+    }
+    cv_.notify_one();
+  }
+
+private:
+  struct Item {
+    webcc::RequestPtr request;
+    webcc::ResponseCallback callback;
+  };
+
+  void Routine() {
+    while (true) {
+      std::vector<Item> batch;
+      {
+        std::unique_lock<std::mutex> lock{ mutex_ };
+        cv_.wait(lock, [this] { return stopped_ || !pending_.empty(); });
+        if (stopped_) {
+          break;
+        }
+        batch.swap(pending_);
+      }
+
+      LOG_USER("Process a batch of %u requests", (unsigned)batch.size());
+
+      std::string body = "Batch size: " + std::to_string(batch.size());
+      for (auto& item : batch) {
+        // Complete the deferred response from this thread.
+        item.callback(webcc::ResponseBuilder{}.OK().Body(body)());
+      }
+
+      // Let more requests be pending for the next batch.
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Item> pending_;
+  bool stopped_ = false;
+  std::thread thread_;
+};
+
+class BatchView : public webcc::DeferredView {
+public:
+  explicit BatchView(Batcher* batcher) : batcher_(batcher) {
+  }
+
+  void AsyncHandle(webcc::RequestPtr request,
+                   webcc::ResponseCallback callback) override {
+    batcher_->Add(request, std::move(callback));
+  }
+
+private:
+  Batcher* batcher_;
+};
+
+int main(int argc, const char* argv[]) {
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  try {
+    Batcher batcher;
+
+    webcc::Server server{ boost::asio::ip::tcp::v4(), 8080 };
+
+    server.Route("/", std::make_shared<BatchView>(&batcher));
+
+    server.Run();
+
+  } catch (const std::exception&) {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,52 @@
+// examples/coroutine_server.cc
+// A server with a coroutine view which waits for a "slow upstream service"
+// (simulated by a timer) before it responds. Thousands of such requests can be
+// in flight with only one loop and no workers busy.
+// Build with -DWEBCC_ENABLE_COROUTINE=1 (C++20).
+// Try:
+//   $ curl http://localhost:8080/sleep/2
+
+#include "boost/asio/steady_timer.hpp"
+#include "boost/asio/this_coro.hpp"
+#include "boost/asio/use_awaitable.hpp"
+
+#include "webcc/coroutine_view.h"
+#include "webcc/logger.h"
+#include "webcc/response_builder.h"
+#include "webcc/server.h"
+
+class SleepView : public webcc::CoroutineView {
+public:
+  boost::asio::awaitable<webcc::ResponsePtr> AsyncHandle(
+      webcc::RequestPtr request) override {
+    int seconds = 0;
+    if (request->args().size() == 1) {
+      seconds = std::stoi(request->args()[0]);
+    }
+
+    auto executor = co_await boost::asio::this_coro::executor;
+
+    // Don't sleep the thread, suspend the coroutine instead.
+    boost::asio::steady_timer timer{ executor, std::chrono::seconds(seconds) };
+    co_await timer.async_wait(boost::asio::use_awaitable);
+
+    co_return webcc::ResponseBuilder{}.OK().Body("Hello, World!")();
+  }
+};
+
+int main(int argc, const char* argv[]) {
+  WEBCC_LOG_INIT("", webcc::LOG_CONSOLE);
+
+  try {
+    webcc::Server server{ boost::asio::ip::tcp::v4(), 8080 };
+
+    server.Route(webcc::R{ "/sleep/(\\d+)" }, std::make_shared<SleepView>());
+
+    server.Run();
+
+  } catch (const std::exception&) {
+    return 1;
+  }
+
+  return 0;
+}
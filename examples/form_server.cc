@@ -5,6 +5,7 @@
 #include <iostream>
 #include <string>
 
+#include "webcc/body.h"
 #include "webcc/logger.h"
 #include "webcc/response_builder.h"
 #include "webcc/server.h"
@@ -28,11 +29,11 @@ private:
     for (auto& part : request->form_parts()) {
       std::cout << "name: " << part->name() << std::endl;
 
-      if (part->file_name().empty()) {
-        std::cout << "data: " << part->data() << std::endl;
+      if (part->file_body()) {
+        // Move the streamed temp file to the current directory.
+        part->file_body()->Move(part->file_name());
       } else {
-        // Save part->data() to the current directory.
-        webcc::utility::WriteFile(part->file_name(), part->data());
+        std::cout << "data: " << part->data() << std::endl;
       }
     }
 
@@ -1,6 +1,12 @@
 #include "gtest/gtest.h"
 
+#include <fstream>
+
+#include "boost/asio/system_executor.hpp"
+
 #include "webcc/body.h"
+#include "webcc/event_stream.h"
+#include "webcc/utility.h"
 
 TEST(FormBodyTest, Payload) {
   std::vector<webcc::FormPartPtr> parts{
@@ -17,3 +23,118 @@ TEST(FormBodyTest, Payload) {
   payload = form_body.NextPayload();
   EXPECT_TRUE(payload.empty());
 }
+
+// -----------------------------------------------------------------------------
+
+static std::string ToString(const webcc::Payload& payload) {
+  std::string str;
+  for (const auto& buffer : payload) {
+    str.append(static_cast<const char*>(buffer.data()), buffer.size());
+  }
+  return str;
+}
+
+// The file is read piece by piece as the payload is being sent.
+TEST(FormBodyTest, PayloadFile) {
+  const std::string file_data(webcc::kFileChunkSize * 2 + 100, 'x');
+
+  std::ofstream ofstream;
+  webcc::sfs::path path;
+  ASSERT_TRUE(webcc::utility::OpenTempFile(&ofstream, &path));
+  ofstream << file_data;
+  ofstream.close();
+
+  std::vector<webcc::FormPartPtr> parts{
+    webcc::FormPart::New("json", "{}", "application/json"),
+    webcc::FormPart::NewFile("file", path, "text/plain"),
+  };
+
+  webcc::FormBody form_body{ parts, "123456" };
+  const std::size_t size = form_body.GetSize();
+
+  form_body.InitPayload();
+
+  std::string data;
+  std::size_t count = 0;
+  while (true) {
+    webcc::Payload payload = form_body.NextPayload(true);
+    if (payload.empty()) {
+      break;
+    }
+    for (const auto& buffer : payload) {
+      EXPECT_LE(buffer.size(), webcc::kFileChunkSize);
+    }
+    data += ToString(payload);
+    ++count;
+  }
+
+  // The json part, the file part headers, 3 pieces of the file, and the end.
+  EXPECT_EQ(6, count);
+  EXPECT_EQ(size, data.size());
+
+  const std::string file_headers =
+      "Content-Disposition: form-data; name=\"file\"; filename*=UTF-8''" +
+      path.filename().string() +
+      "\r\n"
+      "Content-Type: text/plain\r\n\r\n";
+
+  const std::string expected =
+      "--123456\r\n"
+      "Content-Disposition: form-data; name=\"json\"\r\n"
+      "Content-Type: application/json\r\n\r\n"
+      "{}\r\n"
+      "--123456\r\n" +
+      file_headers + file_data +
+      "\r\n"
+      "--123456--\r\n";
+  EXPECT_EQ(expected, data);
+
+  webcc::sfs::remove(path);
+}
+
+TEST(EventStreamBodyTest, Payload) {
+  auto events = std::make_shared<webcc::EventStream>(0);
+
+  webcc::EventStreamBody body{ events };
+  body.set_chunked(true);
+  body.InitPayload();
+
+  // Nothing for now.
+  EXPECT_TRUE(body.NextPayload().empty());
+
+  bool notified = false;
+  EXPECT_TRUE(body.WaitPayload(boost::asio::system_executor{},
+                               [&notified]() { notified = true; }));
+  EXPECT_FALSE(notified);
+
+  EXPECT_TRUE(events->Send("a\nb", "tick", "1"));
+  EXPECT_TRUE(notified);
+
+  const std::string event = "id: 1\nevent: tick\ndata: a\ndata: b\n\n";
+  EXPECT_EQ("23\r\n" + event + "\r\n", ToString(body.NextPayload()));
+
+  events->Close();
+  EXPECT_FALSE(events->Send("c"));
+
+  EXPECT_EQ("0\r\n\r\n", ToString(body.NextPayload()));
+  EXPECT_TRUE(body.NextPayload().empty());
+  EXPECT_FALSE(body.WaitPayload(boost::asio::system_executor{}, {}));
+}
+
+TEST(EventStreamBodyTest, LineBreaks) {
+  auto events = std::make_shared<webcc::EventStream>(0);
+
+  webcc::EventStreamBody body{ events };
+  body.InitPayload();
+
+  // No field or event could be injected by the event or the id.
+  EXPECT_FALSE(events->Send("a", "tick\ndata: x"));
+  EXPECT_FALSE(events->Send("a", "tick", "1\r"));
+  EXPECT_TRUE(body.NextPayload().empty());
+  EXPECT_FALSE(events->closed());
+
+  // The data is split by CRLF, LF and CR.
+  EXPECT_TRUE(events->Send("a\r\nb\nc\rid: 2\r"));
+  EXPECT_EQ("data: a\ndata: b\ndata: c\ndata: id: 2\ndata: \n\n",
+            ToString(body.NextPayload()));
+}
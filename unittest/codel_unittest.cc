@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+
+#include "webcc/codel.h"
+
+using Clock = webcc::Codel::Clock;
+using ms = boost::asio::chrono::milliseconds;
+
+// Feed the requests with the given delay, one per millisecond, for the given
+// milliseconds. Return the number of the requests dropped.
+static int Feed(webcc::Codel* codel, Clock::time_point* now, ms delay,
+                int duration) {
+  int dropped = 0;
+  for (int i = 0; i < duration; ++i) {
+    if (codel->Overloaded(delay, *now)) {
+      ++dropped;
+    }
+    *now += ms(1);
+  }
+  return dropped;
+}
+
+TEST(CodelTest, BelowTarget) {
+  webcc::Codel codel{ 5, 100 };
+  auto now = Clock::now();
+
+  EXPECT_EQ(0, Feed(&codel, &now, ms(1), 1000));
+}
+
+TEST(CodelTest, Overloaded) {
+  webcc::Codel codel{ 5, 100 };
+  auto now = Clock::now();
+
+  // A standing queue: the requests are dropped after an interval or two.
+  int dropped = Feed(&codel, &now, ms(20), 300);
+  EXPECT_GT(dropped, 0);
+  EXPECT_LT(dropped, 300);
+
+  // Keep dropping while overloaded, except the first request of the interval.
+  EXPECT_EQ(99, Feed(&codel, &now, ms(20), 100));
+
+  // Never drop the requests waited less than twice the target.
+  EXPECT_EQ(0, Feed(&codel, &now, ms(8), 100));
+}
+
+TEST(CodelTest, Recover) {
+  webcc::Codel codel{ 5, 100 };
+  auto now = Clock::now();
+
+  Feed(&codel, &now, ms(20), 300);
+
+  // The minimum delay goes down below the target.
+  Feed(&codel, &now, ms(1), 200);
+
+  // Not overloaded any more.
+  EXPECT_EQ(0, Feed(&codel, &now, ms(20), 50));
+}
+
+TEST(CodelTest, Burst) {
+  webcc::Codel codel{ 5, 100 };
+  auto now = Clock::now();
+
+  // A burst: the delays go up but the minimum of each interval stays low.
+  int dropped = 0;
+  for (int i = 0; i < 10; ++i) {
+    dropped += Feed(&codel, &now, ms(1), 50);
+    dropped += Feed(&codel, &now, ms(20), 50);
+  }
+  EXPECT_EQ(0, dropped);
+}
@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+
+#include "webcc/common.h"
+
+TEST(HeaderIdTest, GetHeaderId) {
+  EXPECT_EQ(webcc::HeaderId::kHost, webcc::GetHeaderId("Host"));
+  EXPECT_EQ(webcc::HeaderId::kContentLength,
+            webcc::GetHeaderId("content-LENGTH"));
+  EXPECT_EQ(webcc::HeaderId::kSecWebSocketExtensions,
+            webcc::GetHeaderId(webcc::headers::kSecWebSocketExtensions));
+
+  EXPECT_EQ(webcc::HeaderId::kUnknown, webcc::GetHeaderId(""));
+  EXPECT_EQ(webcc::HeaderId::kUnknown, webcc::GetHeaderId("Hosts"));
+  EXPECT_EQ(webcc::HeaderId::kUnknown, webcc::GetHeaderId("X-Request-Id"));
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(HeadersTest, SetAndGet) {
+  webcc::Headers headers;
+
+  EXPECT_TRUE(headers.Set("Content-Type", "text/plain"));
+  EXPECT_TRUE(headers.Set("X-Request-Id", "123"));
+  EXPECT_FALSE(headers.Set("X-Empty", ""));
+
+  EXPECT_EQ(2, headers.size());
+  EXPECT_EQ("text/plain", headers.Get("content-type"));
+  EXPECT_EQ("text/plain", headers.Get(webcc::HeaderId::kContentType));
+  EXPECT_EQ("123", headers.Get("x-request-id"));
+  EXPECT_EQ("", headers.Get("X-Missing"));
+  EXPECT_EQ("", headers.Get(webcc::HeaderId::kHost));
+
+  // Replace, keeping the order.
+  EXPECT_TRUE(headers.Set("CONTENT-TYPE", "application/json"));
+  EXPECT_TRUE(headers.Set("x-request-id", "456"));
+
+  EXPECT_EQ(2, headers.size());
+  EXPECT_EQ("Content-Type", headers.Get(0).first);
+  EXPECT_EQ("application/json", headers.Get(0).second);
+  EXPECT_EQ("X-Request-Id", headers.Get(1).first);
+  EXPECT_EQ("456", headers.Get(1).second);
+}
+
+TEST(HeadersTest, ManyOtherHeaders) {
+  webcc::Headers headers;
+
+  // Enough to grow the hash table a few times.
+  for (int i = 0; i < 100; ++i) {
+    std::string n = std::to_string(i);
+    EXPECT_TRUE(headers.Set("X-Header-" + n, n));
+  }
+  EXPECT_TRUE(headers.Set("Host", "localhost"));
+
+  EXPECT_EQ(101, headers.size());
+  for (int i = 0; i < 100; ++i) {
+    std::string n = std::to_string(i);
+    EXPECT_EQ(n, headers.Get("x-header-" + n));
+  }
+  EXPECT_EQ("localhost", headers.Get("HOST"));
+
+  headers.Clear();
+  EXPECT_TRUE(headers.empty());
+  EXPECT_EQ("", headers.Get("X-Header-1"));
+  EXPECT_EQ("", headers.Get(webcc::HeaderId::kHost));
+}
+
+TEST(HeadersTest, SetView) {
+  const std::string block = "Connection: Keep-Alive";
+
+  webcc::Headers headers;
+  std::string_view key{ block.data(), 10 };
+  std::string_view value{ block.data() + 12, 10 };
+  EXPECT_TRUE(headers.SetView(key, value));
+
+  EXPECT_EQ("Keep-Alive", headers.Get(webcc::HeaderId::kConnection));
+  EXPECT_EQ(block.data() + 12,
+            headers.Get(webcc::HeaderId::kConnection).data());
+}
+
+// Setting a header again reuses the copy of its value.
+TEST(HeadersTest, SetAgain) {
+  webcc::Headers headers;
+
+  EXPECT_TRUE(headers.Set("X-Token", "0123456789abcdef0123456789abcdef"));
+  const char* data = headers.Get("X-Token").data();
+
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(headers.Set("X-Token", std::to_string(i)));
+    EXPECT_EQ(data, headers.Get("X-Token").data());
+  }
+  EXPECT_EQ("99", headers.Get("X-Token"));
+
+  // A view in between, the copy is reused after it.
+  const std::string token = "fedcba";
+  EXPECT_TRUE(headers.SetView("X-Token", token));
+  EXPECT_EQ(token.data(), headers.Get("X-Token").data());
+
+  EXPECT_TRUE(headers.Set("X-Token", "abc"));
+  EXPECT_EQ(data, headers.Get("X-Token").data());
+  EXPECT_EQ("abc", headers.Get("X-Token"));
+}
+
+// The copy refers to its own copies, not to the data the original refers to.
+TEST(HeadersTest, Copy) {
+  auto block = std::make_unique<std::string>("Connection: Keep-Alive");
+
+  webcc::Headers headers;
+  EXPECT_TRUE(headers.Set("Host", "localhost"));
+  EXPECT_TRUE(headers.SetView(std::string_view{ block->data(), 10 },
+                              std::string_view{ block->data() + 12, 10 }));
+  EXPECT_TRUE(headers.Set("X-Request-Id", "123"));
+
+  webcc::Headers copy{ headers };
+  block.reset();
+
+  ASSERT_EQ(3, copy.size());
+  EXPECT_EQ("Host", copy.Get(0).first);
+  EXPECT_EQ("Connection", copy.Get(1).first);
+  EXPECT_EQ("X-Request-Id", copy.Get(2).first);
+  EXPECT_EQ("Keep-Alive", copy.Get(webcc::HeaderId::kConnection));
+  EXPECT_EQ("123", copy.Get("x-request-id"));
+
+  // Independent of each other.
+  EXPECT_TRUE(copy.Set("Host", "example.com"));
+  EXPECT_EQ("localhost", headers.Get(webcc::HeaderId::kHost));
+
+  webcc::Headers assigned;
+  assigned.Set("X-Old", "1");
+  assigned = copy;
+  EXPECT_EQ(3, assigned.size());
+  EXPECT_EQ("", assigned.Get("X-Old"));
+  EXPECT_EQ("example.com", assigned.Get(webcc::HeaderId::kHost));
+
+  // Moved with the copies as they are.
+  webcc::Headers moved{ std::move(assigned) };
+  EXPECT_EQ("Keep-Alive", moved.Get(webcc::HeaderId::kConnection));
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include "webcc/connection_pool.h"
+
+// -----------------------------------------------------------------------------
+
+static webcc::ConnectionBase* NewConnection(boost::asio::io_context& io_context,
+                                            webcc::ConnectionPool* pool) {
+  return new webcc::Connection{
+    io_context, pool, [](webcc::ConnectionPtr) {},
+    [](const std::string&, const std::string&, webcc::UrlArgs*) {
+      return nullptr;
+    },
+    webcc::kBufferSize
+  };
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(ConnectionPoolTest, Reuse) {
+  boost::asio::io_context io_context;
+  webcc::ConnectionPool pool;
+
+  EXPECT_EQ(pool.Reuse(), nullptr);
+
+  auto connection = pool.Manage(NewConnection(io_context, &pool));
+  webcc::ConnectionBase* raw = connection.get();
+
+  // Still referenced.
+  EXPECT_EQ(pool.Reuse(), nullptr);
+
+  // Released and recycled.
+  connection.reset();
+
+  connection = pool.Reuse();
+  EXPECT_EQ(connection.get(), raw);
+
+  // shared_from_this() works with the new owner.
+  EXPECT_EQ(connection->shared_from_this(), connection);
+
+  EXPECT_EQ(pool.Reuse(), nullptr);
+}
+
+// The released connection is reset before it's parked, not when it's reused.
+TEST(ConnectionPoolTest, ResetOnRecycle) {
+  boost::asio::io_context io_context;
+  webcc::ConnectionPool pool;
+
+  auto connection = pool.Manage(NewConnection(io_context, &pool));
+  webcc::ConnectionBase* raw = connection.get();
+
+  connection->GetSocket().open(boost::asio::ip::tcp::v4());
+  ASSERT_TRUE(connection->GetSocket().is_open());
+
+  connection.reset();
+
+  EXPECT_FALSE(raw->GetSocket().is_open());
+
+  EXPECT_EQ(pool.Reuse().get(), raw);
+}
+
+TEST(ConnectionPoolTest, MaxRecycled) {
+  boost::asio::io_context io_context;
+  webcc::ConnectionPool pool;
+  pool.set_max_recycled(1);
+
+  auto connection1 = pool.Manage(NewConnection(io_context, &pool));
+  auto connection2 = pool.Manage(NewConnection(io_context, &pool));
+  connection1.reset();
+  connection2.reset();  // Deleted
+
+  connection1 = pool.Reuse();
+  EXPECT_NE(connection1, nullptr);
+  EXPECT_EQ(pool.Reuse(), nullptr);
+}
+
+TEST(ConnectionPoolTest, StopRecycling) {
+  boost::asio::io_context io_context;
+  webcc::ConnectionPool pool;
+
+  auto connection = pool.Manage(NewConnection(io_context, &pool));
+  connection.reset();
+
+  pool.StopRecycling();
+  EXPECT_EQ(pool.Reuse(), nullptr);
+
+  connection = pool.Manage(NewConnection(io_context, &pool));
+  connection.reset();  // Deleted
+  EXPECT_EQ(pool.Reuse(), nullptr);
+}
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <thread>
+
+#include "boost/asio/executor_work_guard.hpp"
+#include "boost/asio/post.hpp"
+#include "boost/asio/read_until.hpp"
+#include "boost/asio/write.hpp"
+
+#include "webcc/connection_pool.h"
+#include "webcc/event_stream.h"
+#include "webcc/response_builder.h"
+
+using boost::asio::ip::tcp;
+
+// -----------------------------------------------------------------------------
+
+// The events sent after the client has gone away are refused once the
+// connection finds it out (by a failed write), instead of being queued.
+TEST(ConnectionTest, EventStreamClientGone) {
+  boost::asio::io_context io_context;
+  auto work = boost::asio::make_work_guard(io_context);
+
+  webcc::ConnectionPool pool;
+
+  auto events = std::make_shared<webcc::EventStream>(0);
+
+  auto connection = pool.Manage(new webcc::Connection{
+      io_context, &pool,
+      [events](webcc::ConnectionPtr c) {
+        c->SendResponse(webcc::ResponseBuilder{}.OK().Events(events)());
+      },
+      [](const std::string&, const std::string&, webcc::UrlArgs*) {
+        return nullptr;
+      },
+      webcc::kBufferSize });
+
+  tcp::acceptor acceptor{ io_context,
+                          { boost::asio::ip::address_v4::loopback(), 0 } };
+  tcp::socket client{ io_context };
+  client.connect(acceptor.local_endpoint());
+  acceptor.accept(connection->GetSocket());
+
+  // Held as by a worker, so that the connection is not released (and reset)
+  // when it's closed.
+  pool.Start(connection);
+
+  std::thread loop{ [&io_context]() { io_context.run(); } };
+
+  std::string request = "GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  boost::asio::write(client, boost::asio::buffer(request));
+
+  std::string response;
+  boost::asio::read_until(client, boost::asio::dynamic_buffer(response),
+                          "\r\n\r\n");
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+
+  EXPECT_TRUE(events->Send("hello"));
+
+  client.close();
+
+  // The first writes might succeed before the reset of the client arrives.
+  bool sent = true;
+  for (int i = 0; i < 200 && sent; ++i) {
+    sent = events->Send("hello");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_FALSE(sent);
+  EXPECT_TRUE(events->closed());
+
+  boost::asio::post(io_context, [&pool]() { pool.Clear(); });
+  work.reset();
+  loop.join();
+
+  connection.reset();
+}
@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+
+#include "webcc/hpack.h"
+
+// Convert a hex string like "8286 8441" to binary.
+static std::string FromHex(const std::string& hex) {
+  std::string binary;
+  std::string digits;
+  for (char c : hex) {
+    if (c != ' ') {
+      digits += c;
+    }
+    if (digits.size() == 2) {
+      binary += static_cast<char>(std::stoi(digits, nullptr, 16));
+      digits.clear();
+    }
+  }
+  return binary;
+}
+
+// -----------------------------------------------------------------------------
+
+// RFC 7541 C.1.2: Encoding 1337 with a 5-bit prefix.
+TEST(HpackTest, Integer) {
+  std::string output;
+  webcc::hpack::EncodeInteger(1337, 5, 0, &output);
+  EXPECT_EQ(output, FromHex("1f9a 0a"));
+
+  auto data = reinterpret_cast<const unsigned char*>(output.data());
+  std::size_t value = 0;
+  ASSERT_TRUE(webcc::hpack::DecodeInteger(&data, data + output.size(), 5,
+                                          &value));
+  EXPECT_EQ(value, 1337);
+
+  // Incomplete.
+  data = reinterpret_cast<const unsigned char*>(output.data());
+  EXPECT_FALSE(webcc::hpack::DecodeInteger(&data, data + 2, 5, &value));
+}
+
+TEST(HpackTest, Huffman) {
+  std::string output;
+  webcc::hpack::HuffmanEncode("www.example.com", &output);
+  EXPECT_EQ(output, FromHex("f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+
+  std::string decoded;
+  ASSERT_TRUE(webcc::hpack::HuffmanDecode(
+      reinterpret_cast<const unsigned char*>(output.data()), output.size(),
+      &decoded));
+  EXPECT_EQ(decoded, "www.example.com");
+
+  // The padding is not a prefix of EOS.
+  output.back() &= 0xfe;
+  decoded.clear();
+  EXPECT_FALSE(webcc::hpack::HuffmanDecode(
+      reinterpret_cast<const unsigned char*>(output.data()), output.size(),
+      &decoded));
+}
+
+// RFC 7541 C.4: Request examples with Huffman coding.
+TEST(HpackTest, DecodeRequests) {
+  webcc::HpackDecoder decoder;
+
+  std::vector<webcc::Header> headers;
+  std::string block = FromHex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff");
+  ASSERT_TRUE(decoder.Decode(block.data(), block.size(), &headers));
+
+  std::vector<webcc::Header> expected = {
+    { ":method", "GET" },
+    { ":scheme", "http" },
+    { ":path", "/" },
+    { ":authority", "www.example.com" },
+  };
+  EXPECT_EQ(headers, expected);
+
+  headers.clear();
+  block = FromHex("8286 84be 5886 a8eb 1064 9cbf");
+  ASSERT_TRUE(decoder.Decode(block.data(), block.size(), &headers));
+
+  expected.push_back({ "cache-control", "no-cache" });
+  EXPECT_EQ(headers, expected);
+
+  headers.clear();
+  block = FromHex(
+      "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf");
+  ASSERT_TRUE(decoder.Decode(block.data(), block.size(), &headers));
+
+  expected = {
+    { ":method", "GET" },
+    { ":scheme", "https" },
+    { ":path", "/index.html" },
+    { ":authority", "www.example.com" },
+    { "custom-key", "custom-value" },
+  };
+  EXPECT_EQ(headers, expected);
+}
+
+TEST(HpackTest, DecodeInvalid) {
+  webcc::HpackDecoder decoder;
+  std::vector<webcc::Header> headers;
+
+  // Index out of the table.
+  std::string block = FromHex("ff00");
+  EXPECT_FALSE(decoder.Decode(block.data(), block.size(), &headers));
+
+  // Truncated string.
+  block = FromHex("4088 25a8");
+  EXPECT_FALSE(decoder.Decode(block.data(), block.size(), &headers));
+
+  // Table size update larger than the settings.
+  block = FromHex("3fe2 1f");  // 4097
+  EXPECT_FALSE(decoder.Decode(block.data(), block.size(), &headers));
+}
+
+TEST(HpackTest, EncodeDecode) {
+  webcc::HpackEncoder encoder;
+  webcc::HpackDecoder decoder;
+
+  std::vector<webcc::Header> fields = {
+    { ":status", "200" },
+    { "content-type", "application/json" },
+    { "content-length", "1024" },
+    { "set-cookie", "id=1" },
+    { "server", "Webcc" },
+  };
+
+  std::string block1;
+  for (auto& field : fields) {
+    encoder.Encode(field.first, field.second, &block1);
+  }
+
+  // The same fields again, mostly indexed this time.
+  std::string block2;
+  for (auto& field : fields) {
+    encoder.Encode(field.first, field.second, &block2);
+  }
+  EXPECT_LT(block2.size(), block1.size());
+
+  std::vector<webcc::Header> headers;
+  ASSERT_TRUE(decoder.Decode(block1.data(), block1.size(), &headers));
+  EXPECT_EQ(headers, fields);
+
+  headers.clear();
+  ASSERT_TRUE(decoder.Decode(block2.data(), block2.size(), &headers));
+  EXPECT_EQ(headers, fields);
+
+  // The names are lowercased.
+  headers.clear();
+  std::string block3;
+  encoder.set_max_table_size(0);
+  encoder.Encode("Content-Type", "text/plain", &block3);
+  ASSERT_TRUE(decoder.Decode(block3.data(), block3.size(), &headers));
+  ASSERT_EQ(headers.size(), 1);
+  EXPECT_EQ(headers[0].first, "content-type");
+  EXPECT_EQ(headers[0].second, "text/plain");
+}
@@ -0,0 +1,178 @@
+#include "gtest/gtest.h"
+
+#include <map>
+
+#include "webcc/http2_session.h"
+
+namespace error_codes = webcc::http2::error_codes;
+
+// A session recording what it has received.
+class TestSession : public webcc::Http2Session {
+public:
+  explicit TestSession(bool server) : webcc::Http2Session(server) {
+  }
+
+  using webcc::Http2Session::encoder;
+  using webcc::Http2Session::OpenStream;
+  using webcc::Http2Session::ResetStream;
+  using webcc::Http2Session::Submit;
+
+  void OnHeaders(std::uint32_t stream_id, std::vector<webcc::Header>&& headers,
+                 bool end_stream) override {
+    headers_[stream_id] = std::move(headers);
+    if (end_stream) {
+      ended_[stream_id] = true;
+    }
+  }
+
+  void OnData(std::uint32_t stream_id, const char* data, std::size_t length,
+              bool end_stream) override {
+    data_[stream_id].append(data, length);
+    if (end_stream) {
+      ended_[stream_id] = true;
+    }
+  }
+
+  void OnStreamClosed(std::uint32_t stream_id,
+                      std::uint32_t error_code) override {
+    closed_[stream_id] = error_code;
+  }
+
+  std::map<std::uint32_t, std::vector<webcc::Header>> headers_;
+  std::map<std::uint32_t, std::string> data_;
+  std::map<std::uint32_t, bool> ended_;
+  std::map<std::uint32_t, std::uint32_t> closed_;
+};
+
+// Exchange the output of the two sessions until there's no more.
+static void Exchange(TestSession* a, TestSession* b) {
+  std::string output;
+  bool more = true;
+  while (more) {
+    more = false;
+    for (auto pair : { std::make_pair(a, b), std::make_pair(b, a) }) {
+      pair.first->WriteData();
+      if (pair.first->HasOutput()) {
+        pair.first->TakeOutput(&output);
+        ASSERT_TRUE(pair.second->Feed(output.data(), output.size()));
+        more = true;
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// The bodies are larger than the default windows, and the response is larger
+// than the default max frame size.
+TEST(Http2SessionTest, RequestResponse) {
+  TestSession client{ false };
+  TestSession server{ true };
+
+  client.Start();
+  server.Start();
+
+  std::uint32_t stream_id = client.OpenStream();
+  EXPECT_EQ(stream_id, 1);
+
+  std::string block;
+  client.encoder().Encode(":method", "POST", &block);
+  client.encoder().Encode(":path", "/upload", &block);
+  client.encoder().Encode(":scheme", "http", &block);
+
+  std::string request_data(200 * 1024, 'a');
+  client.Submit(stream_id, block,
+                std::make_shared<webcc::StringBody>(request_data, false));
+
+  Exchange(&client, &server);
+
+  ASSERT_TRUE(server.ended_[stream_id]);
+  EXPECT_EQ(server.data_[stream_id], request_data);
+
+  std::vector<webcc::Header> expected = {
+    { ":method", "POST" },
+    { ":path", "/upload" },
+    { ":scheme", "http" },
+  };
+  EXPECT_EQ(server.headers_[stream_id], expected);
+
+  block.clear();
+  server.encoder().Encode(":status", "200", &block);
+
+  std::string response_data(300 * 1024, 'b');
+  server.Submit(stream_id, block,
+                std::make_shared<webcc::StringBody>(response_data, false));
+
+  Exchange(&client, &server);
+
+  ASSERT_TRUE(client.ended_[stream_id]);
+  EXPECT_EQ(client.data_[stream_id], response_data);
+
+  ASSERT_EQ(client.closed_.count(stream_id), 1);
+  EXPECT_EQ(client.closed_[stream_id], error_codes::kNoError);
+  ASSERT_EQ(server.closed_.count(stream_id), 1);
+  EXPECT_EQ(server.closed_[stream_id], error_codes::kNoError);
+
+  EXPECT_EQ(client.stream_count(), 0);
+  EXPECT_EQ(server.stream_count(), 0);
+}
+
+TEST(Http2SessionTest, MaxConcurrentStreams) {
+  TestSession client{ false };
+  TestSession server{ true };
+
+  // Unlimited until the server tells.
+  EXPECT_EQ(client.peer_max_concurrent_streams(), 0xffffffff);
+
+  client.Start();
+  server.Start();
+
+  Exchange(&client, &server);
+
+  EXPECT_EQ(client.peer_max_concurrent_streams(),
+            webcc::http2::kMaxConcurrentStreams);
+}
+
+TEST(Http2SessionTest, ResetStream) {
+  TestSession client{ false };
+  TestSession server{ true };
+
+  client.Start();
+  server.Start();
+
+  std::uint32_t stream_id = client.OpenStream();
+
+  std::string block;
+  client.encoder().Encode(":method", "GET", &block);
+  client.encoder().Encode(":path", "/", &block);
+  client.Submit(stream_id, block, nullptr);
+
+  Exchange(&client, &server);
+  EXPECT_EQ(server.stream_count(), 1);
+
+  // The client cancels the request before the response.
+  client.ResetStream(stream_id, error_codes::kCancel);
+
+  Exchange(&client, &server);
+  EXPECT_EQ(server.stream_count(), 0);
+  ASSERT_EQ(server.closed_.count(stream_id), 1);
+  EXPECT_EQ(server.closed_[stream_id], error_codes::kCancel);
+}
+
+TEST(Http2SessionTest, InvalidPreface) {
+  TestSession server{ true };
+  server.Start();
+
+  std::string output;
+  server.TakeOutput(&output);
+
+  std::string data = "GET / HTTP/1.1\r\n\r\n";
+  EXPECT_FALSE(server.Feed(data.data(), data.size()));
+  EXPECT_TRUE(server.going_away());
+
+  // GOAWAY
+  server.TakeOutput(&output);
+  ASSERT_EQ(output.size(), 17);
+  EXPECT_EQ(output[3], webcc::http2::frame_types::kGoAway);
+  EXPECT_EQ(output[16], static_cast<char>(error_codes::kProtocolError));
+}
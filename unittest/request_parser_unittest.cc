@@ -1,14 +1,18 @@
 #include "gtest/gtest.h"
 
+#include "boost/algorithm/string.hpp"
+
+#include "webcc/body.h"
 #include "webcc/request.h"
 #include "webcc/request_parser.h"
+#include "webcc/utility.h"
 
 // -----------------------------------------------------------------------------
 
-bool ViewMatcher(const std::string& method, const std::string& url_path,
-                 bool* stream) {
-  *stream = false;
-  return true;
+const webcc::RouteInfo* ViewMatcher(const std::string& method,
+                                    const std::string& url_path,
+                                    webcc::UrlArgs* args) {
+  return nullptr;
 }
 
 // -----------------------------------------------------------------------------
@@ -51,6 +55,32 @@ TEST_F(GetRequestParserTest, ParseOnce) {
   CheckResult(request);
 }
 
+// The start line and the headers refer to the header block of the request.
+TEST_F(GetRequestParserTest, HeaderBlock) {
+  webcc::Request request;
+  parser_.Init(&request, ViewMatcher);
+
+  bool ok = parser_.Parse(payload_.data(), payload_.size());
+  ASSERT_TRUE(ok);
+
+  const std::string& block = request.header_block();
+  EXPECT_EQ(payload_, block);
+  EXPECT_EQ(payload_.size(), parser_.header_length());
+
+  auto in_block = [&block](std::string_view str) {
+    return str.data() >= block.data() &&
+           str.data() + str.size() <= block.data() + block.size();
+  };
+
+  EXPECT_EQ("GET /get HTTP/1.1", request.start_line());
+  EXPECT_TRUE(in_block(request.start_line()));
+
+  for (const webcc::HeaderView& header : request.headers().data()) {
+    EXPECT_TRUE(in_block(header.first));
+    EXPECT_TRUE(in_block(header.second));
+  }
+}
+
 // Parse byte by byte.
 TEST_F(GetRequestParserTest, ParseByteWise) {
   webcc::Request request;
@@ -116,6 +146,34 @@ TEST_F(GetRequestParserTest, ParseTwoRounds) {
   CheckResult(request2);
 }
 
+// Parse two pipelined requests from the same data.
+TEST_F(GetRequestParserTest, ParsePipelined) {
+  std::string data = payload_ + payload_;
+
+  webcc::Request request1;
+  parser_.Init(&request1, ViewMatcher);
+
+  bool ok = parser_.Parse(data.data(), data.size());
+
+  ASSERT_TRUE(ok);
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), payload_.size());
+
+  CheckResult(request1);
+
+  webcc::Request request2;
+  parser_.Init(&request2, ViewMatcher);
+
+  ok = parser_.Parse(data.data() + parser_.consumed(),
+                     data.size() - parser_.consumed());
+
+  ASSERT_TRUE(ok);
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), payload_.size());
+
+  CheckResult(request2);
+}
+
 // -----------------------------------------------------------------------------
 
 // HTTP POST request parser test fixture.
@@ -212,6 +270,252 @@ TEST_F(PostRequestParserTest, ParseTwoRounds) {
   CheckResult(request2);
 }
 
+// The content ends at the Content-Length, the rest is the next request.
+TEST_F(PostRequestParserTest, ParsePipelined) {
+  std::string data = payload_ + payload_;
+
+  webcc::Request request1;
+  parser_.Init(&request1, ViewMatcher);
+
+  // Split the data in the middle of the content of the first request.
+  std::size_t split = payload_.size() - 10;
+
+  bool ok = parser_.Parse(data.data(), split);
+
+  ASSERT_TRUE(ok);
+  EXPECT_FALSE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), split);
+
+  ok = parser_.Parse(data.data() + split, data.size() - split);
+
+  ASSERT_TRUE(ok);
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), 10);
+
+  CheckResult(request1);
+
+  webcc::Request request2;
+  parser_.Init(&request2, ViewMatcher);
+
+  ok = parser_.Parse(data.data() + payload_.size(), payload_.size());
+
+  ASSERT_TRUE(ok);
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), payload_.size());
+
+  CheckResult(request2);
+}
+
+// The chunked content ends with the last chunk and an empty line.
+TEST(ChunkedRequestParserTest, ParsePipelined) {
+  // clang-format off
+  std::string payload =
+      "POST /upload HTTP/1.1\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Host: localhost\r\n\r\n"
+      "5\r\nHello\r\n"
+      "7\r\n, World\r\n"
+      "0\r\n\r\n";
+  // clang-format on
+
+  std::string next = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  std::string data = payload + next;
+
+  webcc::RequestParser parser;
+
+  webcc::Request request;
+  parser.Init(&request, ViewMatcher);
+
+  // Split the data before the empty line ending the content.
+  std::size_t split = payload.size() - 2;
+
+  bool ok = parser.Parse(data.data(), split);
+
+  ASSERT_TRUE(ok);
+  EXPECT_FALSE(parser.finished());
+
+  ok = parser.Parse(data.data() + split, data.size() - split);
+
+  ASSERT_TRUE(ok);
+  EXPECT_TRUE(parser.finished());
+  EXPECT_EQ(parser.consumed(), 2);
+  EXPECT_EQ(request.data(), "Hello, World");
+}
+
+// The content split at any position by the reads, even the CRLF.
+TEST(ChunkedRequestParserTest, ParseSplit) {
+  // clang-format off
+  std::string payload =
+      "POST /upload HTTP/1.1\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Host: localhost\r\n\r\n";
+  std::string content =
+      "5;name=value\r\nHello\r\n"
+      "7\r\n, World\r\n"
+      "0\r\n"
+      "Expires: never\r\n\r\n";
+  // clang-format on
+
+  for (std::size_t split = 0; split <= content.size(); ++split) {
+    webcc::RequestParser parser;
+
+    webcc::Request request;
+    parser.Init(&request, ViewMatcher);
+
+    ASSERT_TRUE(parser.Parse(payload.data(), payload.size()));
+    ASSERT_TRUE(parser.Parse(content.data(), split));
+    ASSERT_TRUE(parser.Parse(content.data() + split, content.size() - split));
+
+    EXPECT_TRUE(parser.finished());
+    EXPECT_EQ(request.data(), "Hello, World");
+  }
+
+  // One byte a read.
+  webcc::RequestParser parser;
+
+  webcc::Request request;
+  parser.Init(&request, ViewMatcher);
+
+  ASSERT_TRUE(parser.Parse(payload.data(), payload.size()));
+  for (char c : content) {
+    ASSERT_TRUE(parser.Parse(&c, 1));
+  }
+
+  EXPECT_TRUE(parser.finished());
+  EXPECT_EQ(request.data(), "Hello, World");
+}
+
+TEST(ChunkedRequestParserTest, ParseInvalid) {
+  // clang-format off
+  std::string payload =
+      "POST /upload HTTP/1.1\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Host: localhost\r\n\r\n"
+      "5\r\nHello, World\r\n"
+      "0\r\n\r\n";
+  // clang-format on
+
+  webcc::RequestParser parser;
+
+  webcc::Request request;
+  parser.Init(&request, ViewMatcher);
+
+  // The chunk data is longer than the chunk size.
+  EXPECT_FALSE(parser.Parse(payload.data(), payload.size()));
+}
+
+// -----------------------------------------------------------------------------
+
+class EmptyView : public webcc::View {
+public:
+  webcc::ResponsePtr Handle(webcc::RequestPtr request) override {
+    return {};
+  }
+};
+
+TEST(RequestParserTest, MaxBodySize) {
+  // clang-format off
+  std::string headers =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Content-Length: 11\r\n\r\n";
+  std::string chunked =
+      "POST /upload HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n"
+      "5\r\nHello\r\n"
+      "7\r\n, World\r\n"
+      "0\r\n\r\n";
+  // clang-format on
+
+  webcc::RequestParser parser;
+  parser.set_max_body_size(10);
+
+  // Rejected by the Content-Length, before the body.
+  webcc::Request request1;
+  parser.Init(&request1, ViewMatcher);
+  EXPECT_FALSE(parser.Parse(headers.data(), headers.size()));
+  EXPECT_TRUE(parser.body_too_large());
+
+  // Rejected by the size of the second chunk.
+  webcc::Request request2;
+  parser.Init(&request2, ViewMatcher);
+  EXPECT_FALSE(parser.body_too_large());
+  EXPECT_FALSE(parser.Parse(chunked.data(), chunked.size()));
+  EXPECT_TRUE(parser.body_too_large());
+
+  // The route allows more.
+  webcc::RouteInfo route{ "/upload", std::make_shared<EmptyView>(),
+                          { "POST" }, "", 12 };
+  auto route_matcher = [&route](const std::string&, const std::string&,
+                                webcc::UrlArgs*) { return &route; };
+
+  webcc::Request request3;
+  parser.Init(&request3, route_matcher);
+  EXPECT_TRUE(parser.Parse(chunked.data(), chunked.size()));
+  EXPECT_TRUE(parser.finished());
+  EXPECT_EQ(request3.data(), "Hello, World");
+}
+
+// The request of a keep-alive connection is cleared and reused for the next.
+TEST(RequestParserTest, ReuseRequest) {
+  // clang-format off
+  std::string post =
+      "POST /books/123?sort=title HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "X-Request-Id: 42\r\n"
+      "Content-Length: 5\r\n\r\n"
+      "Hello";
+  std::string get =
+      "GET /hello HTTP/1.1\r\n"
+      "Host: localhost\r\n\r\n";
+  // clang-format on
+
+  webcc::RouteInfo route{ "/books/123", std::make_shared<EmptyView>(),
+                          { "POST" }, "", webcc::kInvalidSize };
+  auto route_matcher = [&route](const std::string&, const std::string& path,
+                                webcc::UrlArgs* args) {
+    const webcc::RouteInfo* matched = nullptr;
+    if (path == route.url) {
+      args->push_back("123");
+      matched = &route;
+    }
+    return matched;
+  };
+
+  webcc::RequestParser parser;
+  webcc::Request request;
+
+  parser.Init(&request, route_matcher);
+  ASSERT_TRUE(parser.Parse(post.data(), post.size()));
+  EXPECT_TRUE(parser.finished());
+  EXPECT_EQ(request.args().size(), 1);
+  EXPECT_EQ(request.data(), "Hello");
+
+  // Somebody else still holds the body.
+  webcc::BodyPtr body = request.body();
+
+  request.Clear();
+  EXPECT_TRUE(request.start_line().empty());
+  EXPECT_TRUE(request.headers().empty());
+  EXPECT_TRUE(request.body()->IsEmpty());
+
+  parser.Init(&request, route_matcher);
+  ASSERT_TRUE(parser.Parse(get.data(), get.size()));
+  EXPECT_TRUE(parser.finished());
+
+  EXPECT_EQ(request.method(), "GET");
+  EXPECT_EQ(request.url().path(), "/hello");
+  EXPECT_EQ(request.url().query(), "");
+  EXPECT_TRUE(request.args().empty());
+  EXPECT_EQ(request.GetHeader("Host"), "localhost");
+  EXPECT_EQ(request.GetHeader("X-Request-Id"), "");
+  EXPECT_EQ(request.data(), "");
+  EXPECT_EQ(request.content_length(), webcc::kInvalidSize);
+
+  EXPECT_EQ(body->GetSize(), 5);
+}
+
 // -----------------------------------------------------------------------------
 
 // HTTP multipart form request parser test fixture.
@@ -268,7 +572,26 @@ protected:
     EXPECT_EQ(request.GetHeader("Host"), "localhost:8080");
     EXPECT_EQ(request.GetHeader("Accept"), "*/*");
     EXPECT_EQ(request.GetHeader("Connection"), "Keep-Alive");
-    EXPECT_EQ(request.form_parts().size(), 2);
+    ASSERT_EQ(request.form_parts().size(), 2);
+
+    // The file part has been streamed to a temp file.
+    const webcc::FormPartPtr& file_part = request.form_parts()[0];
+    EXPECT_EQ(file_part->name(), "file");
+    EXPECT_EQ(file_part->file_name(), "remember.txt");
+    EXPECT_EQ(file_part->data(), "");
+    ASSERT_TRUE(file_part->file_body());
+
+    std::string file_data;
+    EXPECT_TRUE(webcc::utility::ReadFile(file_part->file_body()->path(),
+                                         &file_data));
+    EXPECT_EQ(file_data.size(), 674);
+    EXPECT_TRUE(boost::starts_with(file_data, "Remember\r\n"));
+    EXPECT_TRUE(boost::ends_with(file_data, "be sad.\r\n"));
+
+    const webcc::FormPartPtr& json_part = request.form_parts()[1];
+    EXPECT_EQ(json_part->name(), "json");
+    EXPECT_EQ(json_part->data(), "{}");
+    EXPECT_FALSE(json_part->file_body());
   }
 
   std::string payload_;
@@ -327,3 +650,67 @@ TEST_F(MultipartRequestParserTest, ParseTwoRounds) {
 
   CheckResult(request2);
 }
+
+// Split the data at any position, e.g., in the middle of a boundary.
+TEST_F(MultipartRequestParserTest, ParseSplit) {
+  for (std::size_t split = 1; split < payload_.size(); ++split) {
+    webcc::Request request;
+    parser_.Init(&request, ViewMatcher);
+
+    ASSERT_TRUE(parser_.Parse(payload_.data(), split));
+    ASSERT_TRUE(parser_.Parse(payload_.data() + split,
+                              payload_.size() - split));
+
+    EXPECT_TRUE(parser_.finished());
+
+    CheckResult(request);
+  }
+}
+
+// The CRLF after the close boundary comes in a later read, together with a
+// pipelined request. It's consumed as the epilogue of the form, up to the
+// Content-Length, instead of being taken as the start of the next request.
+TEST_F(MultipartRequestParserTest, ParseEpilogueSplit) {
+  std::string next = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  std::string data = payload_ + next;
+
+  // Right after "--boundary--".
+  std::size_t split = payload_.size() - 2;
+
+  webcc::Request request;
+  parser_.Init(&request, ViewMatcher);
+
+  ASSERT_TRUE(parser_.Parse(data.data(), split));
+  EXPECT_FALSE(parser_.finished());
+
+  ASSERT_TRUE(parser_.Parse(data.data() + split, data.size() - split));
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(parser_.consumed(), 2);
+
+  CheckResult(request);
+
+  webcc::Request request2;
+  parser_.Init(&request2, ViewMatcher);
+
+  ASSERT_TRUE(parser_.Parse(next.data(), next.size()));
+  EXPECT_TRUE(parser_.finished());
+  EXPECT_EQ(request2.method(), "GET");
+  EXPECT_EQ(request2.url().path(), "/hello");
+}
+
+// The temp file is removed if the request is abandoned.
+TEST_F(MultipartRequestParserTest, ParseAbandoned) {
+  webcc::Request request;
+  parser_.Init(&request, ViewMatcher);
+
+  ASSERT_TRUE(parser_.Parse(payload_.data(), payload_.size() - 200));
+  EXPECT_FALSE(parser_.finished());
+
+  webcc::Request request2;
+  parser_.Init(&request2, ViewMatcher);
+
+  ASSERT_TRUE(parser_.Parse(payload_.data(), payload_.size()));
+  EXPECT_TRUE(parser_.finished());
+
+  CheckResult(request2);
+}
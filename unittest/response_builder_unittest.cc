@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 
 #include "webcc/response_builder.h"
+#include "webcc/utility.h"
 
 // Empty body should also have a Content-Length header.
 TEST(ResponseBuilderTest, EmptyBody) {
@@ -12,3 +13,37 @@ TEST(ResponseBuilderTest, EmptyBody) {
 
   EXPECT_EQ(value, "0");
 }
+
+// The start line of a well-known status is shared, others are built.
+TEST(ResponseBuilderTest, StartLine) {
+  using namespace webcc;
+
+  auto response1 = ResponseBuilder{}.OK()();
+  auto response2 = ResponseBuilder{}.OK()();
+  response1->Prepare();
+  response2->Prepare();
+
+  EXPECT_EQ(response1->start_line(), "HTTP/1.1 200 OK");
+  EXPECT_EQ(response1->start_line().data(), response2->start_line().data());
+  EXPECT_EQ(response1->GetHeader(headers::kServer), utility::UserAgent());
+
+  auto response3 = ResponseBuilder{}.Code(299)();
+  response3->Prepare();
+  EXPECT_EQ(response3->start_line(), "HTTP/1.1 299 ");
+
+  auto response4 = ResponseBuilder{}.OK()();
+  response4->set_reason("Fine");
+  response4->Prepare();
+  EXPECT_EQ(response4->start_line(), "HTTP/1.1 200 Fine");
+}
+
+TEST(ResponseBuilderTest, SetDate) {
+  using namespace webcc;
+
+  auto response = ResponseBuilder{}.OK()();
+  response->SetDate();
+
+  std::string_view date = response->GetHeader(headers::kDate);
+  EXPECT_EQ(date.size(), utility::kHttpDateSize);
+  EXPECT_EQ(date.substr(date.size() - 4), " GMT");
+}
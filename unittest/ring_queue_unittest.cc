@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "webcc/ring_queue.h"
+
+TEST(RingQueueTest, Capacity) {
+  webcc::RingQueue<int> queue{ 5 };
+  EXPECT_EQ(queue.capacity(), 8);
+
+  queue.Reset(16);
+  EXPECT_EQ(queue.capacity(), 16);
+}
+
+TEST(RingQueueTest, PushPop) {
+  webcc::RingQueue<int> queue{ 4 };
+
+  EXPECT_EQ(queue.Size(), 0);
+  EXPECT_EQ(queue.Pop(), 0);
+
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_TRUE(queue.TryPush(i));
+  }
+
+  // Full
+  EXPECT_FALSE(queue.TryPush(5));
+  EXPECT_EQ(queue.Size(), 4);
+
+  // FIFO
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_EQ(queue.PopOrWait(), i);
+  }
+
+  EXPECT_EQ(queue.Size(), 0);
+
+  // Wrap around.
+  EXPECT_TRUE(queue.TryPush(5));
+  EXPECT_EQ(queue.Pop(), 5);
+}
+
+TEST(RingQueueTest, Clear) {
+  webcc::RingQueue<std::shared_ptr<int>> queue{ 4 };
+
+  auto ptr = std::make_shared<int>(1);
+  queue.Push(ptr);
+  queue.Push(ptr);
+  EXPECT_EQ(ptr.use_count(), 3);
+
+  queue.Clear();
+  EXPECT_EQ(queue.Size(), 0);
+
+  // The queue doesn't hold the popped messages.
+  EXPECT_EQ(ptr.use_count(), 1);
+}
+
+TEST(RingQueueTest, PopOrWaitFor) {
+  webcc::RingQueue<int> queue{ 4 };
+
+  int message = 0;
+  EXPECT_FALSE(queue.PopOrWaitFor(&message, std::chrono::milliseconds(10)));
+
+  std::thread producer{ [&queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.Push(1);
+  } };
+
+  EXPECT_TRUE(queue.PopOrWaitFor(&message, std::chrono::seconds(10)));
+  EXPECT_EQ(message, 1);
+
+  producer.join();
+}
+
+TEST(RingQueueTest, MultipleProducersConsumers) {
+  constexpr int kThreads = 4;
+  constexpr int kCount = 10000;
+
+  // Small capacity so that the producers have to wait for free slots.
+  webcc::RingQueue<int> queue{ 16 };
+
+  std::atomic<long long> sum = 0;
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kThreads; ++i) {
+    consumers.emplace_back([&queue, &sum]() {
+      while (true) {
+        int n = queue.PopOrWait();
+        if (n == 0) {
+          break;
+        }
+        sum += n;
+      }
+    });
+  }
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kThreads; ++i) {
+    producers.emplace_back([&queue]() {
+      for (int n = 1; n <= kCount; ++n) {
+        queue.Push(n);
+      }
+    });
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  // Stop the consumers.
+  for (int i = 0; i < kThreads; ++i) {
+    queue.Push(0);
+  }
+
+  for (auto& t : consumers) {
+    t.join();
+  }
+
+  EXPECT_EQ(sum, (long long)kThreads * kCount * (kCount + 1) / 2);
+}
@@ -74,3 +74,39 @@ TEST(RouterTest, URL_NonRegex) {
   ASSERT_NE(view, nullptr);
   EXPECT_TRUE(args.empty());
 }
+
+TEST(RouterTest, Executor) {
+  webcc::Router router;
+
+  router.Route("/instances", std::make_shared<MyView>());
+  router.Route("/reports", std::make_shared<MyView>(), { "GET" }, "slow");
+
+  webcc::UrlArgs args;
+
+  const webcc::RouteInfo* route = router.FindRoute("GET", "/instances", &args);
+  ASSERT_NE(route, nullptr);
+  EXPECT_TRUE(route->executor.empty());
+
+  route = router.FindRoute("GET", "/reports", &args);
+  ASSERT_NE(route, nullptr);
+  EXPECT_EQ(route->executor, "slow");
+
+  route = router.FindRoute("POST", "/reports", &args);
+  EXPECT_EQ(route, nullptr);
+}
+
+TEST(RouterTest, MatchView) {
+  webcc::Router router;
+
+  router.Route(webcc::R{ "/instance/(\\d+)" }, std::make_shared<MyView>());
+
+  bool stream = true;
+  EXPECT_TRUE(router.MatchView("GET", "/instance/12345", &stream));
+  EXPECT_FALSE(stream);
+
+  stream = true;
+  EXPECT_FALSE(router.MatchView("POST", "/instance/12345", &stream));
+  EXPECT_FALSE(stream);
+
+  EXPECT_FALSE(router.MatchView("GET", "/instance/abcde", &stream));
+}
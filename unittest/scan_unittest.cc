@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+
+#include "webcc/internal/scan.h"
+
+using webcc::internal::ScanLevel;
+
+// Compare with std::string_view::find() at every level supported.
+class ScanTest : public testing::TestWithParam<ScanLevel> {
+protected:
+  void SetUp() override {
+    level_ = webcc::internal::GetScanLevel();
+    webcc::internal::SetScanLevel(GetParam());
+  }
+
+  void TearDown() override {
+    webcc::internal::SetScanLevel(level_);
+  }
+
+  static void Check(std::string_view str, std::string_view pattern) {
+    for (std::size_t off = 0; off <= str.size() + 1; ++off) {
+      EXPECT_EQ(str.find(pattern, off),
+                webcc::internal::Find(str, pattern, off))
+          << "off=" << off << ", pattern=" << pattern;
+    }
+  }
+
+  ScanLevel level_ = ScanLevel::kScalar;
+};
+
+TEST_P(ScanTest, Find) {
+  Check("", "\r\n");
+  Check("\r\n", "\r\n");
+  Check("\r", "\r\n");
+  Check("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n", "\r\n");
+  Check("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n", "\r\n\r\n");
+  Check("GET / HTTP/1.1\r\nHost: localhost\r\n\r", "\r\n\r\n");
+  Check("abc", "");
+}
+
+TEST_P(ScanTest, Find_Random) {
+  std::mt19937 rg{ 1234 };
+  // Few chars so that there are many partial matches.
+  std::uniform_int_distribution<int> pick{ 0, 3 };
+  const char chars[] = { '\r', '\n', '-', 'a' };
+
+  std::string str;
+  for (int i = 0; i < 300; ++i) {
+    str.push_back(chars[pick(rg)]);
+  }
+
+  for (std::string_view pattern :
+       { "\r\n", "\r\n\r\n", "\r\n--a-\r\n", "-", "aaaaaaaaaaaaaaaaaaaaa" }) {
+    Check(str, pattern);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Levels, ScanTest,
+                         testing::Values(ScanLevel::kScalar, ScanLevel::kSse2,
+                                         ScanLevel::kAvx2));
+
+// -----------------------------------------------------------------------------
+
+TEST(SearcherTest, Find) {
+  std::mt19937 rg{ 1234 };
+  std::uniform_int_distribution<int> pick{ 0, 3 };
+  const char chars[] = { '\r', '\n', '-', 'a' };
+
+  std::string str;
+  for (int i = 0; i < 1000; ++i) {
+    str.push_back(chars[pick(rg)]);
+  }
+
+  for (std::string_view pattern :
+       { "", "-", "\r\n", "\r\n--a", "\r\n--a-\r\n", "a-a-a-a-a" }) {
+    webcc::internal::Searcher searcher{ pattern };
+    for (std::size_t off = 0; off <= str.size() + 1; ++off) {
+      EXPECT_EQ(str.find(pattern, off), searcher.Find(str, off))
+          << "off=" << off << ", pattern=" << pattern;
+    }
+  }
+}
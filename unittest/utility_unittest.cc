@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+
+#include <ctime>
+
+#include "webcc/utility.h"
+
+TEST(UtilityTest, FormatHttpDate) {
+  std::tm gmt{};
+  gmt.tm_year = 2015 - 1900;
+  gmt.tm_mon = 9;
+  gmt.tm_mday = 21;
+  gmt.tm_wday = 3;
+  gmt.tm_hour = 7;
+  gmt.tm_min = 28;
+  gmt.tm_sec = 0;
+
+  EXPECT_EQ(webcc::utility::FormatHttpDate(gmt),
+            "Wed, 21 Oct 2015 07:28:00 GMT");
+
+  gmt.tm_year = 2024 - 1900;
+  gmt.tm_mon = 1;
+  gmt.tm_mday = 29;
+  gmt.tm_wday = 4;
+  gmt.tm_hour = 23;
+  gmt.tm_min = 5;
+  gmt.tm_sec = 59;
+
+  EXPECT_EQ(webcc::utility::FormatHttpDate(gmt),
+            "Thu, 29 Feb 2024 23:05:59 GMT");
+}
+
+TEST(UtilityTest, CurrentHttpDate) {
+  std::string_view date = webcc::utility::CurrentHttpDate();
+
+  EXPECT_EQ(date.size(), webcc::utility::kHttpDateSize);
+  EXPECT_EQ(date.substr(3, 2), ", ");
+  EXPECT_EQ(date.substr(date.size() - 4), " GMT");
+
+  // The same until the second changes.
+  std::string http_date = webcc::utility::HttpDate();
+  EXPECT_EQ(http_date.size(), webcc::utility::kHttpDateSize);
+}
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+
+#include "webcc/websocket.h"
+
+namespace ws = webcc::websocket;
+
+TEST(WebSocketTest, AcceptKey) {
+  // The example of RFC 6455.
+  EXPECT_EQ("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=",
+            ws::AcceptKey("dGhlIHNhbXBsZSBub25jZQ=="));
+}
+
+// The masked "Hello" of RFC 6455, section 5.7.
+static const char kMaskedHello[] =
+    "\x81\x85\x37\xfa\x21\x3d" "\x7f\x9f\x4d\x51\x58";
+
+TEST(WebSocketTest, ParseFrame) {
+  std::string data{ kMaskedHello, sizeof(kMaskedHello) - 1 };
+
+  ws::Frame frame;
+  std::size_t size = ws::ParseFrame(&data[0], data.size(), &frame);
+
+  EXPECT_EQ(data.size(), size);
+  EXPECT_TRUE(frame.fin);
+  EXPECT_FALSE(frame.rsv1);
+  EXPECT_EQ(ws::opcodes::kText, frame.opcode);
+  EXPECT_EQ("Hello", std::string(frame.payload, frame.length));
+}
+
+TEST(WebSocketTest, ParseFrame_Incomplete) {
+  std::string data{ kMaskedHello, sizeof(kMaskedHello) - 1 };
+
+  ws::Frame frame;
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(0, ws::ParseFrame(&data[0], i, &frame));
+  }
+}
+
+TEST(WebSocketTest, ParseFrame_NotMasked) {
+  // The unmasked "Hello", which a client must not send.
+  std::string data{ "\x81\x05Hello" };
+
+  ws::Frame frame;
+  EXPECT_EQ(webcc::kInvalidSize,
+            ws::ParseFrame(&data[0], data.size(), &frame));
+}
+
+TEST(WebSocketTest, AppendFrame) {
+  std::string output;
+  ws::AppendFrame(ws::opcodes::kText, false, "Hello", &output);
+  EXPECT_EQ(std::string("\x81\x05Hello"), output);
+
+  // 16-bit length.
+  output.clear();
+  ws::AppendFrame(ws::opcodes::kBinary, false, std::string(256, 'x'),
+                  &output);
+  EXPECT_EQ(4 + 256, output.size());
+  EXPECT_EQ(std::string("\x82\x7e\x01\x00", 4), output.substr(0, 4));
+
+  // 64-bit length.
+  output.clear();
+  ws::AppendFrame(ws::opcodes::kBinary, false, std::string(65536, 'x'),
+                  &output);
+  EXPECT_EQ(10 + 65536, output.size());
+  EXPECT_EQ(std::string("\x82\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10),
+            output.substr(0, 10));
+}
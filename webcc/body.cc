@@ -1,5 +1,7 @@
 #include "webcc/body.h"
 
+#include <sstream>
+
 #include "boost/core/ignore_unused.hpp"
 
 #include "webcc/internal/globals.h"
@@ -109,11 +111,34 @@ void FormBody::Dump(std::ostream& os, std::string_view prefix) const {
 
 void FormBody::InitPayload() {
   index_ = 0;
+
+  if (ifstream_.is_open()) {
+    ifstream_.close();
+  }
 }
 
 Payload FormBody::NextPayload(bool free_previous) {
+  using boost::asio::buffer;
+
   Payload payload;
 
+  // Go on with the data of the file part.
+  if (ifstream_.is_open()) {
+    if (ifstream_.read(&chunk_[0], chunk_.size()).gcount() > 0) {
+      return Payload{ buffer(chunk_.data(),
+                             static_cast<std::size_t>(ifstream_.gcount())) };
+    }
+
+    ifstream_.close();
+
+    payload.push_back(buffer(literal_buffers::CRLF));
+
+    if (index_ == parts_.size()) {
+      AddBoundaryEnd(&payload);
+    }
+    return payload;
+  }
+
   // Free previous payload.
   if (free_previous) {
     if (index_ > 0) {
@@ -125,6 +150,21 @@ Payload FormBody::NextPayload(bool free_previous) {
     AddBoundary(&payload);
     parts_[index_]->Prepare(&payload);
 
+    sfs::path path = parts_[index_]->GetFilePath();
+    if (!path.empty()) {
+      // The data will be read in the next calls.
+      ifstream_.open(path, std::ios::binary);
+      if (ifstream_.fail()) {
+        throw Error{ error_codes::kFileError, "Cannot read the file" };
+      }
+      chunk_.resize(kFileChunkSize);
+
+      ++index_;
+      return payload;
+    }
+
+    payload.push_back(buffer(literal_buffers::CRLF));
+
     if (index_ + 1 == parts_.size()) {
       AddBoundaryEnd(&payload);
     }
@@ -210,7 +250,7 @@ Payload FileBody::NextPayload(bool free_previous) {
 }
 
 void FileBody::Dump(std::ostream& os, std::string_view prefix) const {
-  os << prefix << "<file: " << path_.u8string() << ">" << std::endl;
+  os << prefix << "<file: " << utility::PathToUtf8(path_) << ">" << std::endl;
 }
 
 bool FileBody::Move(const sfs::path& new_path) {
@@ -225,6 +265,15 @@ bool FileBody::Move(const sfs::path& new_path) {
   std::error_code ec;
   sfs::rename(path_, new_path, ec);
 
+  if (ec == std::errc::cross_device_link) {
+    // E.g., from the temp directory on another file system.
+    if (sfs::copy_file(path_, new_path, sfs::copy_options::overwrite_existing,
+                       ec)) {
+      sfs::remove(path_, ec);
+      ec.clear();
+    }
+  }
+
   if (ec) {
     LOG_ERRO("Failed to rename file (%s).", ec.message().c_str());
     return false;
@@ -236,4 +285,58 @@ bool FileBody::Move(const sfs::path& new_path) {
   return true;
 }
 
+// -----------------------------------------------------------------------------
+
+Payload StreamBody::NextPayload(bool free_previous) {
+  boost::ignore_unused(free_previous);
+
+  using boost::asio::buffer;
+
+  // The last chunk and the empty trailer.
+  static const char kLastChunk[] = "0\r\n\r\n";
+
+  if (finished_) {
+    return {};
+  }
+
+  data_.clear();
+
+  // Skip the empty pieces, an empty payload indicates the end.
+  while (data_.empty() && !ended_) {
+    ended_ = !generator_(&data_);
+    if (async_) {
+      break;
+    }
+  }
+
+  Payload payload;
+
+  if (!data_.empty()) {
+    if (chunked_) {
+      std::ostringstream ss;
+      ss << std::hex << data_.size() << "\r\n";
+      chunk_size_ = ss.str();
+
+      payload.push_back(buffer(chunk_size_));
+      payload.push_back(buffer(data_));
+      payload.push_back(buffer(literal_buffers::CRLF));
+    } else {
+      payload.push_back(buffer(data_));
+    }
+  }
+
+  if (ended_) {
+    finished_ = true;
+    if (chunked_) {
+      payload.push_back(buffer(kLastChunk, sizeof(kLastChunk) - 1));
+    }
+  }
+
+  return payload;
+}
+
+void StreamBody::Dump(std::ostream& os, std::string_view prefix) const {
+  os << prefix << "<stream>" << std::endl;
+}
+
 }  // namespace webcc
@@ -2,10 +2,13 @@
 #define WEBCC_BODY_H_
 
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 
+#include "boost/asio/any_io_executor.hpp"
+
 #include "webcc/common.h"
 
 namespace webcc {
@@ -51,11 +54,28 @@ public:
   }
 
   // Get the next payload.
-  // Returning an empty payload indicates the end.
+  // Returning an empty payload indicates the end, unless WaitPayload() tells
+  // otherwise.
   virtual Payload NextPayload(bool free_previous = false) {
     return {};
   }
 
+  // For a body produced asynchronously (e.g., server-sent events), the empty
+  // payload might mean there's nothing for now instead of the end. If so,
+  // return true and call `notify` once, from any thread, when NextPayload()
+  // should be called again. The timers of the body, if any, could run on the
+  // `executor` of the connection.
+  virtual bool WaitPayload(const boost::asio::any_io_executor& executor,
+                           std::function<void()> notify) {
+    return false;
+  }
+
+  // The body won't be written any more, e.g., the connection has been closed
+  // or the write has failed. A body produced asynchronously should stop
+  // producing and tell its producer, and drop the `notify` waiting, if any.
+  virtual void Detach() {
+  }
+
   // Dump to output stream for logging purpose.
   virtual void Dump(std::ostream& os, std::string_view prefix) const {
   }
@@ -118,6 +138,8 @@ using StringBodyPtr = std::shared_ptr<StringBody>;
 // -----------------------------------------------------------------------------
 
 // Multi-part form body for request.
+// The data of a file part is read from the file piece by piece as it's being
+// sent, instead of being loaded into the memory.
 class FormBody : public Body {
 public:
   FormBody(const std::vector<FormPartPtr>& parts, const std::string& boundary);
@@ -148,6 +170,11 @@ private:
 
   // Index for iterating the payload.
   std::size_t index_ = 0;
+
+  // The file of the part being sent (i.e., parts_[index_ - 1]), if any, and
+  // the piece just read from it.
+  std::ifstream ifstream_;
+  std::string chunk_;
 };
 
 using FormBodyPtr = std::shared_ptr<FormBody>;
@@ -207,6 +234,67 @@ private:
 
 using FileBodyPtr = std::shared_ptr<FileBody>;
 
+// -----------------------------------------------------------------------------
+
+// Body produced piece by piece by a generator as it's being sent, so that a
+// large body (e.g., an export) needn't be built in memory first.
+// The size is unknown (kInvalidSize) until the end, so the body is sent with
+// the chunked transfer coding over HTTP/1.1 (see set_chunked()), or as it is
+// over HTTP/2.
+// NOTE: The generator is called in the thread of the connection, one piece
+// after the previous one has been written. The body can be sent only once.
+class StreamBody : public Body {
+public:
+  // Produce the next piece of data into `data` (empty when called).
+  // Return false at the end, `data` is still sent if not empty.
+  using Generator = std::function<bool(std::string* data)>;
+
+  explicit StreamBody(Generator generator) : generator_(std::move(generator)) {
+  }
+
+  ~StreamBody() override = default;
+
+  std::size_t GetSize() const override {
+    return kInvalidSize;
+  }
+
+  // Encode the pieces with the chunked transfer coding.
+  void set_chunked(bool chunked) {
+    chunked_ = chunked;
+  }
+
+  // Has the last payload been returned?
+  bool finished() const {
+    return finished_;
+  }
+
+  Payload NextPayload(bool free_previous = false) override;
+
+  void Dump(std::ostream& os, std::string_view prefix) const override;
+
+protected:
+  // Set by a subclass producing the pieces asynchronously, whose generator
+  // returns true with empty data when there's nothing for now. The empty
+  // payload is then returned instead of calling the generator again (see
+  // WaitPayload()).
+  bool async_ = false;
+
+private:
+  Generator generator_;
+
+  bool chunked_ = false;
+
+  // The generator has told the end, and the last payload has been returned.
+  bool ended_ = false;
+  bool finished_ = false;
+
+  // The last piece and its chunk-size line.
+  std::string data_;
+  std::string chunk_size_;
+};
+
+using StreamBodyPtr = std::shared_ptr<StreamBody>;
+
 }  // namespace webcc
 
 #endif  // WEBCC_BODY_H_
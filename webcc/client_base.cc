@@ -99,6 +99,9 @@ void ClientBase::Send(RequestPtr request, bool stream) {
 
   request_ = request;
   response_.reset(new Response{});
+
+  // A body produced as it's being sent is encoded in chunks.
+  request_->SetChunked();
   response_parser_.Init(response_.get(), stream);
 
   if (buffer_.size() != buffer_size_) {
@@ -231,6 +231,8 @@ void ClientSession::AddSslContext(const std::string& key,
 void ClientSession::Stop() {
   LOG_INFO("Stop client session...");
 
+  CloseHttp2Clients();
+
   mutex_.lock();
   if (current_client_ != nullptr) {
     // Remove from pool (it might not be in the pool).
@@ -258,6 +260,8 @@ void ClientSession::Stop() {
 }
 
 bool ClientSession::Cancel() {
+  bool canceled = CloseHttp2Clients();
+
   std::lock_guard<std::mutex> lock{ mutex_ };
 
   if (current_client_ != nullptr) {
@@ -266,7 +270,7 @@ bool ClientSession::Cancel() {
     return true;
   }
 
-  return false;
+  return canceled;
 }
 
 ResponsePtr ClientSession::Send(RequestPtr request, bool stream,
@@ -288,6 +292,10 @@ ResponsePtr ClientSession::Send(RequestPtr request, bool stream,
 
   const std::string key = ClientKeyFromUrl(request->url());
 
+  if (auto response = SendHttp2(key, request, stream, callback)) {
+    return response;
+  }
+
   // Reuse a pooled connection.
   bool reuse = false;
 
@@ -383,4 +391,91 @@ ClientPtr ClientSession::CreateClient(const std::string& url_scheme) {
   return {};
 }
 
+ResponsePtr ClientSession::SendHttp2(const std::string& key,
+                                     RequestPtr request, bool stream,
+                                     ProgressCallback callback) {
+  const std::string& url_scheme = request->url().scheme();
+
+  if (!(http2_ && boost::iequals(url_scheme, "https")) &&
+      !(http2_prior_knowledge_ && boost::iequals(url_scheme, "http"))) {
+    return {};
+  }
+
+  // Try a new connection once if the connection is going away.
+  for (int i = 0; i < 2; ++i) {
+    Http2ClientPtr client = GetHttp2Client(key, request);
+    if (client == nullptr) {
+      return {};
+    }
+
+    auto response = client->Send(request, stream, callback);
+    if (response != nullptr) {
+      return response;
+    }
+
+    if (client->unsupported()) {
+      LOG_INFO("Use HTTP/1.1 for %s", key.c_str());
+
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      http1_servers_.insert(key);
+      return {};
+    }
+  }
+
+  throw Error{ error_codes::kStateError, "HTTP/2 connection going away" };
+}
+
+Http2ClientPtr ClientSession::GetHttp2Client(const std::string& key,
+                                             RequestPtr request) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+
+  if (http1_servers_.count(key) != 0) {
+    return {};
+  }
+
+  auto iter = http2_clients_.find(key);
+  if (iter != http2_clients_.end()) {
+    if (!iter->second->closed()) {
+      LOG_INFO("Reuse an existing HTTP/2 connection");
+      return iter->second;
+    }
+
+    iter->second->Close();
+    http2_clients_.erase(iter);
+  }
+
+  Http2ClientPtr client;
+
+  if (boost::iequals(request->url().scheme(), "https")) {
+    auto pair = SSL_CONTEXT_MANAGER->Get(ssl_context_key_);
+    client = std::make_shared<SslHttp2Client>(*pair.first, pair.second);
+  } else {
+    client = std::make_shared<Http2Client>();
+  }
+
+  client->set_connect_timeout(connect_timeout_);
+  client->set_read_timeout(read_timeout_);
+  client->set_subsequent_read_timeout(subsequent_read_timeout_);
+
+  client->Connect(request->host(), request->port());
+
+  http2_clients_[key] = client;
+
+  return client;
+}
+
+bool ClientSession::CloseHttp2Clients() {
+  std::map<std::string, Http2ClientPtr> clients;
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    clients.swap(http2_clients_);
+  }
+
+  for (auto& pair : clients) {
+    pair.second->Close();
+  }
+
+  return !clients.empty();
+}
+
 }  // namespace webcc
@@ -1,14 +1,17 @@
 #ifndef WEBCC_CLIENT_SESSION_H_
 #define WEBCC_CLIENT_SESSION_H_
 
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 
 #include "boost/asio/io_context.hpp"
 #include "boost/asio/ssl/context.hpp"
 
 #include "webcc/client_pool.h"
+#include "webcc/http2_client.h"
 #include "webcc/request_builder.h"
 #include "webcc/response.h"
 
@@ -18,7 +21,9 @@ using SslContextPtr = std::shared_ptr<boost::asio::ssl::context>;
 
 // Client session provides connection-pooling, configuration and more.
 // If a client session is shared by multiple threads, the requests sent through
-// it will be serialized by using a mutex.
+// it will be serialized by using a mutex, except for the requests sent over
+// HTTP/2 (see set_http2()), which are multiplexed over a single connection to
+// each server.
 class ClientSession {
 public:
   // Add a certificate to the SSL context with the given key.
@@ -79,6 +84,18 @@ public:
     buffer_size_ = buffer_size;
   }
 
+  // Use HTTP/2 for HTTPS if the server supports it (negotiated by ALPN),
+  // otherwise HTTP/1.1 is used.
+  void set_http2(bool http2) {
+    http2_ = http2;
+  }
+
+  // Use HTTP/2 for HTTP without negotiation (h2c with prior knowledge). The
+  // server must support it.
+  void set_http2_prior_knowledge(bool http2_prior_knowledge) {
+    http2_prior_knowledge_ = http2_prior_knowledge;
+  }
+
   void SetHeader(std::string_view key, std::string_view value) {
     headers_.Set(key, value);
   }
@@ -154,6 +171,19 @@ private:
   // Create a client object according to the URL scheme.
   ClientPtr CreateClient(const std::string& url_scheme);
 
+  // Send the request over HTTP/2 if possible.
+  // Return null if the request should be sent over HTTP/1.1.
+  ResponsePtr SendHttp2(const std::string& key, RequestPtr request, bool stream,
+                        ProgressCallback callback);
+
+  // Get the HTTP/2 connection to the server of the request, connect a new one
+  // if necessary.
+  Http2ClientPtr GetHttp2Client(const std::string& key, RequestPtr request);
+
+  // Close the HTTP/2 connections.
+  // Return if any connection has been closed.
+  bool CloseHttp2Clients();
+
 private:
   boost::asio::io_context io_context_;
 
@@ -195,6 +225,15 @@ private:
 
   // Current requesting client.
   ClientPtr current_client_;
+
+  bool http2_ = false;
+  bool http2_prior_knowledge_ = false;
+
+  // HTTP/2 connections, one for each server, guarded by `mutex_`.
+  std::map<std::string, Http2ClientPtr> http2_clients_;
+
+  // The servers which don't support HTTP/2, guarded by `mutex_`.
+  std::set<std::string> http1_servers_;
 };
 
 }  // namespace webcc
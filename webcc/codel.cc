@@ -0,0 +1,60 @@
+#include "webcc/codel.h"
+
+namespace webcc {
+
+Codel::Codel(int target_delay, int interval) {
+  Reset(target_delay, interval);
+}
+
+void Codel::Reset(int target_delay, int interval) {
+  target_delay_ = boost::asio::chrono::milliseconds(target_delay);
+  interval_ = boost::asio::chrono::milliseconds(interval);
+
+  interval_end_.store(0, std::memory_order_relaxed);
+  min_delay_.store(0, std::memory_order_relaxed);
+  reset_delay_.store(true, std::memory_order_relaxed);
+  overloaded_.store(false, std::memory_order_relaxed);
+}
+
+bool Codel::Overloaded(Clock::duration delay, Clock::time_point now) {
+  Clock::duration min_delay{ min_delay_.load(std::memory_order_relaxed) };
+
+  // At the end of the interval, tell if the queue is overloaded by the minimum
+  // delay of the interval. Only one thread gets here for an interval.
+  if (now.time_since_epoch().count() >
+          interval_end_.load(std::memory_order_acquire) &&
+      !reset_delay_.load(std::memory_order_acquire) &&
+      !reset_delay_.exchange(true)) {
+    interval_end_.store((now + interval_).time_since_epoch().count(),
+                        std::memory_order_release);
+    overloaded_.store(min_delay > target_delay_, std::memory_order_relaxed);
+  }
+
+  // Start tracking the minimum delay for the new interval.
+  // Only one thread resets it, after the end of the interval has been updated.
+  if (reset_delay_.load(std::memory_order_acquire) &&
+      reset_delay_.exchange(false)) {
+    min_delay_.store(delay.count(), std::memory_order_relaxed);
+
+    // Start the very first interval.
+    Clock::rep zero = 0;
+    interval_end_.compare_exchange_strong(
+        zero, (now + interval_).time_since_epoch().count());
+
+    // Never drop the first request of an interval.
+    return false;
+  }
+
+  if (delay < min_delay) {
+    // Racy but good enough, a missed update only makes the minimum a little
+    // larger for this interval.
+    min_delay_.store(delay.count(), std::memory_order_relaxed);
+  }
+
+  // Instead of dropping the requests at an increasing rate as CoDel does for
+  // packets, drop all requests which have waited too long while overloaded.
+  return overloaded_.load(std::memory_order_relaxed) &&
+         delay > 2 * target_delay_;
+}
+
+}  // namespace webcc
@@ -0,0 +1,62 @@
+#ifndef WEBCC_CODEL_H_
+#define WEBCC_CODEL_H_
+
+// Controlled Delay (CoDel) for the requests waiting in the queue.
+// The idea comes from the CoDel of the network queues (RFC 8289), adapted the
+// way of Facebook's folly::Codel for server request queues: if the minimum
+// queueing delay seen during an interval is above the target delay, the queue
+// is considered overloaded (a standing queue), and the requests which have
+// waited more than twice the target delay are dropped, until the minimum
+// delay goes down again.
+// A queue which absorbs a short burst is not overloaded since the minimum
+// delay of the interval remains low.
+
+#include <atomic>
+
+#include "boost/asio/detail/chrono.hpp"
+
+namespace webcc {
+
+class Codel {
+public:
+  using Clock = boost::asio::chrono::steady_clock;
+
+  // The target delay and the interval are in milliseconds.
+  explicit Codel(int target_delay = 5, int interval = 100);
+
+  Codel(const Codel&) = delete;
+  Codel& operator=(const Codel&) = delete;
+
+  // Reset with a new target delay and interval.
+  // NOTE: Not thread safe, call it only when the queue is not in use.
+  void Reset(int target_delay, int interval);
+
+  // Return true if the request, having waited in the queue for `delay`, should
+  // be dropped.
+  // Thread safe, it's called by the workers for each request popped.
+  bool Overloaded(Clock::duration delay) {
+    return Overloaded(delay, Clock::now());
+  }
+
+  bool Overloaded(Clock::duration delay, Clock::time_point now);
+
+private:
+  Clock::duration target_delay_;
+  Clock::duration interval_;
+
+  // The end of the current interval, in ticks since the epoch of the clock.
+  // Zero before the first interval starts.
+  std::atomic<Clock::rep> interval_end_{ 0 };
+
+  // The minimum delay of the current interval, in ticks.
+  std::atomic<Clock::rep> min_delay_{ 0 };
+
+  // Start tracking the minimum delay for a new interval or not.
+  std::atomic_bool reset_delay_{ true };
+
+  std::atomic_bool overloaded_{ false };
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_CODEL_H_
@@ -4,6 +4,7 @@
 
 #include "boost/algorithm/string.hpp"
 
+#include "webcc/body.h"
 #include "webcc/internal/globals.h"
 #include "webcc/logger.h"
 #include "webcc/string.h"
@@ -15,29 +16,149 @@ namespace literal_buffers = internal::literal_buffers;
 
 // -----------------------------------------------------------------------------
 
+namespace {
+
+// FNV-1a of the name in lower case.
+std::size_t HashHeaderName(std::string_view name) {
+  std::uint32_t hash = 2166136261u;
+  for (char c : name) {
+    if (c >= 'A' && c <= 'Z') {
+      c += 'a' - 'A';
+    }
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+}  // namespace
+
+Headers::Headers(const Headers& rhs) {
+  *this = rhs;
+}
+
+Headers& Headers::operator=(const Headers& rhs) {
+  if (this != &rhs) {
+    Clear();
+    for (const HeaderView& header : rhs.headers_) {
+      Set(header.first, header.second);
+    }
+  }
+  return *this;
+}
+
 bool Headers::Set(std::string_view key, std::string_view value) {
   if (key.empty() || value.empty()) {
     return false;
   }
 
-  auto iter = Find(key);
-  if (iter != headers_.end()) {
-    iter->second = value;
+  HeaderId id = GetHeaderId(key);
+  std::size_t index = Find(id, key);
+
+  if (index != kInvalidSize) {
+    // Reuse the copy of the old value, if any.
+    std::uint32_t& value_copy = value_copies_[index];
+    if (value_copy != 0) {
+      std::string& copy = copies_[value_copy - 1];
+      copy = value;
+      headers_[index].second = copy;
+    } else {
+      headers_[index].second = Copy(value);
+      value_copy = static_cast<std::uint32_t>(copies_.size());
+    }
   } else {
-    headers_.emplace_back(key, value);
+    std::string_view key_copy = Copy(key);
+    std::string_view value_copy = Copy(value);
+    Add(id, key_copy, value_copy, static_cast<std::uint32_t>(copies_.size()));
   }
 
   return true;
 }
 
-std::vector<Header>::iterator Headers::Find(std::string_view key) {
-  auto iter = headers_.begin();
-  for (; iter != headers_.end(); ++iter) {
-    if (boost::iequals(iter->first, key)) {
-      break;
+bool Headers::SetView(HeaderId id, std::string_view key,
+                      std::string_view value) {
+  if (key.empty() || value.empty()) {
+    return false;
+  }
+
+  std::size_t index = Find(id, key);
+  if (index != kInvalidSize) {
+    // The copy of the old value, if any, is kept for the next Set().
+    headers_[index].second = value;
+  } else {
+    Add(id, key, value, 0);
+  }
+
+  return true;
+}
+
+void Headers::Clear() {
+  headers_.clear();
+  copies_.clear();
+  value_copies_.clear();
+  known_.fill(0);
+  others_.clear();
+  others_count_ = 0;
+}
+
+std::size_t Headers::Find(HeaderId id, std::string_view key) const {
+  if (id != HeaderId::kUnknown) {
+    std::size_t slot = known_[static_cast<std::size_t>(id)];
+    return slot != 0 ? slot - 1 : kInvalidSize;
+  }
+
+  if (others_.empty()) {
+    return kInvalidSize;
+  }
+
+  const std::size_t mask = others_.size() - 1;
+  for (std::size_t i = HashHeaderName(key) & mask;; i = (i + 1) & mask) {
+    std::size_t slot = others_[i];
+    if (slot == 0) {
+      return kInvalidSize;
+    }
+    if (IEquals(headers_[slot - 1].first, key)) {
+      return slot - 1;
+    }
+  }
+}
+
+void Headers::Add(HeaderId id, std::string_view key, std::string_view value,
+                  std::uint32_t value_copy) {
+  headers_.emplace_back(key, value);
+  value_copies_.push_back(value_copy);
+
+  if (id != HeaderId::kUnknown) {
+    known_[static_cast<std::size_t>(id)] =
+        static_cast<std::uint32_t>(headers_.size());
+    return;
+  }
+
+  // Keep the load factor no more than 1/2.
+  if ((others_count_ + 1) * 2 > others_.size()) {
+    others_.assign(others_.empty() ? 8 : others_.size() * 2, 0);
+    others_count_ = 0;
+    for (std::size_t i = 0; i + 1 < headers_.size(); ++i) {
+      if (GetHeaderId(headers_[i].first) == HeaderId::kUnknown) {
+        IndexOther(i);
+      }
     }
   }
-  return iter;
+
+  IndexOther(headers_.size() - 1);
+}
+
+void Headers::IndexOther(std::size_t index) {
+  const std::size_t mask = others_.size() - 1;
+  std::size_t i = HashHeaderName(headers_[index].first) & mask;
+  while (others_[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  others_[i] = static_cast<std::uint32_t>(index + 1);
+  ++others_count_;
+}
+
+std::string_view Headers::Copy(std::string_view str) {
+  return copies_.emplace_back(str);
 }
 
 // -----------------------------------------------------------------------------
@@ -195,12 +316,6 @@ FormPartPtr FormPart::NewFile(std::string_view name, const sfs::path& path,
 void FormPart::Prepare(Payload* payload) {
   using boost::asio::buffer;
 
-  if (data_.empty() && !path_.empty()) {
-    if (!utility::ReadFile(path_, &data_)) {
-      throw Error{ error_codes::kFileError, "Cannot read the file" };
-    }
-  }
-
   // NOTE:
   // The payload buffers don't own the memory.
   // It depends on some existing variables/objects to keep the memory.
@@ -210,7 +325,7 @@ void FormPart::Prepare(Payload* payload) {
     SetHeaders();
   }
 
-  for (const Header& h : headers_.data()) {
+  for (const HeaderView& h : headers_.data()) {
     payload->push_back(buffer(h.first));
     payload->push_back(buffer(literal_buffers::HEADER_SEPARATOR));
     payload->push_back(buffer(h.second));
@@ -222,8 +337,13 @@ void FormPart::Prepare(Payload* payload) {
   if (!data_.empty()) {
     payload->push_back(buffer(data_));
   }
+}
 
-  payload->push_back(buffer(literal_buffers::CRLF));
+sfs::path FormPart::GetFilePath() const {
+  if (!data_.empty()) {
+    return {};
+  }
+  return file_body_ ? file_body_->path() : path_;
 }
 
 void FormPart::Free() {
@@ -240,7 +360,7 @@ std::size_t FormPart::GetSize() {
 
   constexpr std::size_t CRLF_SIZE = sizeof(literal_buffers::CRLF);
 
-  for (const Header& h : headers_.data()) {
+  for (const HeaderView& h : headers_.data()) {
     size += h.first.size();
     size += sizeof(literal_buffers::HEADER_SEPARATOR);
     size += h.second.size();
@@ -259,7 +379,7 @@ std::size_t FormPart::GetDataSize() {
     return data_.size();
   }
 
-  std::size_t size = utility::TellSize(path_);
+  std::size_t size = utility::TellSize(GetFilePath());
   if (size == kInvalidSize) {
     throw Error{ error_codes::kFileError, "Cannot read the file" };
   }
@@ -268,14 +388,16 @@ std::size_t FormPart::GetDataSize() {
 }
 
 void FormPart::Dump(std::ostream& os, std::string_view prefix) const {
-  for (const Header& h : headers_.data()) {
+  for (const HeaderView& h : headers_.data()) {
     os << prefix << h.first << ": " << h.second << std::endl;
   }
 
   os << prefix << std::endl;
 
-  if (!path_.empty()) {
-    os << prefix << "<file: " << path_.u8string() << ">" << std::endl;
+  if (file_body_) {
+    file_body_->Dump(os, prefix);
+  } else if (!path_.empty()) {
+    os << prefix << "<file: " << utility::PathToUtf8(path_) << ">" << std::endl;
   } else {
     utility::DumpByLine(data_, os, prefix);
   }
@@ -305,7 +427,7 @@ void FormPart::SetHeaders() {
     }
 #else
     // Always use UTF-8 on UNIX-like systems.
-    file_name_str = file_name_.u8string();
+    file_name_str = utility::PathToUtf8(file_name_);
     is_utf8 = true;
 #endif  // _WIN32 
 
@@ -1,8 +1,13 @@
 #ifndef WEBCC_COMMON_H_
 #define WEBCC_COMMON_H_
 
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -14,8 +19,28 @@ namespace webcc {
 
 using Header = std::pair<std::string, std::string>;
 
+// A header referring to the data kept elsewhere.
+using HeaderView = std::pair<std::string_view, std::string_view>;
+
+// The headers refer to either the copies kept by them (see Set()), or the data
+// kept by the owner (see SetView()), e.g., the header block of a message
+// received, so that the headers parsed are not copied one by one.
+// The headers are kept in the order added, and indexed by the names: the
+// well-known ones (see HeaderId) by the IDs, the others by a small hash table.
+// So a header is found in O(1), instead of comparing the names one by one.
 class Headers {
 public:
+  Headers() = default;
+
+  // A deep copy, whose headers all refer to the copies kept by itself, even
+  // if the headers copied refer to the data kept by others.
+  Headers(const Headers& rhs);
+  Headers& operator=(const Headers& rhs);
+
+  // The copies are moved as they are, with their addresses unchanged.
+  Headers(Headers&&) = default;
+  Headers& operator=(Headers&&) = default;
+
   std::size_t size() const {
     return headers_.size();
   }
@@ -24,15 +49,26 @@ public:
     return headers_.empty();
   }
 
-  const std::vector<Header>& data() const {
+  const std::vector<HeaderView>& data() const {
     return headers_;
   }
 
+  // Set a header with the copies of `key` and `value`.
   // Return false if either `key` or `value` is empty.
   bool Set(std::string_view key, std::string_view value);
 
+  // Set a header referring to `key` and `value`, which must outlive the
+  // headers.
+  // Return false if either `key` or `value` is empty.
+  bool SetView(std::string_view key, std::string_view value) {
+    return SetView(GetHeaderId(key), key, value);
+  }
+
+  // The same as above, with the ID of `key` got already.
+  bool SetView(HeaderId id, std::string_view key, std::string_view value);
+
   // Get header by index.
-  const Header& Get(std::size_t index) const {
+  const HeaderView& Get(std::size_t index) const {
     assert(index < size());
     return headers_[index];
   }
@@ -40,25 +76,57 @@ public:
   // Get header by key.
   // Return empty if there's no such header with the given key
   std::string_view Get(std::string_view key) const {
-    auto it = Find(key);
-    if (it != headers_.end()) {
-      return it->second;
-    }
-    return std::string_view{};
+    return Get(GetHeaderId(key), key);
   }
 
-  void Clear() {
-    headers_.clear();
+  // Get a well-known header by ID.
+  // Return empty if there's no such header.
+  std::string_view Get(HeaderId id) const {
+    assert(id != HeaderId::kUnknown);
+    std::size_t slot = known_[static_cast<std::size_t>(id)];
+    return slot != 0 ? headers_[slot - 1].second : std::string_view{};
   }
 
-private:
-  std::vector<Header>::iterator Find(std::string_view key);
+  void Clear();
 
-  std::vector<Header>::const_iterator Find(std::string_view key) const {
-    return const_cast<Headers*>(this)->Find(key);
+private:
+  std::string_view Get(HeaderId id, std::string_view key) const {
+    std::size_t index = Find(id, key);
+    return index != kInvalidSize ? headers_[index].second : std::string_view{};
   }
 
-  std::vector<Header> headers_;
+  // Return the index of the header, or kInvalidSize if not found.
+  std::size_t Find(HeaderId id, std::string_view key) const;
+
+  // Add the header to the end, and index it. `value_copy` is the index + 1 of
+  // the value in the copies, 0 if it's not a copy.
+  void Add(HeaderId id, std::string_view key, std::string_view value,
+           std::uint32_t value_copy);
+
+  // Index the other header at the given index of the headers.
+  void IndexOther(std::size_t index);
+
+  // Keep a copy of the string, whose address never changes.
+  std::string_view Copy(std::string_view str);
+
+  std::vector<HeaderView> headers_;
+
+  // The copies of the keys and values set, not moved as more are added.
+  std::deque<std::string> copies_;
+
+  // The index + 1 in the copies of the value copy of each header, 0 if none.
+  // Reused when the header is set again, so that setting the same header
+  // again and again (e.g., of a client session) doesn't pile up the copies.
+  std::vector<std::uint32_t> value_copies_;
+
+  // The index + 1 of each well-known header in the headers, 0 if absent.
+  std::array<std::uint32_t, static_cast<std::size_t>(HeaderId::kUnknown)>
+      known_{};
+
+  // The hash table (open addressing) of the other headers. Each slot is the
+  // index + 1 in the headers, 0 if empty. Allocated on the first one.
+  std::vector<std::uint32_t> others_;
+  std::size_t others_count_ = 0;
 };
 
 // -----------------------------------------------------------------------------
@@ -141,6 +209,9 @@ private:
 
 // -----------------------------------------------------------------------------
 
+class FileBody;
+using FileBodyPtr = std::shared_ptr<FileBody>;
+
 class FormPart;
 using FormPartPtr = std::shared_ptr<FormPart>;
 
@@ -205,9 +276,30 @@ public:
     data_.append(data, count);
   }
 
+  // API: SERVER
+  // The temp file to which the data of a file part (i.e., with a file name)
+  // has been streamed by the parser, instead of data(). Null for the others.
+  // The file is deleted with the body unless it's moved (see
+  // FileBody::Move()).
+  const FileBodyPtr& file_body() const {
+    return file_body_;
+  }
+
+  // API: PARSER
+  void set_file_body(FileBodyPtr file_body) {
+    file_body_ = std::move(file_body);
+  }
+
   // API: CLIENT
+  // Prepare the payload of the headers and, if it's in the memory, the data.
+  // The data of a file is read piece by piece as it's being sent instead (see
+  // GetFilePath() and FormBody).
   void Prepare(Payload* payload);
 
+  // The file from which the data is read as it's being sent.
+  // Empty if the data is in the memory.
+  sfs::path GetFilePath() const;
+
   // Free the memory of the data.
   void Free();
 
@@ -249,6 +341,9 @@ private:
   Headers headers_;
 
   std::string data_;
+
+  // See file_body().
+  FileBodyPtr file_body_;
 };
 
 }  // namespace webcc
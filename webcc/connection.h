@@ -8,10 +8,10 @@ namespace webcc {
 class Connection : public ConnectionBase {
 public:
   Connection(boost::asio::io_context& io_context, ConnectionPool* pool,
-             Queue<ConnectionPtr>* queue, ViewMatcher&& view_matcher,
+             RequestHandler&& request_handler, ViewMatcher&& view_matcher,
              std::size_t buffer_size)
-      : ConnectionBase(io_context, pool, queue, std::move(view_matcher),
-                       buffer_size),
+      : ConnectionBase(io_context, pool, std::move(request_handler),
+                       std::move(view_matcher), buffer_size),
         socket_(io_context) {
   }
 
@@ -27,6 +27,14 @@ public:
     AsyncRead();
   }
 
+  void Reset() override {
+    ConnectionBase::Reset();
+
+    // The socket has been closed, just in case.
+    boost::system::error_code ec;
+    socket_.close(ec);
+  }
+
 protected:
   void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
                   AsyncRWHandler&& handler) override;
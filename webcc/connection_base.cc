@@ -1,29 +1,110 @@
 #include "webcc/connection_base.h"
 
+#include <atomic>
+
+#include "boost/algorithm/string/predicate.hpp"
+#include "boost/asio/post.hpp"
 #include "boost/asio/write.hpp"
 
 #include "webcc/connection_pool.h"
+#include "webcc/http2_connection.h"
 #include "webcc/internal/globals.h"
 #include "webcc/logger.h"
-#include "webcc/utility.h"  // for utility::HttpDate()
+#include "webcc/websocket.h"
 
 using boost::asio::ip::tcp;
 using namespace std::placeholders;
 
 namespace webcc {
 
+namespace {
+
+// Is the body of the response written in one payload?
+// E.g., a file body is read chunk by chunk into the same buffer instead.
+bool IsBodyInMemory(const Response& response) {
+  const BodyPtr& body = response.body();
+  return body->IsEmpty() || dynamic_cast<StringBody*>(body.get()) != nullptr;
+}
+
+}  // namespace
+
 ConnectionBase::ConnectionBase(boost::asio::io_context& io_context,
                                ConnectionPool* pool,
-                               Queue<ConnectionPtr>* queue,
+                               RequestHandler&& request_handler,
                                ViewMatcher&& view_matcher,
-                               std::size_t buffer_size)
+                               std::size_t buffer_size,
+                               std::shared_ptr<std::atomic_bool> peer_closed)
     : pool_(pool),
-      queue_(queue),
+      request_handler_(std::move(request_handler)),
       view_matcher_(std::move(view_matcher)),
-      buffer_(buffer_size) {
+      buffer_(buffer_size),
+      peer_closed_(std::move(peer_closed)) {
+  if (!peer_closed_) {
+    peer_closed_ = std::make_shared<std::atomic_bool>(false);
+  }
+}
+
+void ConnectionBase::DetachResponses() {
+  if (response_ != nullptr) {
+    response_->body()->Detach();
+  }
+  for (auto& response : writing_) {
+    response->body()->Detach();
+  }
+  for (auto& response : responses_) {
+    response->body()->Detach();
+  }
+}
+
+boost::asio::io_context& ConnectionBase::GetIoContext(SocketType& socket) {
+  return static_cast<boost::asio::io_context&>(boost::asio::query(
+      socket.get_executor(), boost::asio::execution::context));
+}
+
+void ConnectionBase::PostNotSupported(AsyncRWHandler&& handler) {
+  boost::asio::post(GetSocket().get_executor(),
+                    [handler = std::move(handler)]() {
+                      handler(boost::asio::error::operation_not_supported, 0);
+                    });
+}
+
+void ConnectionBase::Reset() {
+  request_.reset();
+  address_.clear();
+
+  unparsed_offset_ = 0;
+  unparsed_length_ = 0;
+
+  responses_.clear();
+  writing_.clear();
+  response_.reset();
+  closing_ = false;
+
+  // The requests of the previous client might still hold the old one.
+  peer_closed_ = std::make_shared<std::atomic_bool>(false);
+  watching_peer_ = false;
+
+  http2_.reset();
+
+  upgrading_ = false;
+  websocket_.reset();
+
+  // NOTE: The buffer is kept for reuse.
 }
 
 void ConnectionBase::Close() {
+  // The responses won't be written any more. E.g., an event stream tells the
+  // view that the client has gone away, instead of queuing the events.
+  DetachResponses();
+
+  if (http2_ != nullptr) {
+    http2_->Close();
+  }
+
+  if (websocket_ != nullptr) {
+    websocket_->PostAbort();
+  }
+
   LOG_INFO("Shut down and close socket...");
 
   // Initiate graceful connection closure.
@@ -48,19 +129,59 @@ void ConnectionBase::Close() {
 void ConnectionBase::SendResponse(ResponsePtr response, bool no_keep_alive) {
   assert(response != nullptr);
 
-  response_ = response;
+  if (request_->IsCanceled()) {
+    LOG_INFO("The client has gone away, drop the response");
+    PostClose();
+    return;
+  }
+
+  // The end of a body produced as it's being sent (see StreamBody) is told by
+  // the chunked transfer coding, or by closing the connection for an HTTP/1.0
+  // client which doesn't know the coding.
+  bool chunked = false;
+  if (response->body()->GetSize() == kInvalidSize) {
+    if (boost::ends_with(request_->start_line(), "HTTP/1.0")) {
+      no_keep_alive = true;
+    } else {
+      chunked = true;
+    }
+  }
 
-  if (!no_keep_alive && request_->IsConnectionKeepAlive()) {
-    response_->SetHeader(headers::kConnection, "Keep-Alive");
+  // The values are literals, referred to instead of copied.
+  std::string_view connection;
+  if (response->status() == status_codes::kSwitchingProtocols) {
+    // The connection switches to the protocol once the response has been
+    // written (see HandleWriteOK()).
+    connection = "Upgrade";
+    upgrading_ = true;
+  } else if (!no_keep_alive && request_->IsConnectionKeepAlive()) {
+    connection = "Keep-Alive";
   } else {
-    response_->SetHeader(headers::kConnection, "Close");
+    connection = "Close";
+    closing_ = true;
+  }
+  response->SetHeaderView(HeaderId::kConnection, headers::kConnection,
+                          connection);
+
+  response->SetDate();
+
+  if (chunked) {
+    response->SetChunked();
   }
 
-  response_->SetHeader(headers::kDate, utility::HttpDate());
+  response->Prepare();
+
+  responded_ = true;
+  responses_.push_back(response);
 
-  response_->Prepare();
+  if (batching_ && !closing_ && !upgrading_ && IsBodyInMemory(*response)) {
+    // Write it later together with the responses to the next pipelined
+    // requests (see ParseRequest()).
+    return;
+  }
 
-  AsyncWrite();
+  batching_ = false;
+  WriteResponses();
 }
 
 void ConnectionBase::SendResponse(int status, bool no_keep_alive) {
@@ -74,17 +195,104 @@ void ConnectionBase::SendResponse(int status, bool no_keep_alive) {
   SendResponse(response, no_keep_alive);
 }
 
+void ConnectionBase::PostResponse(ResponsePtr response) {
+  auto self = shared_from_this();
+  boost::asio::post(GetSocket().get_executor(), [self, response]() {
+    if (response != nullptr) {
+      self->SendResponse(response);
+    } else {
+      self->SendResponse(status_codes::kInternalServerError);
+    }
+  });
+}
+
+void ConnectionBase::PostClose() {
+  auto self = shared_from_this();
+  boost::asio::post(GetSocket().get_executor(),
+                    [self]() { self->pool_->Close(self); });
+}
+
+void ConnectionBase::WatchPeer() {
+  if (unparsed_length_ > 0) {
+    // The client has pipelined more requests and is waiting for the responses,
+    // even if it has shut down the sending side of the socket.
+    return;
+  }
+
+  if (watching_peer_.exchange(true)) {
+    return;  // Already being watched
+  }
+
+  GetSocket().async_wait(
+      tcp::socket::wait_read,
+      std::bind(&ConnectionBase::OnPeerReadable, shared_from_this(), _1));
+}
+
+void ConnectionBase::OnPeerReadable(boost::system::error_code ec) {
+  watching_peer_ = false;
+
+  if (ec) {
+    return;  // E.g., the socket has been closed (operation aborted).
+  }
+
+  // Readable but nothing to read means EOF or an error (e.g., connection
+  // reset). No read is pending while watching (see HandleWriteOK()), so the
+  // data can't have been consumed by others.
+  std::size_t available = GetSocket().available(ec);
+
+  if (ec || available == 0) {
+    LOG_INFO("The client has gone away");
+    *peer_closed_ = true;
+  }  // else: More data from the client, not closed.
+}
+
+void ConnectionBase::StartHttp2(const std::string& data) {
+  http2_ = std::make_shared<Http2Connection>(this);
+  http2_->Start(data);
+}
+
+void ConnectionBase::StartWebSocket() {
+  // The frames sent right after the opening handshake, if any.
+  std::string data{ buffer_.data() + unparsed_offset_, unparsed_length_ };
+  unparsed_length_ = 0;
+
+  // Negotiated the same way as the response (see Server::HandleWebSocket()).
+  std::string extensions;
+  int deflate_window_bits = websocket::NegotiateDeflate(
+      request_->GetHeader(headers::kSecWebSocketExtensions), &extensions);
+
+  websocket_ = std::make_shared<WebSocket>(this, deflate_window_bits);
+  websocket_->Start(data);
+}
+
 void ConnectionBase::PrepareRequest() {
-  request_.reset(new Request{});
+  // On a keep-alive connection, the last request is reused with the memory
+  // of it (the header block, the headers, the URL, etc.) if nobody else holds
+  // it any more. Otherwise a new one is created, the old one left to them.
+  if (request_ && request_.use_count() == 1) {
+    // The last holder (e.g., a worker) might have dropped it just now, see
+    // the changes of it before clearing.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    request_->Clear();
+  } else {
+    request_.reset(new Request{});
+  }
 
-  // TODO
-  boost::system::error_code ec;
-  auto endpoint = GetSocket().remote_endpoint(ec);
-  if (!ec) {
-    request_->set_address(endpoint.address().to_string());
+  request_->set_canceled_flag(peer_closed_);
+
+  if (address_.empty()) {
+    boost::system::error_code ec;
+    auto endpoint = GetSocket().remote_endpoint(ec);
+    if (!ec) {
+      address_ = endpoint.address().to_string();
+    }
   }
+  request_->set_address(address_);
 
   request_parser_.Init(request_.get(), view_matcher_);
+
+  dispatched_ = false;
+  responded_ = false;
 }
 
 void ConnectionBase::AsyncRead() {
@@ -121,53 +329,161 @@ void ConnectionBase::OnRead(boost::system::error_code ec, std::size_t length) {
     return;
   }
 
-  if (!request_parser_.Parse(buffer_.data(), length)) {
-    LOG_ERRO("Failed to parse request");
-    // Send Bad Request (400) to the client and no keep-alive.
-    SendResponse(status_codes::kBadRequest, true);
-    // Close the socket connection.
-    pool_->Close(shared_from_this());
-    return;
+  unparsed_offset_ = 0;
+  unparsed_length_ = length;
+
+  ParseRequest();
+}
+
+void ConnectionBase::ParseRequest() {
+  while (true) {
+    const char* data = buffer_.data() + unparsed_offset_;
+    if (!request_parser_.Parse(data, unparsed_length_)) {
+      if (request_parser_.body_too_large()) {
+        // Send Payload Too Large (413) without reading the body, and close
+        // the connection once it has been written.
+        SendResponse(status_codes::kPayloadTooLarge, true);
+        return;
+      }
+
+      LOG_ERRO("Failed to parse request");
+      // Send Bad Request (400) to the client and no keep-alive.
+      SendResponse(status_codes::kBadRequest, true);
+      // Close the socket connection.
+      pool_->Close(shared_from_this());
+      return;
+    }
+
+    // The data left, if any, belongs to the next pipelined request.
+    std::size_t consumed = request_parser_.consumed();
+    unparsed_offset_ += consumed;
+    unparsed_length_ -= consumed;
+
+    if (!request_parser_.finished()) {
+      // Write the responses to the previous pipelined requests, if any, while
+      // reading the rest of the request.
+      WriteResponses();
+      AsyncRead();
+      return;
+    }
+
+    if (http2_enabled_ && request_->start_line() == http2::kPrefaceStartLine) {
+      // The preface of HTTP/2 with prior knowledge, which starts like an
+      // HTTP/1 request without headers.
+      std::string data = std::string{ http2::kPrefaceStartLine } + "\r\n\r\n";
+      data.append(buffer_.data() + unparsed_offset_, unparsed_length_);
+      StartHttp2(data);
+      return;
+    }
+
+    LOG_VERB("Request:\n%s",
+             request_->Dump(internal::log_prefix::kIncoming).c_str());
+
+    if (!HandleRequest()) {
+      return;
+    }
+
+    LOG_INFO("Continue with the next pipelined request");
+    PrepareRequest();
   }
+}
 
-  if (!request_parser_.finished()) {
-    // Continue to read the request.
-    AsyncRead();
-    return;
+bool ConnectionBase::HandleRequest() {
+  ViewPtr view = request_parser_.view();
+  bool non_blocking = view != nullptr && view->NonBlocking(request_->method());
+
+  if (!non_blocking) {
+    if (!writing_.empty() || !responses_.empty()) {
+      // A worker might send the response from its own thread, so write the
+      // responses to the previous pipelined requests first. The request will
+      // be handled once they have been written (see HandleWriteOK()).
+      WriteResponses();
+      return false;
+    }
+
+    dispatched_ = true;
+
+    // The request has been read, let the handler (the server) decide how to
+    // handle it.
+    // NOTE: Don't touch the connection after this, it might be handled in
+    // another thread.
+    request_handler_(shared_from_this());
+    return false;
   }
 
-  LOG_VERB("Request:\n%s",
-           request_->Dump(internal::log_prefix::kIncoming).c_str());
+  // The server handles a non-blocking view right in this thread, normally, the
+  // response is sent before the handler returns. Hold it if there's another
+  // pipelined request to handle.
+  batching_ = unparsed_length_ > 0 &&
+              responses_.size() + 1 < kMaxPipelinedResponses;
+
+  dispatched_ = true;
+  request_handler_(shared_from_this());
 
-  // Enqueue this connection once the request has been read.
-  // Some worker thread will handle the request later.
-  queue_->Push(shared_from_this());
+  bool held = batching_ && responded_;
+  batching_ = false;
+
+  if (!held) {
+    // Either written or not responded yet (e.g., a deferred view). Don't let
+    // the responses to the previous pipelined requests wait.
+    WriteResponses();
+  }
+
+  return held;
 }
 
-void ConnectionBase::AsyncWrite() {
+void ConnectionBase::WriteResponses() {
+  if (!writing_.empty() || responses_.empty()) {
+    return;
+  }
+
 #if WEBCC_STUDY_SERVER_THREADING
-  LOG_USER("[%u] AsyncWrite()", (unsigned int)this);
+  LOG_USER("[%u] WriteResponses()", (unsigned int)this);
 #endif
 
-  LOG_VERB("Response:\n%s",
-           response_->Dump(internal::log_prefix::kOutgoing).c_str());
+  writing_.swap(responses_);
+
+  payload_.clear();
+  response_.reset();
+
+  for (const ResponsePtr& response : writing_) {
+    LOG_VERB("Response:\n%s",
+             response->Dump(internal::log_prefix::kOutgoing).c_str());
+
+    Payload headers = response->GetPayload();
+    payload_.insert(payload_.end(), headers.begin(), headers.end());
+
+    if (IsBodyInMemory(*response)) {
+      if (!response->body()->IsEmpty()) {
+        response->body()->InitPayload();
+        Payload body = response->body()->NextPayload();
+        payload_.insert(payload_.end(), body.begin(), body.end());
+      }
+    } else {
+      // Only the last one could be such a response (see SendResponse()).
+      assert(response == writing_.back());
+      response_ = response;
+    }
+  }
 
-  AsyncWrite(response_->GetPayload(), std::bind(&ConnectionBase::OnWriteHeaders,
-                                                shared_from_this(), _1, _2));
+  AsyncWrite(payload_,
+             std::bind(&ConnectionBase::OnWrite, shared_from_this(), _1, _2));
 }
 
-void ConnectionBase::OnWriteHeaders(boost::system::error_code ec,
-                                    std::size_t /*length*/) {
+void ConnectionBase::OnWrite(boost::system::error_code ec,
+                             std::size_t /*length*/) {
 #if WEBCC_STUDY_SERVER_THREADING
-  LOG_USER("[%u] OnWriteHeaders()", (unsigned int)this);
+  LOG_USER("[%u] OnWrite()", (unsigned int)this);
 #endif
 
   if (ec) {
     HandleWriteError(ec);
-  } else {
+  } else if (response_ != nullptr) {
     // Write the body payload by payload.
     response_->body()->InitPayload();
     AsyncWriteBody();
+  } else {
+    HandleWriteOK();
   }
 }
 
@@ -177,7 +493,24 @@ void ConnectionBase::AsyncWriteBody() {
   if (!payload.empty()) {
     AsyncWrite(payload, std::bind(&ConnectionBase::OnWriteBody,
                                   shared_from_this(), _1, _2));
-  } else {
+    return;
+  }
+
+  // E.g., server-sent events, wait for more.
+  // The connection is kept alive by the pool, not by the body.
+  std::weak_ptr<ConnectionBase> weak = shared_from_this();
+  auto notify = [weak]() {
+    if (auto self = weak.lock()) {
+      boost::asio::post(self->GetSocket().get_executor(), [self]() {
+        if (self->response_ != nullptr) {
+          self->AsyncWriteBody();
+        }
+      });
+    }
+  };
+
+  if (!response_->body()->WaitPayload(GetSocket().get_executor(),
+                                      std::move(notify))) {
     // No more body payload left, we're done.
     HandleWriteOK();
   }
@@ -199,19 +532,60 @@ void ConnectionBase::OnWriteBody(boost::system::error_code ec,
 void ConnectionBase::HandleWriteOK() {
   LOG_INFO("Response has been sent back");
 
-  if (request_->IsConnectionKeepAlive()) {
-    LOG_INFO("The client asked for a keep-alive connection");
+  writing_.clear();
+  response_.reset();
+
+  if (!responses_.empty()) {
+    // More responses have been queued during the writing.
+    WriteResponses();
+    return;
+  }
+
+  if (closing_) {
+    pool_->Close(shared_from_this());
+    return;
+  }
+
+  if (!responded_) {
+    // Only the responses to the previous pipelined requests have been written.
+    // The current request is still being read or handled.
+    if (request_parser_.finished() && !dispatched_ && HandleRequest()) {
+      PrepareRequest();
+      ParseRequest();
+    }
+    return;
+  }
+
+  if (watching_peer_) {
+    // Stop watching before reading the next request. No other operation is
+    // pending now, so only the wait will be canceled.
+    boost::system::error_code ec;
+    GetSocket().cancel(ec);
+  }
+
+  if (upgrading_) {
+    StartWebSocket();
+    return;
+  }
+
+  LOG_INFO("The client asked for a keep-alive connection");
+  PrepareRequest();
+
+  if (unparsed_length_ > 0) {
+    LOG_INFO("Continue with the next pipelined request");
+    ParseRequest();
+  } else {
     LOG_INFO("Continue to read the next request");
-    PrepareRequest();
     AsyncRead();
-  } else {
-    pool_->Close(shared_from_this());
   }
 }
 
 void ConnectionBase::HandleWriteError(boost::system::error_code ec) {
   LOG_ERRO("Socket write error (%s)", ec.message().c_str());
 
+  // Even if the connection has been closed already (operation aborted).
+  DetachResponses();
+
   if (ec != boost::asio::error::operation_aborted) {
     pool_->Close(shared_from_this());
   }
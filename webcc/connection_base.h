@@ -1,14 +1,17 @@
 #ifndef WEBCC_CONNECTION_BASE_H_
 #define WEBCC_CONNECTION_BASE_H_
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "boost/asio/detail/chrono.hpp"
 #include "boost/asio/ip/tcp.hpp"
 
 #include "webcc/globals.h"
-#include "webcc/queue.h"
+#include "webcc/ring_queue.h"
 #include "webcc/request.h"
 #include "webcc/request_parser.h"
 #include "webcc/response.h"
@@ -25,15 +28,26 @@ using SocketType = boost::asio::basic_socket<boost::asio::ip::tcp,
 
 class ConnectionBase;
 class ConnectionPool;
+class Http2Connection;
 class Server;
+class WebSocket;
 
 using ConnectionPtr = std::shared_ptr<ConnectionBase>;
 
+// The queue of the connections waiting for the workers to process.
+using ConnectionQueue = RingQueue<ConnectionPtr>;
+
+// The handler to call once the request of a connection has been read.
+using RequestHandler = std::function<void(ConnectionPtr)>;
+
 class ConnectionBase : public std::enable_shared_from_this<ConnectionBase> {
 public:
+  // The flag telling that the client has gone away is shared with the
+  // connection if given (e.g., a WebSocket message), or a new one.
   ConnectionBase(boost::asio::io_context& io_context, ConnectionPool* pool,
-                 Queue<ConnectionPtr>* queue, ViewMatcher&& view_matcher,
-                 std::size_t buffer_size);
+                 RequestHandler&& request_handler, ViewMatcher&& view_matcher,
+                 std::size_t buffer_size,
+                 std::shared_ptr<std::atomic_bool> peer_closed = nullptr);
 
   ConnectionBase(const ConnectionBase&) = delete;
   ConnectionBase& operator=(const ConnectionBase&) = delete;
@@ -47,33 +61,105 @@ public:
     return request_;
   }
 
+  // Limit the size of the request body (see Server::set_max_body_size()).
+  void set_max_body_size(std::size_t max_body_size) {
+    request_parser_.set_max_body_size(max_body_size);
+  }
+
+  std::size_t max_body_size() const {
+    return request_parser_.max_body_size();
+  }
+
+  // The route matched for the request.
+  // Null if no view matches the URL path of the request.
+  virtual const RouteInfo* route() const {
+    return request_parser_.route();
+  }
+
+  // The view matched for the request.
+  // Null if no view matches the URL path of the request.
+  virtual ViewPtr view() const {
+    return request_parser_.view();
+  }
+
+  // The time when the connection was put into the queue of the workers.
+  boost::asio::chrono::steady_clock::time_point queued_time() const {
+    return queued_time_;
+  }
+
+  void set_queued_time(boost::asio::chrono::steady_clock::time_point time) {
+    queued_time_ = time;
+  }
+
   virtual void Start() = 0;
 
+  // Reset the state for reusing the connection with a new client.
+  // Called by the connection pool (see ConnectionPool::Reuse()).
+  virtual void Reset();
+
   // Shutdown and close socket.
   virtual void Close();
 
+  // Switch to HTTP/2 if the client asks for it (see Server::set_http2()).
+  void set_http2_enabled(bool http2_enabled) {
+    http2_enabled_ = http2_enabled;
+  }
+
   // Send a response to the client.
   // The Connection header will be set to "Close" if `no_keep_alive` is true no
   // matter whether the client asked for keep-alive or not.
-  void SendResponse(ResponsePtr response, bool no_keep_alive = false);
+  virtual void SendResponse(ResponsePtr response, bool no_keep_alive = false);
 
   // Send a response with the given status and an empty body to the client.
   void SendResponse(int status, bool no_keep_alive = false);
 
+  // Send a response to the client from any thread.
+  // The sending is posted to the loop (io_context) of the connection.
+  void PostResponse(ResponsePtr response);
+
+  // Close the connection from any thread without sending any response.
+  // The closing is posted to the loop (io_context) of the connection.
+  virtual void PostClose();
+
+  // Watch the socket for the client closing or resetting the connection while
+  // the request is waiting in the queue or being handled. If it happens, the
+  // request will be canceled (see Request::IsCanceled()).
+  // Call it from the loop of the connection after the request has been read.
+  // NOTE: It's only a best effort. E.g., the close can't be detected when the
+  // client has sent more data (e.g., a pipelined request, or a TLS alert).
+  virtual void WatchPeer();
+
 protected:
+  // The loop (io_context) of the socket.
+  static boost::asio::io_context& GetIoContext(SocketType& socket);
+
   virtual void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
                           AsyncRWHandler&& handler) = 0;
 
   virtual void AsyncReadSome(boost::asio::mutable_buffer buffer,
                              AsyncRWHandler&& handler) = 0;
 
+  // Complete the handler with operation_not_supported from the loop, for the
+  // connections whose I/O is done by another one (e.g., an HTTP/2 stream).
+  void PostNotSupported(AsyncRWHandler&& handler);
+
   void PrepareRequest();
 
   void AsyncRead();
   void OnRead(boost::system::error_code ec, std::size_t length);
 
-  void AsyncWrite();
-  void OnWriteHeaders(boost::system::error_code ec, std::size_t length);
+  // Parse the request from the data read but not parsed yet, and go on with
+  // the requests pipelined after it as far as possible.
+  void ParseRequest();
+
+  // Let the handler (the server) handle the request which has been read.
+  // Return true if the response has been queued and the next pipelined request
+  // could be parsed right away.
+  bool HandleRequest();
+
+  // Write the queued responses in one write, unless a write is in progress.
+  void WriteResponses();
+  void OnWrite(boost::system::error_code ec, std::size_t length);
 
   void AsyncWriteBody();
   void OnWriteBody(boost::system::error_code ec, std::size_t length);
@@ -81,11 +167,24 @@ protected:
   void HandleWriteOK();
   void HandleWriteError(boost::system::error_code ec);
 
+  // Detach the bodies of the responses being written or queued (see
+  // Body::Detach()).
+  void DetachResponses();
+
+  void OnPeerReadable(boost::system::error_code ec);
+
+  // Switch to HTTP/2, with the data read so far.
+  void StartHttp2(const std::string& data);
+
+  // Switch to WebSocket once the opening handshake has been answered.
+  void StartWebSocket();
+
   // The connection pool.
   ConnectionPool* pool_;
 
-  // The connection queue.
-  Queue<ConnectionPtr>* queue_;
+  // The handler for the request which has been read.
+  // E.g., the server puts the connection into the queue of the workers.
+  RequestHandler request_handler_;
 
   // The functor for the request parser to match views after receive the headers
   // of a request.
@@ -94,14 +193,80 @@ protected:
   // The buffer for incoming data.
   std::vector<char> buffer_;
 
+  // The data in the buffer which has been read but not parsed yet, i.e., the
+  // start of the next pipelined request.
+  std::size_t unparsed_offset_ = 0;
+  std::size_t unparsed_length_ = 0;
+
   // The incoming request.
+  // Cleared and reused for the next request unless something else (e.g., a
+  // worker or a response) still holds it.
   RequestPtr request_;
 
+  // The IP address of the client, got once for all the requests.
+  std::string address_;
+
   // The parser for the incoming request.
   RequestParser request_parser_;
 
-  // The response to be sent back to the client.
+  // The responses queued to be sent back to the client, in the order of the
+  // requests.
+  std::vector<ResponsePtr> responses_;
+
+  // The responses being written and the payload of them.
+  std::vector<ResponsePtr> writing_;
+  Payload payload_;
+
+  // The last response being written if its body is written payload by payload
+  // after the others (e.g., a file body).
   ResponsePtr response_;
+
+  // Has the current request been handed to the handler?
+  bool dispatched_ = false;
+
+  // Has the current request been responded?
+  bool responded_ = false;
+
+  // Hold the response of the current request and write it together with the
+  // responses to the next pipelined requests.
+  bool batching_ = false;
+
+  // Close the connection once the queued responses have been written.
+  bool closing_ = false;
+
+  // The time when the connection was put into the queue of the workers.
+  boost::asio::chrono::steady_clock::time_point queued_time_;
+
+  // Set when the client has closed or reset the connection.
+  // Shared with the requests as their canceled flag.
+  std::shared_ptr<std::atomic_bool> peer_closed_;
+
+  // Is the socket being watched by WatchPeer()?
+  std::atomic_bool watching_peer_{ false };
+
+  bool http2_enabled_ = false;
+
+  // The HTTP/2 layer which has taken over the connection, if any.
+  std::shared_ptr<Http2Connection> http2_;
+
+  // Switch to WebSocket once the response (Switching Protocols) has been
+  // written.
+  bool upgrading_ = false;
+
+  // The WebSocket layer which has taken over the connection, if any.
+  std::shared_ptr<WebSocket> websocket_;
+
+private:
+  friend class ConnectionPool;
+  friend class Http2Connection;
+  friend class WebSocket;
+
+  // The links in the lists of the connection pool.
+  ConnectionBase* prev_ = nullptr;
+  ConnectionBase* next_ = nullptr;
+
+  // The reference held by the connection pool while the connection is live.
+  ConnectionPtr pool_ref_;
 };
 
 }  // namespace webcc
@@ -4,13 +4,97 @@
 
 namespace webcc {
 
+ConnectionPool::~ConnectionPool() {
+  StopRecycling();
+}
+
+ConnectionPtr ConnectionPool::Manage(ConnectionBase* connection) {
+  return ConnectionPtr{ connection,
+                        [this](ConnectionBase* c) { Recycle(c); } };
+}
+
+ConnectionPtr ConnectionPool::Reuse() {
+  ConnectionBase* connection = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock{ recycle_mutex_ };
+    if (recycled_ == nullptr) {
+      return {};
+    }
+    connection = recycled_;
+    recycled_ = connection->next_;
+    --recycled_size_;
+  }
+
+  // Reset already when it was recycled.
+  connection->next_ = nullptr;
+
+  return Manage(connection);
+}
+
+void ConnectionPool::StopRecycling() {
+  ConnectionBase* recycled = nullptr;
+
+  {
+    std::lock_guard<std::mutex> lock{ recycle_mutex_ };
+    recycling_ = false;
+    recycled = recycled_;
+    recycled_ = nullptr;
+    recycled_size_ = 0;
+  }
+
+  while (recycled != nullptr) {
+    ConnectionBase* next = recycled->next_;
+    delete recycled;
+    recycled = next;
+  }
+}
+
+void ConnectionPool::Recycle(ConnectionBase* connection) {
+  bool recycle = false;
+  {
+    std::lock_guard<std::mutex> lock{ recycle_mutex_ };
+    recycle = recycling_ && recycled_size_ < max_recycled_;
+  }
+
+  if (recycle) {
+    // Close the socket and drop the state of the old client (the request and
+    // the response, HTTP/2, WebSocket) now, instead of keeping it until the
+    // connection is reused, which might never happen.
+    // Nobody else refers to the connection any more, so it's safe from any
+    // thread.
+    connection->Reset();
+
+    std::lock_guard<std::mutex> lock{ recycle_mutex_ };
+    if (recycling_ && recycled_size_ < max_recycled_) {
+      connection->next_ = recycled_;
+      recycled_ = connection;
+      ++recycled_size_;
+      return;
+    }
+  }
+
+  delete connection;
+}
+
 void ConnectionPool::Start(ConnectionPtr connection) {
   LOG_VERB("Start connection");
 
   {
     // Lock the container only.
     std::lock_guard<std::mutex> lock{ mutex_ };
-    connections_.insert(connection);
+
+    assert(connection->pool_ref_ == nullptr);
+
+    connection->prev_ = nullptr;
+    connection->next_ = head_;
+    if (head_ != nullptr) {
+      head_->prev_ = connection.get();
+    }
+    head_ = connection.get();
+    ++size_;
+
+    connection->pool_ref_ = connection;
   }
 
   connection->Start();
@@ -20,26 +104,62 @@ void ConnectionPool::Close(ConnectionPtr connection) {
   // NOTE:
   // The connection might have already been closed by Clear().
 
-  std::lock_guard<std::mutex> lock{ mutex_ };
+  ConnectionPtr ref;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    // Check the reference held to see if it's still live or not.
+    if (connection->pool_ref_ == nullptr) {
+      return;  // Already closed by Clear()
+    }
+
+    ref = Unlink(connection.get());
+  }
 
-  // Check the return value of erase() to see if it still exists or not.
-  if (connections_.erase(connection) == 1) {
-    LOG_VERB("Close connection");
-    connection->Close();
-  }  // else: Already closed by Clear()
+  LOG_VERB("Close connection");
+  connection->Close();
+
+  // The reference is released out of the lock, since the connection might be
+  // recycled right away.
 }
 
 void ConnectionPool::Clear() {
-  // Lock all since we are going to stop anyway.
-  std::lock_guard<std::mutex> lock{ mutex_ };
+  std::vector<ConnectionPtr> connections;
+
+  {
+    // Lock all since we are going to stop anyway.
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    if (size_ != 0) {
+      LOG_VERB("Close all (%u) connections", size_);
+      connections.reserve(size_);
+      while (head_ != nullptr) {
+        connections.push_back(Unlink(head_));
+      }
+    }
 
-  if (!connections_.empty()) {
-    LOG_VERB("Close all (%u) connections", connections_.size());
-    for (auto& c : connections_) {
+    for (auto& c : connections) {
       c->Close();
     }
-    connections_.clear();
   }
 }
 
+ConnectionPtr ConnectionPool::Unlink(ConnectionBase* connection) {
+  if (connection->prev_ != nullptr) {
+    connection->prev_->next_ = connection->next_;
+  } else {
+    head_ = connection->next_;
+  }
+  if (connection->next_ != nullptr) {
+    connection->next_->prev_ = connection->prev_;
+  }
+
+  connection->prev_ = nullptr;
+  connection->next_ = nullptr;
+  --size_;
+
+  return std::move(connection->pool_ref_);
+}
+
 }  // namespace webcc
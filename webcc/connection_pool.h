@@ -2,12 +2,15 @@
 #define WEBCC_CONNECTION_POOL_H_
 
 #include <mutex>
-#include <set>
 
 #include "webcc/connection.h"
 
 namespace webcc {
 
+// The pool of the connections of a shard (see Server).
+// It keeps the live connections in an intrusive list (no allocation, no
+// rebalancing), and recycles the released connections so that the objects and
+// their buffers could be reused for the new clients.
 class ConnectionPool {
 public:
   ConnectionPool() = default;
@@ -15,6 +18,26 @@ public:
   ConnectionPool(const ConnectionPool&) = delete;
   ConnectionPool& operator=(const ConnectionPool&) = delete;
 
+  ~ConnectionPool();
+
+  // Set the maximum number of the released connections kept for reuse.
+  void set_max_recycled(std::size_t max_recycled) {
+    max_recycled_ = max_recycled;
+  }
+
+  // Take the ownership of a newly created connection.
+  // When the connection is released (i.e., the last reference goes away), it
+  // will be kept in the pool for reuse instead of being deleted.
+  ConnectionPtr Manage(ConnectionBase* connection);
+
+  // Get a released connection, which has been reset when it was released.
+  // Return null if there's none.
+  ConnectionPtr Reuse();
+
+  // Stop recycling and delete the released connections.
+  // Must be called before the io_context of the connections is destroyed.
+  void StopRecycling();
+
   // Add the connection and start to read the request from it.
   // Called when a new connection has just been accepted.
   void Start(ConnectionPtr connection);
@@ -28,11 +51,32 @@ public:
   void Clear();
 
 private:
-  std::set<ConnectionPtr> connections_;
+  // Reset the released connection and keep it for reuse, or delete it.
+  void Recycle(ConnectionBase* connection);
+
+  // Unlink the connection from the live list and return the reference held.
+  // NOTE: Lock `mutex_` before calling it.
+  ConnectionPtr Unlink(ConnectionBase* connection);
+
+private:
+  // The head of the live connections, linked by ConnectionBase::next_ and
+  // ConnectionBase::prev_. Each live connection holds a reference to itself
+  // (ConnectionBase::pool_ref_) until it's closed.
+  ConnectionBase* head_ = nullptr;
+  std::size_t size_ = 0;
 
   // Mutex is necessary if the loop is running in multiple threads.
   // See Server::Run().
   std::mutex mutex_;
+
+  // The released connections, linked by ConnectionBase::next_.
+  ConnectionBase* recycled_ = nullptr;
+  std::size_t recycled_size_ = 0;
+  std::size_t max_recycled_ = 1024;
+  bool recycling_ = true;
+
+  // The connections are released from any thread (e.g., a worker).
+  std::mutex recycle_mutex_;
 };
 
 }  // namespace webcc
@@ -0,0 +1,50 @@
+#ifndef WEBCC_COROUTINE_VIEW_H_
+#define WEBCC_COROUTINE_VIEW_H_
+
+#include "webcc/config.h"
+
+#if WEBCC_ENABLE_COROUTINE
+
+#include "boost/asio/awaitable.hpp"
+
+#include "webcc/view.h"
+
+namespace webcc {
+
+// A view handling the requests with a C++20 coroutine.
+// The coroutine runs in the loop (io_context) thread of the connection, and the
+// response is sent back once it completes. While it's suspended (e.g., waiting
+// for a slow upstream service with co_await), no thread is occupied, so a few
+// loops could serve a lot of concurrent requests.
+// Example:
+//   class SlowView : public webcc::CoroutineView {
+//   public:
+//     boost::asio::awaitable<webcc::ResponsePtr>
+//     AsyncHandle(webcc::RequestPtr request) override {
+//       auto executor = co_await boost::asio::this_coro::executor;
+//       boost::asio::steady_timer timer{ executor, std::chrono::seconds(1) };
+//       co_await timer.async_wait(boost::asio::use_awaitable);
+//       co_return webcc::ResponseBuilder{}.OK().Body("Hello")();
+//     }
+//   };
+// NOTE: Like non-blocking views, the coroutine must never block between the
+// co_await's, otherwise all the connections of the loop will be stalled.
+class CoroutineView : public View {
+public:
+  // Return a proper response object, or throw an exception which will be
+  // answered with Internal Server Error (500).
+  virtual boost::asio::awaitable<ResponsePtr> AsyncHandle(
+      RequestPtr request) = 0;
+
+private:
+  // Never called, the server spawns AsyncHandle() instead.
+  ResponsePtr Handle(RequestPtr request) final {
+    return {};
+  }
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_ENABLE_COROUTINE
+
+#endif  // WEBCC_COROUTINE_VIEW_H_
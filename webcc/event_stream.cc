@@ -0,0 +1,190 @@
+#include "webcc/event_stream.h"
+
+#include <utility>
+
+#include "webcc/logger.h"
+
+namespace webcc {
+
+bool EventStream::Send(std::string_view data, std::string_view event,
+                       std::string_view id) {
+  // See https://html.spec.whatwg.org/multipage/server-sent-events.html
+  // A line break in the event or the id would inject fields or events.
+  if (event.find_first_of("\r\n") != std::string_view::npos ||
+      id.find_first_of("\r\n") != std::string_view::npos) {
+    LOG_ERRO("Line break in the event or the id");
+    return false;
+  }
+
+  std::string text;
+  text.reserve(data.size() + event.size() + id.size() + 32);
+
+  if (!id.empty()) {
+    text.append("id: ").append(id).append("\n");
+  }
+
+  if (!event.empty()) {
+    text.append("event: ").append(event).append("\n");
+  }
+
+  // A field can't span lines, split the data into "data" fields which the
+  // client joins with line feeds. Like the client, take CRLF, LF or CR as the
+  // end of a line.
+  std::size_t off = 0;
+  while (true) {
+    std::size_t pos = data.find_first_of("\r\n", off);
+    text.append("data: ").append(data.substr(off, pos - off)).append("\n");
+
+    if (pos == std::string_view::npos) {
+      break;
+    }
+    off = pos + 1;
+    if (data[pos] == '\r' && off < data.size() && data[off] == '\n') {
+      ++off;
+    }
+  }
+
+  // The empty line dispatches the event.
+  text.push_back('\n');
+
+  return Push(std::move(text));
+}
+
+bool EventStream::SetRetry(int milliseconds) {
+  return Push("retry: " + std::to_string(milliseconds) + "\n\n");
+}
+
+void EventStream::Close() {
+  std::function<void()> notify;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    notify.swap(notify_);
+  }
+
+  if (notify) {
+    notify();
+  }
+}
+
+bool EventStream::closed() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return closed_ || detached_;
+}
+
+bool EventStream::Push(std::string&& text) {
+  std::function<void()> notify;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (closed_ || detached_) {
+      return false;
+    }
+    queue_.append(text);
+    notify.swap(notify_);
+  }
+
+  // Notify out of the lock.
+  if (notify) {
+    notify();
+  }
+  return true;
+}
+
+bool EventStream::Take(std::string* data) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  data->swap(queue_);
+  return !closed_;
+}
+
+void EventStream::Wait(const boost::asio::any_io_executor& executor,
+                       std::function<void()> notify) {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    if (queue_.empty() && !closed_) {
+      notify_ = std::move(notify);
+
+      if (keep_alive_ > 0) {
+        if (timer_ == nullptr) {
+          timer_.reset(new boost::asio::steady_timer{ executor });
+        }
+        // Setting the expiry cancels the previous wait, if any.
+        timer_->expires_after(std::chrono::seconds(keep_alive_));
+        timer_->async_wait(
+            [weak = weak_from_this()](boost::system::error_code ec) {
+              if (auto self = weak.lock()) {
+                self->OnKeepAliveTimer(ec);
+              }
+            });
+      }
+      return;
+    }
+  }
+
+  // Sent or closed since taken.
+  notify();
+}
+
+void EventStream::Detach() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  detached_ = true;
+  notify_ = nullptr;
+  timer_.reset();
+}
+
+void EventStream::OnKeepAliveTimer(boost::system::error_code ec) {
+  if (ec) {
+    return;  // Canceled
+  }
+
+  std::function<void()> notify;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (!notify_) {
+      return;  // Not waiting
+    }
+    // A comment, ignored by the client.
+    queue_.append(": keep-alive\n\n");
+    notify.swap(notify_);
+  }
+
+  notify();
+}
+
+// -----------------------------------------------------------------------------
+
+EventStreamBody::EventStreamBody(EventStreamPtr stream)
+    : StreamBody([stream](std::string* data) { return stream->Take(data); }),
+      stream_(stream) {
+  async_ = true;
+}
+
+EventStreamBody::~EventStreamBody() {
+  stream_->Detach();
+}
+
+void EventStreamBody::Detach() {
+  stream_->Detach();
+}
+
+bool EventStreamBody::WaitPayload(const boost::asio::any_io_executor& executor,
+                                  std::function<void()> notify) {
+  if (finished()) {
+    return false;
+  }
+
+  stream_->Wait(executor, std::move(notify));
+  return true;
+}
+
+void EventStreamBody::Dump(std::ostream& os, std::string_view prefix) const {
+  os << prefix << "<event stream>" << std::endl;
+}
+
+}  // namespace webcc
@@ -0,0 +1,113 @@
+#ifndef WEBCC_EVENT_STREAM_H_
+#define WEBCC_EVENT_STREAM_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "boost/asio/steady_timer.hpp"
+
+#include "webcc/body.h"
+
+namespace webcc {
+
+// A stream of server-sent events (text/event-stream), pushed to the client
+// from any thread, e.g., instead of the client polling for the changes.
+// Usage (in a view):
+//   auto events = std::make_shared<webcc::EventStream>();
+//   subscribers_.Add(events);  // Call events->Send() from any thread later.
+//   return webcc::ResponseBuilder{}.OK().Events(events)();
+// No worker is held once the response has been returned, the events are
+// written by the loop of the connection as they're sent.
+// NOTE: A stream can be responded only once.
+class EventStream : public std::enable_shared_from_this<EventStream> {
+public:
+  // The comments are sent every `keep_alive` seconds if there's no event, so
+  // that the idle connection is not dropped by the proxies in between, and
+  // the client having gone away could be detected. 0 to disable.
+  explicit EventStream(int keep_alive = 15) : keep_alive_(keep_alive) {
+  }
+
+  EventStream(const EventStream&) = delete;
+  EventStream& operator=(const EventStream&) = delete;
+
+  ~EventStream() = default;
+
+  // Send an event. The lines of the data are sent as "data" fields.
+  // Return false if the stream has been closed or the client has gone away,
+  // the stream should then be dropped. The event is refused (false too) if
+  // the `event` or the `id` has a line break.
+  bool Send(std::string_view data, std::string_view event = {},
+            std::string_view id = {});
+
+  // Tell the client the time (milliseconds) to wait before reconnecting.
+  bool SetRetry(int milliseconds);
+
+  // End the response once the events sent have been written.
+  void Close();
+
+  // Has the stream been closed, or has the client gone away?
+  bool closed() const;
+
+private:
+  friend class EventStreamBody;
+
+  bool Push(std::string&& text);
+
+  // Take the events to write. Return false if the stream has been closed.
+  bool Take(std::string* data);
+
+  // Call `notify` once there're events to write, or a comment to keep alive.
+  void Wait(const boost::asio::any_io_executor& executor,
+            std::function<void()> notify);
+
+  // The response has been dropped, e.g., the client has gone away.
+  void Detach();
+
+  void OnKeepAliveTimer(boost::system::error_code ec);
+
+  const int keep_alive_;
+
+  mutable std::mutex mutex_;
+
+  // The events sent but not written yet.
+  std::string queue_;
+
+  bool closed_ = false;
+  bool detached_ = false;
+
+  // Set when the connection waits for the events.
+  std::function<void()> notify_;
+
+  std::unique_ptr<boost::asio::steady_timer> timer_;
+};
+
+using EventStreamPtr = std::shared_ptr<EventStream>;
+
+// -----------------------------------------------------------------------------
+
+// The body of the response for an event stream.
+// See ResponseBuilder::Events().
+class EventStreamBody : public StreamBody {
+public:
+  explicit EventStreamBody(EventStreamPtr stream);
+
+  ~EventStreamBody() override;
+
+  bool WaitPayload(const boost::asio::any_io_executor& executor,
+                   std::function<void()> notify) override;
+
+  // Send() returns false from now on.
+  void Detach() override;
+
+  void Dump(std::ostream& os, std::string_view prefix) const override;
+
+private:
+  EventStreamPtr stream_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_EVENT_STREAM_H_
@@ -1,6 +1,7 @@
 #include "webcc/globals.h"
 
 #include <iostream>
+#include <iterator>
 
 #include "boost/algorithm/string/case_conv.hpp"
 
@@ -8,6 +9,88 @@ namespace webcc {
 
 // -----------------------------------------------------------------------------
 
+namespace {
+
+// The names of the well-known headers in lower case, in the order of HeaderId.
+constexpr std::string_view kHeaderNames[] = {
+  "host",
+  "date",
+  "authorization",
+  "content-type",
+  "content-length",
+  "content-encoding",
+  "content-md5",
+  "content-disposition",
+  "connection",
+  "transfer-encoding",
+  "accept",
+  "accept-encoding",
+  "user-agent",
+  "server",
+  "retry-after",
+  "cache-control",
+  "upgrade",
+  "sec-websocket-key",
+  "sec-websocket-version",
+  "sec-websocket-accept",
+  "sec-websocket-extensions",
+};
+
+static_assert(std::size(kHeaderNames) ==
+                  static_cast<std::size_t>(HeaderId::kUnknown),
+              "The names must match HeaderId");
+
+constexpr std::size_t kHeaderHashSize = 64;
+
+// A perfect hash of the well-known names, i.e., without collisions among
+// them, by the length and the first and the last chars in lower case.
+// The other names are told apart by comparing with the name hashed to.
+constexpr std::size_t HashHeaderName(std::string_view name) {
+  return (name.size() + (static_cast<unsigned char>(name.back()) | 0x20) * 3 +
+          (static_cast<unsigned char>(name.front()) | 0x20)) %
+         kHeaderHashSize;
+}
+
+struct HeaderHashTable {
+  constexpr HeaderHashTable() : ids() {
+    for (auto& id : ids) {
+      id = HeaderId::kUnknown;
+    }
+    for (std::size_t i = 0; i < std::size(kHeaderNames); ++i) {
+      std::size_t hash = HashHeaderName(kHeaderNames[i]);
+      if (ids[hash] != HeaderId::kUnknown) {
+        perfect = false;
+      }
+      ids[hash] = static_cast<HeaderId>(i);
+    }
+  }
+
+  HeaderId ids[kHeaderHashSize];
+  bool perfect = true;
+};
+
+constexpr HeaderHashTable kHeaderHashTable;
+
+static_assert(kHeaderHashTable.perfect,
+              "Adjust the hash for the new well-known headers");
+
+}  // namespace
+
+HeaderId GetHeaderId(std::string_view name) {
+  if (name.empty()) {
+    return HeaderId::kUnknown;
+  }
+
+  HeaderId id = kHeaderHashTable.ids[HashHeaderName(name)];
+  if (id != HeaderId::kUnknown &&
+      IEquals(name, kHeaderNames[static_cast<std::size_t>(id)])) {
+    return id;
+  }
+  return HeaderId::kUnknown;
+}
+
+// -----------------------------------------------------------------------------
+
 namespace media_types {
 
 std::string FromExtension(const std::string& ext) {
@@ -2,11 +2,13 @@
 #define WEBCC_GLOBALS_H_
 
 #include <cassert>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
 #include <iosfwd>
 #include <limits>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "boost/asio/buffer.hpp"  // for const_buffer
@@ -47,6 +49,20 @@ constexpr std::size_t kMaxDumpSize = 2048;
 // Default buffer size for socket reading.
 constexpr std::size_t kBufferSize = 1024;
 
+// Max size of the memory reserved for a body from its Content-Length before
+// the data arrives, so that a bogus Content-Length doesn't take the memory.
+// Beyond it, the memory grows with the data.
+constexpr std::size_t kMaxReserveSize = 8 * 1024 * 1024;
+
+// Size of the pieces read from the file of a form part as it's being sent.
+constexpr std::size_t kFileChunkSize = 64 * 1024;
+
+// Default capacity of the queue of the connections waiting for the workers.
+constexpr std::size_t kQueueCapacity = 4096;
+
+// Max number of the responses to pipelined requests written in one batch.
+constexpr std::size_t kMaxPipelinedResponses = 16;
+
 // Why 1400? See the following page:
 // https://www.itworld.com/article/2693941/why-it-doesn-t-make-sense-to-
 // gzip-all-content-from-your-web-server.html
@@ -78,6 +94,7 @@ namespace status_codes {
 // The full list is available here:
 //   https://en.wikipedia.org/wiki/List_of_HTTP_status_codes
 
+constexpr int kSwitchingProtocols = 101;
 constexpr int kOK = 200;
 constexpr int kCreated = 201;
 constexpr int kAccepted = 202;
@@ -87,6 +104,8 @@ constexpr int kNotModified = 304;
 constexpr int kBadRequest = 400;
 constexpr int kForbidden = 403;
 constexpr int kNotFound = 404;
+constexpr int kPayloadTooLarge = 413;
+constexpr int kUpgradeRequired = 426;
 constexpr int kInternalServerError = 500;
 constexpr int kNotImplemented = 501;
 constexpr int kServiceUnavailable = 503;
@@ -112,9 +131,47 @@ const char* const kAccept = "Accept";
 const char* const kAcceptEncoding = "Accept-Encoding";
 const char* const kUserAgent = "User-Agent";
 const char* const kServer = "Server";
+const char* const kRetryAfter = "Retry-After";
+const char* const kCacheControl = "Cache-Control";
+const char* const kUpgrade = "Upgrade";
+const char* const kSecWebSocketKey = "Sec-WebSocket-Key";
+const char* const kSecWebSocketVersion = "Sec-WebSocket-Version";
+const char* const kSecWebSocketAccept = "Sec-WebSocket-Accept";
+const char* const kSecWebSocketExtensions = "Sec-WebSocket-Extensions";
 
 }  // namespace headers
 
+// The well-known headers above, which are found by a perfect hash of the
+// names instead of comparing the names one by one (see Headers).
+enum class HeaderId : std::uint8_t {
+  kHost,
+  kDate,
+  kAuthorization,
+  kContentType,
+  kContentLength,
+  kContentEncoding,
+  kContentMD5,
+  kContentDisposition,
+  kConnection,
+  kTransferEncoding,
+  kAccept,
+  kAcceptEncoding,
+  kUserAgent,
+  kServer,
+  kRetryAfter,
+  kCacheControl,
+  kUpgrade,
+  kSecWebSocketKey,
+  kSecWebSocketVersion,
+  kSecWebSocketAccept,
+  kSecWebSocketExtensions,
+  kUnknown,  // Also the number of the well-known headers
+};
+
+// Get the ID of the header by the name (case-insensitive).
+// Return kUnknown if it's not a well-known header.
+HeaderId GetHeaderId(std::string_view name);
+
 namespace media_types {
 
 // See the following link for the full list of media types:
@@ -124,6 +181,7 @@ const char* const kApplicationJson = "application/json";
 const char* const kApplicationSoapXml = "application/soap+xml";
 const char* const kApplicationFormUrlEncoded =
     "application/x-www-form-urlencoded";
+const char* const kTextEventStream = "text/event-stream";
 const char* const kTextPlain = "text/plain";
 const char* const kTextXml = "text/xml";
 
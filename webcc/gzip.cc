@@ -1,5 +1,6 @@
 #include "webcc/gzip.h"
 
+#include <algorithm>
 #include <cassert>
 #include <utility>  // std::move
 
@@ -127,5 +128,110 @@ bool Decompress(const std::string& input, std::string* output) {
   return true;
 }
 
+bool Deflate(std::string_view input, int window_bits, std::string* output) {
+  output->clear();
+
+  z_stream stream;
+  stream.next_in = (Bytef*)input.data();
+  stream.avail_in = (uInt)input.size();
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+
+  // Negative window bits for the raw deflate.
+  int ret = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         -window_bits, 8, Z_DEFAULT_STRATEGY);
+  if (ret != Z_OK) {
+    return false;
+  }
+
+  std::string buf;
+  buf.resize(deflateBound(&stream, (uLong)input.size()) + 16);
+
+  // The bound is large enough for a single call, loop anyway.
+  do {
+    stream.avail_out = (uInt)buf.size();
+    stream.next_out = (Bytef*)buf.data();
+
+    int err = deflate(&stream, Z_SYNC_FLUSH);
+
+    if (err != Z_OK && err != Z_BUF_ERROR) {
+      deflateEnd(&stream);
+      if (stream.msg != nullptr) {
+        LOG_ERRO("zlib deflate error: %s", stream.msg);
+      }
+      return false;
+    }
+
+    std::size_t size = buf.size() - stream.avail_out;
+    output->append(buf.data(), size);
+
+  } while (stream.avail_out == 0);
+
+  deflateEnd(&stream);
+  return true;
+}
+
+bool Inflate(std::string_view input, std::size_t max_size,
+             std::string* output) {
+  output->clear();
+
+  z_stream stream;
+  stream.next_in = (Bytef*)input.data();
+  stream.avail_in = (uInt)input.size();
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    return false;
+  }
+
+  std::string buf;
+  buf.resize(std::min(std::max<std::size_t>(input.size() * 4, 1024),
+                      max_size));
+
+  std::size_t size = 0;
+
+  while (true) {
+    stream.next_out = (Bytef*)(buf.data() + size);
+    stream.avail_out = (uInt)(buf.size() - size);
+
+    int err = inflate(&stream, Z_SYNC_FLUSH);
+
+    if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+      inflateEnd(&stream);
+      if (stream.msg != nullptr) {
+        LOG_ERRO("zlib inflate error: %s", stream.msg);
+      }
+      return false;
+    }
+
+    size = buf.size() - stream.avail_out;
+
+    // Done once all the input has been consumed.
+    if (err == Z_STREAM_END ||
+        (stream.avail_in == 0 && stream.avail_out > 0)) {
+      break;
+    }
+
+    if (buf.size() >= max_size) {
+      inflateEnd(&stream);
+      LOG_ERRO("zlib inflate error: larger than %u bytes",
+               (unsigned int)max_size);
+      return false;
+    }
+
+    // Enlarge the output buffer.
+    buf.resize(std::min(buf.size() * 2, max_size));
+  }
+
+  inflateEnd(&stream);
+
+  buf.resize(size);
+  *output = std::move(buf);
+  return true;
+}
+
 }  // namespace gzip
 }  // namespace webcc
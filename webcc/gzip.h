@@ -2,6 +2,7 @@
 #define WEBCC_GZIP_H_
 
 #include <string>
+#include <string_view>
 
 namespace webcc {
 namespace gzip {
@@ -13,6 +14,15 @@ bool Compress(const std::string& input, std::string* output);
 // formats.
 bool Decompress(const std::string& input, std::string* output);
 
+// Compress the input to raw deflate data (without header and trailer) with
+// the given window bits (9 ~ 15), ended by a sync flush, i.e., an empty block
+// 0x00 0x00 0xff 0xff. E.g., for the permessage-deflate of WebSocket.
+bool Deflate(std::string_view input, int window_bits, std::string* output);
+
+// Decompress the raw deflate data, up to `max_size` bytes of output.
+bool Inflate(std::string_view input, std::size_t max_size,
+             std::string* output);
+
 }  // namespace gzip
 }  // namespace webcc
 
@@ -0,0 +1,590 @@
+#include "webcc/hpack.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+namespace webcc {
+
+namespace {
+
+// The static table (RFC 7541 Appendix A), index from 1.
+const Header kStaticTable[] = {
+  { ":authority", "" },
+  { ":method", "GET" },
+  { ":method", "POST" },
+  { ":path", "/" },
+  { ":path", "/index.html" },
+  { ":scheme", "http" },
+  { ":scheme", "https" },
+  { ":status", "200" },
+  { ":status", "204" },
+  { ":status", "206" },
+  { ":status", "304" },
+  { ":status", "400" },
+  { ":status", "404" },
+  { ":status", "500" },
+  { "accept-charset", "" },
+  { "accept-encoding", "gzip, deflate" },
+  { "accept-language", "" },
+  { "accept-ranges", "" },
+  { "accept", "" },
+  { "access-control-allow-origin", "" },
+  { "age", "" },
+  { "allow", "" },
+  { "authorization", "" },
+  { "cache-control", "" },
+  { "content-disposition", "" },
+  { "content-encoding", "" },
+  { "content-language", "" },
+  { "content-length", "" },
+  { "content-location", "" },
+  { "content-range", "" },
+  { "content-type", "" },
+  { "cookie", "" },
+  { "date", "" },
+  { "etag", "" },
+  { "expect", "" },
+  { "expires", "" },
+  { "from", "" },
+  { "host", "" },
+  { "if-match", "" },
+  { "if-modified-since", "" },
+  { "if-none-match", "" },
+  { "if-range", "" },
+  { "if-unmodified-since", "" },
+  { "last-modified", "" },
+  { "link", "" },
+  { "location", "" },
+  { "max-forwards", "" },
+  { "proxy-authenticate", "" },
+  { "proxy-authorization", "" },
+  { "range", "" },
+  { "referer", "" },
+  { "refresh", "" },
+  { "retry-after", "" },
+  { "server", "" },
+  { "set-cookie", "" },
+  { "strict-transport-security", "" },
+  { "transfer-encoding", "" },
+  { "user-agent", "" },
+  { "vary", "" },
+  { "via", "" },
+  { "www-authenticate", "" },
+};
+
+// The Huffman code (RFC 7541 Appendix B): the code and its length in bits of
+// each symbol, except EOS.
+const std::pair<std::uint32_t, std::uint8_t> kHuffmanCodes[256] = {
+  { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+  { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+  { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+  { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+  { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+  { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+  { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+  { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+  { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 }, { 0x1ff9, 13 },
+  { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 }, { 0x3fa, 10 }, { 0x3fb, 10 },
+  { 0xf9, 8 }, { 0x7fb, 11 }, { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 },
+  { 0x18, 6 }, { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 }, { 0x1a, 6 },
+  { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 }, { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 },
+  { 0xfb, 8 }, { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+  { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 }, { 0x5f, 7 },
+  { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 }, { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 },
+  { 0x66, 7 }, { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 }, { 0x6b, 7 },
+  { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 }, { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 },
+  { 0x72, 7 }, { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+  { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 }, { 0x7ffd, 15 },
+  { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 }, { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 },
+  { 0x26, 6 }, { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 }, { 0x28, 6 },
+  { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 }, { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 },
+  { 0x8, 5 }, { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 }, { 0x79, 7 },
+  { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 }, { 0x7fc, 11 }, { 0x3ffd, 14 },
+  { 0x1ffd, 13 }, { 0xffffffc, 28 }, { 0xfffe6, 20 }, { 0x3fffd2, 22 },
+  { 0xfffe7, 20 }, { 0xfffe8, 20 }, { 0x3fffd3, 22 }, { 0x3fffd4, 22 },
+  { 0x3fffd5, 22 }, { 0x7fffd9, 23 }, { 0x3fffd6, 22 }, { 0x7fffda, 23 },
+  { 0x7fffdb, 23 }, { 0x7fffdc, 23 }, { 0x7fffdd, 23 }, { 0x7fffde, 23 },
+  { 0xffffeb, 24 }, { 0x7fffdf, 23 }, { 0xffffec, 24 }, { 0xffffed, 24 },
+  { 0x3fffd7, 22 }, { 0x7fffe0, 23 }, { 0xffffee, 24 }, { 0x7fffe1, 23 },
+  { 0x7fffe2, 23 }, { 0x7fffe3, 23 }, { 0x7fffe4, 23 }, { 0x1fffdc, 21 },
+  { 0x3fffd8, 22 }, { 0x7fffe5, 23 }, { 0x3fffd9, 22 }, { 0x7fffe6, 23 },
+  { 0x7fffe7, 23 }, { 0xffffef, 24 }, { 0x3fffda, 22 }, { 0x1fffdd, 21 },
+  { 0xfffe9, 20 }, { 0x3fffdb, 22 }, { 0x3fffdc, 22 }, { 0x7fffe8, 23 },
+  { 0x7fffe9, 23 }, { 0x1fffde, 21 }, { 0x7fffea, 23 }, { 0x3fffdd, 22 },
+  { 0x3fffde, 22 }, { 0xfffff0, 24 }, { 0x1fffdf, 21 }, { 0x3fffdf, 22 },
+  { 0x7fffeb, 23 }, { 0x7fffec, 23 }, { 0x1fffe0, 21 }, { 0x1fffe1, 21 },
+  { 0x3fffe0, 22 }, { 0x1fffe2, 21 }, { 0x7fffed, 23 }, { 0x3fffe1, 22 },
+  { 0x7fffee, 23 }, { 0x7fffef, 23 }, { 0xfffea, 20 }, { 0x3fffe2, 22 },
+  { 0x3fffe3, 22 }, { 0x3fffe4, 22 }, { 0x7ffff0, 23 }, { 0x3fffe5, 22 },
+  { 0x3fffe6, 22 }, { 0x7ffff1, 23 }, { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 },
+  { 0xfffeb, 20 }, { 0x7fff1, 19 }, { 0x3fffe7, 22 }, { 0x7ffff2, 23 },
+  { 0x3fffe8, 22 }, { 0x1ffffec, 25 }, { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 },
+  { 0x3ffffe4, 26 }, { 0x7ffffde, 27 }, { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 },
+  { 0xfffff1, 24 }, { 0x1ffffed, 25 }, { 0x7fff2, 19 }, { 0x1fffe3, 21 },
+  { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 }, { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 },
+  { 0x7ffffe2, 27 }, { 0xfffff2, 24 }, { 0x1fffe4, 21 }, { 0x1fffe5, 21 },
+  { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 }, { 0xffffffd, 28 }, { 0x7ffffe3, 27 },
+  { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 }, { 0xfffec, 20 }, { 0xfffff3, 24 },
+  { 0xfffed, 20 }, { 0x1fffe6, 21 }, { 0x3fffe9, 22 }, { 0x1fffe7, 21 },
+  { 0x1fffe8, 21 }, { 0x7ffff3, 23 }, { 0x3fffea, 22 }, { 0x3fffeb, 22 },
+  { 0x1ffffee, 25 }, { 0x1ffffef, 25 }, { 0xfffff4, 24 }, { 0xfffff5, 24 },
+  { 0x3ffffea, 26 }, { 0x7ffff4, 23 }, { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 },
+  { 0x3ffffec, 26 }, { 0x3ffffed, 26 }, { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 },
+  { 0x7ffffe9, 27 }, { 0x7ffffea, 27 }, { 0x7ffffeb, 27 }, { 0xffffffe, 28 },
+  { 0x7ffffec, 27 }, { 0x7ffffed, 27 }, { 0x7ffffee, 27 }, { 0x7ffffef, 27 },
+  { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+};
+
+constexpr std::size_t kStaticTableSize =
+    sizeof(kStaticTable) / sizeof(kStaticTable[0]);
+
+// The overhead of each entry of the dynamic table.
+constexpr std::size_t kEntryOverhead = 32;
+
+// The EOS symbol.
+constexpr int kEos = 256;
+
+std::size_t EntrySize(std::string_view name, std::string_view value) {
+  return kEntryOverhead + name.size() + value.size();
+}
+
+// Map the names of the static table to their first indexes.
+// The entries with the same name are next to each other.
+const std::unordered_map<std::string_view, std::size_t>& GetStaticIndexes() {
+  static const auto indexes = []() {
+    std::unordered_map<std::string_view, std::size_t> indexes;
+    for (std::size_t i = kStaticTableSize; i > 0; --i) {
+      indexes[kStaticTable[i - 1].first] = i;
+    }
+    return indexes;
+  }();
+  return indexes;
+}
+
+// The binary tree for Huffman decoding.
+// Each node has two children for bit 0 and 1, a positive child is the index of
+// the next node, a negative one -(symbol + 1) is a leaf.
+class HuffmanTree {
+public:
+  HuffmanTree() {
+    nodes_.push_back({ 0, 0 });
+
+    for (int symbol = 0; symbol <= kEos; ++symbol) {
+      std::uint32_t code = 0x3fffffff;
+      int length = 30;
+      if (symbol != kEos) {
+        code = kHuffmanCodes[symbol].first;
+        length = kHuffmanCodes[symbol].second;
+      }
+
+      int node = 0;
+      for (int i = length - 1; i > 0; --i) {
+        int bit = (code >> i) & 1;
+        if (nodes_[node][bit] == 0) {
+          int next = static_cast<int>(nodes_.size());
+          nodes_.push_back({ 0, 0 });
+          nodes_[node][bit] = next;
+        }
+        node = nodes_[node][bit];
+      }
+      nodes_[node][code & 1] = -(symbol + 1);
+    }
+  }
+
+  int Next(int node, int bit) const {
+    return nodes_[node][bit];
+  }
+
+private:
+  std::vector<std::array<int, 2>> nodes_;
+};
+
+const HuffmanTree& GetHuffmanTree() {
+  static const HuffmanTree tree;
+  return tree;
+}
+
+bool DecodeString(const unsigned char** data, const unsigned char* end,
+                  std::string* str) {
+  if (*data == end) {
+    return false;
+  }
+
+  bool huffman = (**data & 0x80) != 0;
+
+  std::size_t length = 0;
+  if (!hpack::DecodeInteger(data, end, 7, &length)) {
+    return false;
+  }
+
+  if (static_cast<std::size_t>(end - *data) < length) {
+    return false;
+  }
+
+  const unsigned char* p = *data;
+  *data += length;
+
+  if (huffman) {
+    str->clear();
+    return hpack::HuffmanDecode(p, length, str);
+  }
+
+  str->assign(reinterpret_cast<const char*>(p), length);
+  return true;
+}
+
+// The fields never added to the dynamic table, and encoded as never indexed
+// so that the intermediaries won't either.
+bool IsSensitive(std::string_view name) {
+  return name == "authorization" || name == "proxy-authorization" ||
+         name == "cookie" || name == "set-cookie";
+}
+
+// The fields not worth adding to the dynamic table because their values
+// change with each message.
+bool IsVolatile(std::string_view name) {
+  return name == ":path" || name == "content-length" ||
+         name == "content-range" || name == "etag" ||
+         name == "last-modified" || name == "if-modified-since" ||
+         name == "if-none-match";
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+
+void HpackTable::set_max_size(std::size_t max_size) {
+  max_size_ = max_size;
+  Evict(max_size_);
+}
+
+const Header* HpackTable::Get(std::size_t index) const {
+  if (index == 0) {
+    return nullptr;
+  }
+  if (index <= kStaticTableSize) {
+    return &kStaticTable[index - 1];
+  }
+  index -= kStaticTableSize + 1;
+  if (index < entries_.size()) {
+    return &entries_[index];
+  }
+  return nullptr;
+}
+
+void HpackTable::Add(std::string name, std::string value) {
+  std::size_t entry_size = EntrySize(name, value);
+
+  if (entry_size > max_size_) {
+    // Not an error, the table is just emptied.
+    Evict(0);
+    return;
+  }
+
+  Evict(max_size_ - entry_size);
+
+  entries_.emplace_front(std::move(name), std::move(value));
+  size_ += entry_size;
+}
+
+std::size_t HpackTable::Find(std::string_view name, std::string_view value,
+                             bool* value_matched) const {
+  *value_matched = false;
+
+  std::size_t name_index = 0;
+
+  const auto& static_indexes = GetStaticIndexes();
+  auto it = static_indexes.find(name);
+  if (it != static_indexes.end()) {
+    name_index = it->second;
+    for (std::size_t i = name_index;
+         i <= kStaticTableSize && kStaticTable[i - 1].first == name; ++i) {
+      if (kStaticTable[i - 1].second == value) {
+        *value_matched = true;
+        return i;
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].first == name) {
+      if (entries_[i].second == value) {
+        *value_matched = true;
+        return kStaticTableSize + 1 + i;
+      }
+      if (name_index == 0) {
+        name_index = kStaticTableSize + 1 + i;
+      }
+    }
+  }
+
+  return name_index;
+}
+
+void HpackTable::Evict(std::size_t size) {
+  while (size_ > size && !entries_.empty()) {
+    size_ -= EntrySize(entries_.back().first, entries_.back().second);
+    entries_.pop_back();
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+bool HpackDecoder::Decode(const char* data, std::size_t length,
+                          std::vector<Header>* headers) {
+  auto p = reinterpret_cast<const unsigned char*>(data);
+  auto end = p + length;
+
+  // The dynamic table size updates must be at the beginning of the block.
+  bool field_decoded = false;
+
+  while (p < end) {
+    unsigned char octet = *p;
+
+    if ((octet & 0x80) != 0) {
+      // Indexed header field.
+      std::size_t index = 0;
+      if (!hpack::DecodeInteger(&p, end, 7, &index)) {
+        return false;
+      }
+      const Header* header = table_.Get(index);
+      if (header == nullptr) {
+        return false;
+      }
+      headers->push_back(*header);
+
+    } else if ((octet & 0xe0) == 0x20) {
+      // Dynamic table size update.
+      std::size_t max_size = 0;
+      if (field_decoded || !hpack::DecodeInteger(&p, end, 5, &max_size) ||
+          max_size > max_table_size_) {
+        return false;
+      }
+      table_.set_max_size(max_size);
+      continue;
+
+    } else {
+      // Literal header field with incremental indexing (01), or without
+      // indexing (0000), or never indexed (0001).
+      bool indexing = (octet & 0xc0) == 0x40;
+
+      std::size_t index = 0;
+      if (!hpack::DecodeInteger(&p, end, indexing ? 6 : 4, &index)) {
+        return false;
+      }
+
+      Header header;
+      if (index != 0) {
+        const Header* indexed = table_.Get(index);
+        if (indexed == nullptr) {
+          return false;
+        }
+        header.first = indexed->first;
+      } else if (!DecodeString(&p, end, &header.first)) {
+        return false;
+      }
+
+      if (!DecodeString(&p, end, &header.second)) {
+        return false;
+      }
+
+      if (indexing) {
+        table_.Add(header.first, header.second);
+      }
+      headers->push_back(std::move(header));
+    }
+
+    field_decoded = true;
+  }
+
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+void HpackEncoder::set_max_table_size(std::size_t max_table_size) {
+  // Don't use a table larger than the default even if the peer allows it.
+  max_table_size = std::min(max_table_size, kHpackTableSize);
+
+  if (max_table_size != table_.max_size()) {
+    table_.set_max_size(max_table_size);
+    table_size_changed_ = true;
+  }
+}
+
+void HpackEncoder::Encode(std::string_view name, std::string_view value,
+                          std::string* block) {
+  if (table_size_changed_) {
+    // The blocks are encoded one after another, so this is the start of the
+    // next block.
+    hpack::EncodeInteger(table_.max_size(), 5, 0x20, block);
+    table_size_changed_ = false;
+  }
+
+  name_.assign(name);
+  std::transform(name_.begin(), name_.end(), name_.begin(), [](char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  });
+
+  bool value_matched = false;
+  std::size_t index = table_.Find(name_, value, &value_matched);
+
+  if (value_matched) {
+    hpack::EncodeInteger(index, 7, 0x80, block);
+    return;
+  }
+
+  bool indexing = false;
+  if (IsSensitive(name_)) {
+    hpack::EncodeInteger(index, 4, 0x10, block);
+  } else if (IsVolatile(name_)) {
+    hpack::EncodeInteger(index, 4, 0x00, block);
+  } else {
+    hpack::EncodeInteger(index, 6, 0x40, block);
+    indexing = true;
+  }
+
+  if (index == 0) {
+    hpack::EncodeString(name_, block);
+  }
+  hpack::EncodeString(value, block);
+
+  if (indexing) {
+    table_.Add(name_, std::string{ value });
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+namespace hpack {
+
+void EncodeInteger(std::size_t value, int prefix_bits, unsigned char flags,
+                   std::string* output) {
+  std::size_t max_prefix = (std::size_t{ 1 } << prefix_bits) - 1;
+
+  if (value < max_prefix) {
+    output->push_back(static_cast<char>(flags | value));
+    return;
+  }
+
+  output->push_back(static_cast<char>(flags | max_prefix));
+  value -= max_prefix;
+
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+bool DecodeInteger(const unsigned char** data, const unsigned char* end,
+                   int prefix_bits, std::size_t* value) {
+  const unsigned char* p = *data;
+  if (p == end) {
+    return false;
+  }
+
+  std::size_t max_prefix = (std::size_t{ 1 } << prefix_bits) - 1;
+  std::size_t result = *p++ & max_prefix;
+
+  if (result == max_prefix) {
+    for (int shift = 0;; shift += 7) {
+      // Large enough for any sane length or index.
+      if (p == end || shift > 28) {
+        return false;
+      }
+      unsigned char octet = *p++;
+      result += static_cast<std::size_t>(octet & 0x7f) << shift;
+      if ((octet & 0x80) == 0) {
+        break;
+      }
+    }
+  }
+
+  *value = result;
+  *data = p;
+  return true;
+}
+
+void EncodeString(std::string_view str, std::string* output) {
+  std::size_t huffman_length = HuffmanEncodedLength(str);
+
+  if (huffman_length < str.size()) {
+    EncodeInteger(huffman_length, 7, 0x80, output);
+    HuffmanEncode(str, output);
+  } else {
+    EncodeInteger(str.size(), 7, 0x00, output);
+    output->append(str.data(), str.size());
+  }
+}
+
+std::size_t HuffmanEncodedLength(std::string_view str) {
+  std::size_t bits = 0;
+  for (char c : str) {
+    bits += kHuffmanCodes[static_cast<unsigned char>(c)].second;
+  }
+  return (bits + 7) / 8;
+}
+
+void HuffmanEncode(std::string_view str, std::string* output) {
+  std::uint64_t bits = 0;
+  int count = 0;  // The number of the pending bits
+
+  for (char c : str) {
+    const auto& code = kHuffmanCodes[static_cast<unsigned char>(c)];
+    bits = (bits << code.second) | code.first;
+    count += code.second;
+
+    while (count >= 8) {
+      count -= 8;
+      output->push_back(static_cast<char>(bits >> count));
+    }
+    bits &= (std::uint64_t{ 1 } << count) - 1;
+  }
+
+  if (count > 0) {
+    // Pad with the most significant bits of EOS, i.e., all ones.
+    output->push_back(
+        static_cast<char>((bits << (8 - count)) | (0xff >> count)));
+  }
+}
+
+bool HuffmanDecode(const unsigned char* data, std::size_t length,
+                   std::string* output) {
+  const HuffmanTree& tree = GetHuffmanTree();
+
+  int node = 0;
+  int depth = 0;  // The number of bits since the last symbol
+  bool all_ones = true;
+
+  for (std::size_t i = 0; i < length; ++i) {
+    for (int shift = 7; shift >= 0; --shift) {
+      int bit = (data[i] >> shift) & 1;
+      int next = tree.Next(node, bit);
+
+      if (next < 0) {
+        int symbol = -next - 1;
+        if (symbol == kEos) {
+          return false;
+        }
+        output->push_back(static_cast<char>(symbol));
+        node = 0;
+        depth = 0;
+        all_ones = true;
+      } else {
+        node = next;
+        ++depth;
+        all_ones = all_ones && bit == 1;
+      }
+    }
+  }
+
+  // The padding must be shorter than 8 bits and a prefix of EOS.
+  return depth < 8 && all_ones;
+}
+
+}  // namespace hpack
+
+}  // namespace webcc
@@ -0,0 +1,151 @@
+#ifndef WEBCC_HPACK_H_
+#define WEBCC_HPACK_H_
+
+// HPACK, the header compression for HTTP/2 (RFC 7541).
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "webcc/common.h"
+
+namespace webcc {
+
+// The default size of the dynamic table (SETTINGS_HEADER_TABLE_SIZE).
+constexpr std::size_t kHpackTableSize = 4096;
+
+// -----------------------------------------------------------------------------
+
+// The indexing table, i.e., the static table followed by the dynamic table.
+// The names in the table are all lowercase.
+class HpackTable {
+public:
+  explicit HpackTable(std::size_t max_size = kHpackTableSize)
+      : max_size_(max_size) {
+  }
+
+  // The size of the dynamic table, i.e., the sum of the sizes of its entries.
+  std::size_t size() const {
+    return size_;
+  }
+
+  std::size_t max_size() const {
+    return max_size_;
+  }
+
+  // Set the maximum size of the dynamic table, evicting the oldest entries if
+  // necessary.
+  void set_max_size(std::size_t max_size);
+
+  // Get the entry by index (from 1). Return null if the index is invalid.
+  const Header* Get(std::size_t index) const;
+
+  // Add an entry to the dynamic table, evicting the oldest entries if
+  // necessary.
+  void Add(std::string name, std::string value);
+
+  // Find the entry matching the name and the value, or the name only.
+  // The name must be lowercase.
+  // Return the index (from 1), or 0 if not found.
+  std::size_t Find(std::string_view name, std::string_view value,
+                   bool* value_matched) const;
+
+private:
+  // Evict the oldest entries until the size is no larger than `size`.
+  void Evict(std::size_t size);
+
+  // The entries of the dynamic table, the newest first.
+  std::deque<Header> entries_;
+
+  std::size_t size_ = 0;
+  std::size_t max_size_;
+};
+
+// -----------------------------------------------------------------------------
+
+class HpackDecoder {
+public:
+  explicit HpackDecoder(std::size_t max_table_size = kHpackTableSize)
+      : table_(max_table_size), max_table_size_(max_table_size) {
+  }
+
+  HpackDecoder(const HpackDecoder&) = delete;
+  HpackDecoder& operator=(const HpackDecoder&) = delete;
+
+  // Decode a complete header block into `headers`.
+  // Return false on any error, which is a connection error of type
+  // COMPRESSION_ERROR.
+  bool Decode(const char* data, std::size_t length,
+              std::vector<Header>* headers);
+
+private:
+  HpackTable table_;
+
+  // The maximum size of the dynamic table the encoder could use, i.e., the
+  // SETTINGS_HEADER_TABLE_SIZE sent to the peer.
+  std::size_t max_table_size_;
+};
+
+// -----------------------------------------------------------------------------
+
+class HpackEncoder {
+public:
+  HpackEncoder() = default;
+
+  HpackEncoder(const HpackEncoder&) = delete;
+  HpackEncoder& operator=(const HpackEncoder&) = delete;
+
+  // Set the maximum size of the dynamic table, i.e., the
+  // SETTINGS_HEADER_TABLE_SIZE received from the peer.
+  void set_max_table_size(std::size_t max_table_size);
+
+  // Encode a header field and append it to the header block.
+  // The name is lowercased. The sensitive fields (e.g., Authorization) and the
+  // fields changing with each message (e.g., Content-Length) are not added to
+  // the dynamic table.
+  void Encode(std::string_view name, std::string_view value,
+              std::string* block);
+
+private:
+  HpackTable table_;
+
+  // Signal the change of the table size at the start of the next block.
+  bool table_size_changed_ = false;
+
+  // The buffer for the lowercased name.
+  std::string name_;
+};
+
+// -----------------------------------------------------------------------------
+
+namespace hpack {
+
+// Encode an integer with an N-bit prefix. The bits before the prefix in the
+// first octet are given by `flags`.
+void EncodeInteger(std::size_t value, int prefix_bits, unsigned char flags,
+                   std::string* output);
+
+// Decode an integer with an N-bit prefix from `*data` and move `*data` after
+// it. Return false if the data is incomplete or the integer overflows.
+bool DecodeInteger(const unsigned char** data, const unsigned char* end,
+                   int prefix_bits, std::size_t* value);
+
+// Encode a string literal, Huffman encoded if it's shorter.
+void EncodeString(std::string_view str, std::string* output);
+
+// The length of the Huffman encoded string.
+std::size_t HuffmanEncodedLength(std::string_view str);
+
+void HuffmanEncode(std::string_view str, std::string* output);
+
+// Return false if the data is not a valid Huffman encoded string.
+bool HuffmanDecode(const unsigned char* data, std::size_t length,
+                   std::string* output);
+
+}  // namespace hpack
+
+}  // namespace webcc
+
+#endif  // WEBCC_HPACK_H_
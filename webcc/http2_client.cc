@@ -0,0 +1,706 @@
+#include "webcc/http2_client.h"
+
+#include <chrono>
+
+#include "boost/algorithm/string.hpp"
+#include "boost/asio/connect.hpp"
+#include "boost/asio/post.hpp"
+#include "boost/asio/ssl.hpp"
+#include "boost/asio/write.hpp"
+
+#include "webcc/internal/globals.h"
+#include "webcc/logger.h"
+
+using boost::asio::ip::tcp;
+using namespace std::placeholders;
+namespace ssl = boost::asio::ssl;
+
+namespace webcc {
+
+struct Http2ClientBase::Call {
+  RequestPtr request;
+  bool stream = false;
+  ProgressCallback progress_callback;
+
+  ResponsePtr response;
+  ResponseParser response_parser;
+
+  std::uint32_t stream_id = 0;
+  bool headers_received = false;
+
+  // The length of the content read, and the total length of it (kInvalidSize
+  // if the response has no Content-Length).
+  std::size_t current_length = 0;
+  std::size_t total_length = kInvalidSize;
+
+  // Guarded by the mutex of the connection.
+  // The stream has been opened.
+  bool sent = false;
+  // Increased as the response is read, for the read timeouts.
+  std::size_t progress = 0;
+  bool ended = false;
+  bool retry = false;
+  Error error;
+};
+
+// -----------------------------------------------------------------------------
+
+Http2ClientBase::Http2ClientBase(std::string_view default_port)
+    : Http2Session(false),
+      work_guard_(boost::asio::make_work_guard(io_context_)),
+      default_port_(default_port),
+      resolver_(io_context_),
+      connect_timer_(io_context_) {
+}
+
+Http2ClientBase::~Http2ClientBase() {
+  // Close() should have been called.
+  if (thread_.joinable()) {
+    io_context_.stop();
+    if (thread_.get_id() != std::this_thread::get_id()) {
+      thread_.join();
+    } else {
+      thread_.detach();
+    }
+  }
+}
+
+bool Http2ClientBase::closed() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return state_ == State::kClosed || state_ == State::kUnsupported ||
+         draining_ || stopped_;
+}
+
+bool Http2ClientBase::unsupported() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return state_ == State::kUnsupported;
+}
+
+void Http2ClientBase::Connect(const std::string& host,
+                              const std::string& port) {
+  host_ = host;
+  port_ = port.empty() ? default_port_ : port;
+
+  LOG_INFO("Resolve host... (%s)", host_.c_str());
+
+  resolver_.async_resolve(
+      host_, port_,
+      std::bind(&Http2ClientBase::OnResolve, shared_from_this(), _1, _2));
+
+  thread_ = std::thread([this]() { io_context_.run(); });
+}
+
+ResponsePtr Http2ClientBase::Send(RequestPtr request, bool stream,
+                                  ProgressCallback callback) {
+  auto call = std::make_shared<Call>();
+  call->request = request;
+  call->stream = stream;
+  call->progress_callback = callback;
+
+  std::unique_lock<std::mutex> lock{ mutex_ };
+
+  if (stopped_) {
+    return {};
+  }
+
+  // NOTE: Post with the lock held so that the loop can't be stopped by Close()
+  // before the call is queued.
+  auto self = shared_from_this();
+  boost::asio::post(io_context_, [self, call]() {
+    if (self->state_ == State::kConnecting ||
+        self->state_ == State::kConnected) {
+      self->pending_calls_.push_back(call);
+      self->StartCalls();
+      self->Flush();
+    } else {
+      self->EndCall(call, Error{}, true);
+    }
+  });
+
+  while (!call->ended) {
+    if (!call->sent) {
+      // Connecting, or waiting for the other streams to end.
+      cv_.wait(lock);
+      continue;
+    }
+
+    const std::size_t progress = call->progress;
+    const int timeout =
+        progress > 1 ? subsequent_read_timeout_ : read_timeout_;
+
+    bool ok = cv_.wait_for(lock, std::chrono::seconds(timeout),
+                           [&call, progress]() {
+                             return call->ended || call->progress != progress;
+                           });
+    if (!ok) {
+      LOG_WARN("Operation timeout");
+
+      call->ended = true;
+      call->error.Set(error_codes::kSocketReadError, "Socket read error");
+      call->error.set_timeout(true);
+
+      boost::asio::post(io_context_, [self, call]() { self->DropCall(call); });
+    }
+  }
+
+  if (call->error) {
+    throw call->error;
+  }
+
+  if (call->retry) {
+    return {};
+  }
+
+  return call->response;
+}
+
+void Http2ClientBase::Close() {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+
+    auto self = shared_from_this();
+    boost::asio::post(io_context_, [self]() {
+      self->Abort(Error{ error_codes::kStateError, "Connection closed" });
+    });
+  }
+
+  work_guard_.reset();
+
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+
+  // Run the handlers left, if any (e.g., the thread has never started).
+  io_context_.restart();
+  io_context_.run();
+}
+
+void Http2ClientBase::StartSession() {
+  LOG_INFO("Start HTTP/2");
+
+  SetState(State::kConnected);
+
+  // A frame is up to 16KB (plus the header), read more each time.
+  buffer_.resize(http2::kDefaultMaxFrameSize);
+
+  Http2Session::Start();
+
+  StartCalls();
+  Flush();
+  AsyncRead();
+}
+
+void Http2ClientBase::Abort(const Error& error) {
+  if (state_ != State::kUnsupported) {
+    SetState(State::kClosed);
+  }
+  EndCalls(error);
+  CloseSocket();
+}
+
+void Http2ClientBase::AbortUnsupported() {
+  SetState(State::kUnsupported);
+
+  for (auto& call : pending_calls_) {
+    EndCall(call, Error{}, true);
+  }
+  pending_calls_.clear();
+
+  CloseSocket();
+}
+
+void Http2ClientBase::OnHeaders(std::uint32_t stream_id,
+                                std::vector<Header>&& headers,
+                                bool end_stream) {
+  auto it = calls_.find(stream_id);
+  if (it == calls_.end()) {
+    return;
+  }
+
+  CallPtr call = it->second;
+
+  if (call->headers_received) {
+    // The trailer, which must end the stream, is ignored.
+    if (!end_stream) {
+      FailCall(call, Error{ error_codes::kParseError,
+                            "Response parse error" });
+    } else {
+      FinishCall(call);
+    }
+    return;
+  }
+
+  std::string status;
+
+  std::vector<Header> fields;
+  fields.reserve(headers.size());
+
+  for (Header& header : headers) {
+    if (header.first == ":status") {
+      status = std::move(header.second);
+    } else if (!header.first.empty() && header.first[0] != ':' &&
+               !http2::IsConnectionSpecific(header.first)) {
+      fields.push_back(std::move(header));
+    }
+  }
+
+  // Skip the informational responses (e.g., 100 Continue).
+  if (status.size() == 3 && status[0] == '1' && !end_stream) {
+    return;
+  }
+
+  call->headers_received = true;
+
+  if (!call->response_parser.SetHeaders("HTTP/2 " + status,
+                                        std::move(fields), !end_stream)) {
+    LOG_ERRO("Response parse error");
+    FailCall(call, Error{ error_codes::kParseError, "Response parse error" });
+    return;
+  }
+
+  call->total_length = call->response_parser.content_length();
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ++call->progress;
+  }
+
+  if (end_stream) {
+    FinishCall(call);
+  }
+}
+
+void Http2ClientBase::OnData(std::uint32_t stream_id, const char* data,
+                             std::size_t length, bool end_stream) {
+  auto it = calls_.find(stream_id);
+  if (it == calls_.end()) {
+    return;
+  }
+
+  CallPtr call = it->second;
+
+  if (length > 0) {
+    if (!call->response_parser.Parse(data, length)) {
+      LOG_ERRO("Response parse error");
+      FailCall(call, Error{ error_codes::kParseError,
+                            "Response parse error" });
+      return;
+    }
+
+    call->current_length += length;
+
+    if (call->progress_callback != nullptr) {
+      call->progress_callback(call->current_length, call->total_length, true);
+    }
+
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    ++call->progress;
+  }
+
+  if (end_stream) {
+    FinishCall(call);
+  }
+}
+
+void Http2ClientBase::OnStreamClosed(std::uint32_t stream_id,
+                                     std::uint32_t error_code) {
+  auto it = calls_.find(stream_id);
+  if (it == calls_.end()) {
+    return;
+  }
+
+  CallPtr call = it->second;
+  calls_.erase(it);
+
+  if (error_code == http2::error_codes::kRefusedStream) {
+    // The request has not been processed, send it again (see StartCalls()).
+    LOG_INFO("Stream %u refused, queue the request again", stream_id);
+    call->headers_received = false;
+    call->current_length = 0;
+    call->total_length = kInvalidSize;
+    pending_calls_.push_front(call);
+    return;
+  }
+
+  LOG_ERRO("Stream %u reset (error code: %u)", stream_id, error_code);
+  EndCall(call, Error{ error_codes::kSocketReadError, "Stream reset" });
+}
+
+void Http2ClientBase::OnResolve(boost::system::error_code ec,
+                                tcp::resolver::results_type endpoints) {
+  if (ec) {
+    if (ec != boost::asio::error::operation_aborted) {
+      LOG_ERRO("Host resolve error (%s)", ec.message().c_str());
+    }
+    Abort(Error{ error_codes::kResolveError, "Host resolve error" });
+    return;
+  }
+
+  LOG_INFO("Host resolved");
+
+  if (connect_timeout_ > 0) {
+    LOG_INFO("Start connect deadline timer (%ds)", connect_timeout_);
+    connect_timer_.expires_after(
+        boost::asio::chrono::seconds(connect_timeout_));
+    connect_timer_.async_wait(
+        std::bind(&Http2ClientBase::OnConnectTimer, shared_from_this(), _1));
+  }
+
+  LOG_INFO("Connect socket...");
+
+  auto self = shared_from_this();
+  boost::asio::async_connect(
+      GetSocket(), endpoints,
+      [self](boost::system::error_code ec, tcp::endpoint /*endpoint*/) {
+        self->OnConnect(ec);
+      });
+}
+
+void Http2ClientBase::OnConnect(boost::system::error_code ec) {
+  connect_timer_.cancel();
+
+  if (ec) {
+    if (ec == boost::asio::error::operation_aborted) {
+      LOG_WARN("Connect operation aborted");
+    } else {
+      LOG_ERRO("Connect error (%s)", ec.message().c_str());
+    }
+    Abort(Error{ error_codes::kConnectError, "Socket connect error" });
+    return;
+  }
+
+  LOG_INFO("Socket connected");
+
+  OnConnected();
+}
+
+void Http2ClientBase::OnConnectTimer(boost::system::error_code ec) {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  LOG_WARN("Operation timeout");
+
+  // OnConnect() will be called with `error::operation_aborted`.
+  Error error{ error_codes::kConnectError, "Socket connect error" };
+  error.set_timeout(true);
+  Abort(error);
+}
+
+void Http2ClientBase::StartCalls() {
+  if (state_ != State::kConnected) {
+    return;
+  }
+
+  while (!pending_calls_.empty()) {
+    if (going_away()) {
+      // Send the requests not sent yet on another connection.
+      {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        draining_ = true;
+      }
+      for (auto& call : pending_calls_) {
+        EndCall(call, Error{}, true);
+      }
+      pending_calls_.clear();
+      return;
+    }
+
+    if (stream_count() >= peer_max_concurrent_streams()) {
+      break;
+    }
+
+    CallPtr call = pending_calls_.front();
+    pending_calls_.pop_front();
+
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      if (call->ended) {
+        continue;  // Timeout
+      }
+      call->sent = true;
+      ++call->progress;
+    }
+    cv_.notify_all();
+
+    const RequestPtr& request = call->request;
+    const Url& url = request->url();
+
+    std::string target = url.path().empty() ? "/" : url.path();
+    if (!url.query().empty()) {
+      target += "?";
+      target += url.query();
+    }
+
+    call->response.reset(new Response{});
+    call->response_parser.Init(call->response.get(), call->stream);
+
+    // Response to HEAD could also have Content-Length.
+    call->response_parser.set_ignore_body(request->method() == methods::kHead);
+
+    call->stream_id = OpenStream();
+    calls_[call->stream_id] = call;
+
+    // The Host header is replaced by the :authority pseudo-header field.
+    std::string block;
+    encoder().Encode(":method", request->method(), &block);
+    encoder().Encode(":scheme", url.scheme(), &block);
+    encoder().Encode(":authority", request->GetHeader(headers::kHost), &block);
+    encoder().Encode(":path", target, &block);
+
+    for (const HeaderView& header : request->headers().data()) {
+      if (!boost::iequals(header.first, headers::kHost) &&
+          !http2::IsConnectionSpecific(header.first)) {
+        encoder().Encode(header.first, header.second, &block);
+      }
+    }
+
+    LOG_VERB("Request (stream %u):\n%s", call->stream_id,
+             request->Dump(internal::log_prefix::kOutgoing).c_str());
+
+    Submit(call->stream_id, block, request->body());
+  }
+}
+
+void Http2ClientBase::FinishCall(const CallPtr& call) {
+  calls_.erase(call->stream_id);
+
+  if (!call->response_parser.EndContent()) {
+    LOG_ERRO("Response parse error");
+    EndCall(call, Error{ error_codes::kParseError, "Response parse error" });
+    return;
+  }
+
+  LOG_VERB("Response (stream %u):\n%s", call->stream_id,
+           call->response->Dump(internal::log_prefix::kIncoming).c_str());
+
+  EndCall(call, Error{});
+}
+
+void Http2ClientBase::FailCall(const CallPtr& call, const Error& error) {
+  calls_.erase(call->stream_id);
+  EndCall(call, error);
+  ResetStream(call->stream_id, http2::error_codes::kCancel);
+}
+
+void Http2ClientBase::EndCall(const CallPtr& call, const Error& error,
+                              bool retry) {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (call->ended) {
+      return;
+    }
+    call->ended = true;
+    call->error = error;
+    call->retry = retry;
+  }
+  cv_.notify_all();
+}
+
+void Http2ClientBase::EndCalls(const Error& error) {
+  for (auto& pair : calls_) {
+    EndCall(pair.second, error);
+  }
+  calls_.clear();
+
+  for (auto& call : pending_calls_) {
+    EndCall(call, error);
+  }
+  pending_calls_.clear();
+}
+
+void Http2ClientBase::DropCall(const CallPtr& call) {
+  auto it = calls_.find(call->stream_id);
+  if (it != calls_.end() && it->second == call) {
+    calls_.erase(it);
+    ResetStream(call->stream_id, http2::error_codes::kCancel);
+    Flush();
+  }
+}
+
+void Http2ClientBase::CloseSocket() {
+  resolver_.cancel();
+  connect_timer_.cancel();
+
+  SocketType& socket = GetSocket();
+  if (socket.is_open()) {
+    SocketShutdownClose(socket);
+  }
+}
+
+void Http2ClientBase::AsyncRead() {
+  AsyncReadSome(
+      boost::asio::buffer(buffer_),
+      std::bind(&Http2ClientBase::OnRead, shared_from_this(), _1, _2));
+}
+
+void Http2ClientBase::OnRead(boost::system::error_code ec,
+                             std::size_t length) {
+  if (ec) {
+    if (ec != boost::asio::error::operation_aborted) {
+      LOG_ERRO("Socket read error (%s)", ec.message().c_str());
+    }
+    Abort(Error{ error_codes::kSocketReadError, "Socket read error" });
+    return;
+  }
+
+  if (!Feed(buffer_.data(), length)) {
+    // Close after the GOAWAY has been written.
+    SetState(State::kClosed);
+    EndCalls(Error{ error_codes::kParseError, "HTTP/2 protocol error" });
+    closing_ = true;
+    Flush();
+    return;
+  }
+
+  // The streams refused or closed make room for the calls queued.
+  StartCalls();
+  Flush();
+
+  if (going_away() && calls_.empty()) {
+    LOG_INFO("The connection is going away, close it");
+    Abort(Error{ error_codes::kStateError, "Connection closed" });
+    return;
+  }
+
+  AsyncRead();
+}
+
+void Http2ClientBase::Flush() {
+  if (is_writing_) {
+    return;
+  }
+
+  if (!HasOutput()) {
+    if (closing_) {
+      CloseSocket();
+    }
+    return;
+  }
+
+  if (!GetSocket().is_open()) {
+    return;
+  }
+
+  TakeOutput(&writing_);
+  is_writing_ = true;
+
+  AsyncWrite({ boost::asio::buffer(writing_) },
+             std::bind(&Http2ClientBase::OnWrite, shared_from_this(), _1, _2));
+}
+
+void Http2ClientBase::OnWrite(boost::system::error_code ec,
+                              std::size_t /*length*/) {
+  is_writing_ = false;
+
+  if (ec) {
+    if (ec != boost::asio::error::operation_aborted) {
+      LOG_ERRO("Socket write error (%s)", ec.message().c_str());
+    }
+    Abort(Error{ error_codes::kSocketWriteError, "Socket write error" });
+    return;
+  }
+
+  // Go on with the bodies being sent.
+  WriteData();
+
+  // The streams closed make room for the calls queued.
+  StartCalls();
+
+  Flush();
+}
+
+void Http2ClientBase::SetState(State state) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  state_ = state;
+}
+
+// -----------------------------------------------------------------------------
+
+void Http2Client::AsyncWrite(
+    const std::vector<boost::asio::const_buffer>& buffers,
+    AsyncRWHandler&& handler) {
+  boost::asio::async_write(socket_, buffers, std::move(handler));
+}
+
+void Http2Client::AsyncReadSome(boost::asio::mutable_buffer buffer,
+                                AsyncRWHandler&& handler) {
+  socket_.async_read_some(buffer, std::move(handler));
+}
+
+// -----------------------------------------------------------------------------
+
+SslHttp2Client::SslHttp2Client(ssl::context& ssl_context,
+                               SslVerify ssl_verify)
+    : Http2ClientBase("443"),
+      ssl_stream_(io_context_, ssl_context),
+      ssl_verify_(ssl_verify) {
+}
+
+void SslHttp2Client::AsyncWrite(
+    const std::vector<boost::asio::const_buffer>& buffers,
+    AsyncRWHandler&& handler) {
+  boost::asio::async_write(ssl_stream_, buffers, std::move(handler));
+}
+
+void SslHttp2Client::AsyncReadSome(boost::asio::mutable_buffer buffer,
+                                   AsyncRWHandler&& handler) {
+  ssl_stream_.async_read_some(buffer, std::move(handler));
+}
+
+void SslHttp2Client::OnConnected() {
+  // See SslClient::OnConnected().
+  ssl_stream_.set_verify_mode(ssl::verify_peer);
+
+  if (ssl_verify_ == SslVerify::kHostName) {
+    if (!SSL_set_tlsext_host_name(ssl_stream_.native_handle(),
+                                  host_.c_str())) {
+      LOG_ERRO("Failed to set SNI host name for SSL");
+    }
+
+    ssl_stream_.set_verify_callback(ssl::host_name_verification{ host_ });
+  }
+
+  // Offer HTTP/1.1 too, so that the handshake succeeds with a server without
+  // HTTP/2 and the server's choice can be told.
+  static const unsigned char kAlpnProtos[] = "\x02h2\x08http/1.1";
+  if (SSL_set_alpn_protos(ssl_stream_.native_handle(), kAlpnProtos,
+                          sizeof(kAlpnProtos) - 1) != 0) {
+    LOG_ERRO("Failed to set ALPN protocols for SSL");
+  }
+
+  auto self = std::static_pointer_cast<SslHttp2Client>(shared_from_this());
+
+  ssl_stream_.async_handshake(
+      ssl::stream_base::client,
+      std::bind(&SslHttp2Client::OnHandshake, self, _1));
+}
+
+void SslHttp2Client::OnHandshake(boost::system::error_code ec) {
+  if (ec) {
+    LOG_ERRO("Handshake error (%s)", ec.message().c_str());
+    Abort(Error{ error_codes::kHandshakeError, "Handshake error" });
+    return;
+  }
+
+  LOG_INFO("Handshake OK");
+
+  const unsigned char* alpn = nullptr;
+  unsigned int alpn_length = 0;
+  SSL_get0_alpn_selected(ssl_stream_.native_handle(), &alpn, &alpn_length);
+
+  if (std::string_view(reinterpret_cast<const char*>(alpn), alpn_length) !=
+      http2::kAlpnId) {
+    LOG_INFO("HTTP/2 is not supported by the server");
+    AbortUnsupported();
+    return;
+  }
+
+  StartSession();
+}
+
+}  // namespace webcc
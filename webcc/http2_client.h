@@ -0,0 +1,278 @@
+#ifndef WEBCC_HTTP2_CLIENT_H_
+#define WEBCC_HTTP2_CLIENT_H_
+
+// HTTP/2 client connections, used by the client session to multiplex the
+// requests to the same server over a single connection.
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/asio/executor_work_guard.hpp"
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/ssl/context.hpp"
+#include "boost/asio/ssl/stream.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+#include "webcc/client_base.h"
+#include "webcc/http2_session.h"
+
+namespace webcc {
+
+// The base class of the HTTP/2 client connections.
+// The I/O of the connection runs in a thread of its own, so that the requests
+// could be sent from any threads at the same time, each on a stream of the
+// connection. The sending thread waits for the response.
+class Http2ClientBase : public Http2Session,
+                        public std::enable_shared_from_this<Http2ClientBase> {
+public:
+  explicit Http2ClientBase(std::string_view default_port);
+
+  ~Http2ClientBase() override;
+
+  void set_connect_timeout(int timeout) {
+    if (timeout > 0) {
+      connect_timeout_ = timeout;
+    }
+  }
+
+  void set_read_timeout(int timeout) {
+    if (timeout > 0) {
+      read_timeout_ = timeout;
+    }
+  }
+
+  void set_subsequent_read_timeout(int timeout) {
+    if (timeout > 0) {
+      subsequent_read_timeout_ = timeout;
+    }
+  }
+
+  // Is the connection closed, or going away? If so, a new connection should
+  // be used for new requests.
+  bool closed() const;
+
+  // Has the server refused to use HTTP/2 (over TLS, "h2" is not selected by
+  // ALPN)? If so, HTTP/1.1 should be used instead.
+  bool unsupported() const;
+
+  // Start to connect to the server in the thread of the connection.
+  // The requests sent before the connection is established are queued.
+  void Connect(const std::string& host, const std::string& port);
+
+  // Send a request on a new stream and wait for the response.
+  // Return null if the request has not been sent because the server doesn't
+  // support HTTP/2 or the connection is going away, the request could then be
+  // sent in another way. Throw Error on failure.
+  // The progress callback, if any, is called from the thread of the connection
+  // as the response is read.
+  ResponsePtr Send(RequestPtr request, bool stream = false,
+                   ProgressCallback callback = {});
+
+  // Close the connection, fail the requests in progress, and wait for the
+  // thread of the connection to end. Don't call it from the connection's
+  // thread (e.g., in a progress callback).
+  void Close();
+
+protected:
+  virtual SocketType& GetSocket() = 0;
+
+  virtual void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                          AsyncRWHandler&& handler) = 0;
+
+  virtual void AsyncReadSome(boost::asio::mutable_buffer buffer,
+                             AsyncRWHandler&& handler) = 0;
+
+  // Called once the socket is connected.
+  // Call StartSession() when the connection is ready for HTTP/2.
+  virtual void OnConnected() {
+    StartSession();
+  }
+
+  void StartSession();
+
+  // Give up with an error. The calls are failed and the socket is closed.
+  void Abort(const Error& error);
+
+  // Give up because the server doesn't support HTTP/2. The calls are ended
+  // to be sent in another way.
+  void AbortUnsupported();
+
+  boost::asio::io_context io_context_;
+
+  // Keep the loop running until Close().
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      work_guard_;
+
+  std::string host_;
+
+private:
+  // A request and its response, sent on a stream.
+  struct Call;
+  using CallPtr = std::shared_ptr<Call>;
+
+  enum class State {
+    kConnecting,
+    kConnected,
+    kUnsupported,
+    kClosed,
+  };
+
+  void OnHeaders(std::uint32_t stream_id, std::vector<Header>&& headers,
+                 bool end_stream) override;
+
+  void OnData(std::uint32_t stream_id, const char* data, std::size_t length,
+              bool end_stream) override;
+
+  void OnStreamClosed(std::uint32_t stream_id,
+                      std::uint32_t error_code) override;
+
+  void OnResolve(boost::system::error_code ec,
+                 boost::asio::ip::tcp::resolver::results_type endpoints);
+
+  void OnConnect(boost::system::error_code ec);
+
+  void OnConnectTimer(boost::system::error_code ec);
+
+  // Open streams for the queued calls, as far as the server allows.
+  void StartCalls();
+
+  // The response of the call has been read.
+  void FinishCall(const CallPtr& call);
+
+  // Fail the call and reset its stream.
+  void FailCall(const CallPtr& call, const Error& error);
+
+  // Tell the waiting thread that the call has ended, with the error if any.
+  // If `retry` is true, the request has not been sent.
+  void EndCall(const CallPtr& call, const Error& error, bool retry = false);
+
+  // End all the calls with the error.
+  void EndCalls(const Error& error);
+
+  // Drop the call which has ended (e.g., timeout) from the connection.
+  void DropCall(const CallPtr& call);
+
+  void CloseSocket();
+
+  void AsyncRead();
+  void OnRead(boost::system::error_code ec, std::size_t length);
+
+  // Write the output of the session, unless a write is in progress.
+  void Flush();
+  void OnWrite(boost::system::error_code ec, std::size_t length);
+
+  void SetState(State state);
+
+  // The default port used to resolve when the URL doesn't have one.
+  const std::string default_port_;
+
+  std::string port_;
+
+  boost::asio::ip::tcp::resolver resolver_;
+
+  boost::asio::steady_timer connect_timer_;
+
+  // Timeouts (seconds) as ClientBase.
+  int connect_timeout_ = 0;
+  int read_timeout_ = 30;
+  int subsequent_read_timeout_ = 10;
+
+  // The thread running the loop (io_context) of the connection.
+  std::thread thread_;
+
+  // The calls waiting for a stream, and the calls by stream ID.
+  // Accessed in the thread of the connection only.
+  std::deque<CallPtr> pending_calls_;
+  std::unordered_map<std::uint32_t, CallPtr> calls_;
+
+  // The buffer for reading.
+  std::vector<char> buffer_;
+
+  // The output being written.
+  std::string writing_;
+  bool is_writing_ = false;
+
+  // Close the connection once the output has been written.
+  bool closing_ = false;
+
+  // Guard the state and the ends of the calls, shared with the sending
+  // threads waiting on the condition.
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  State state_ = State::kConnecting;
+
+  // The server has sent a GOAWAY, no more streams could be opened.
+  bool draining_ = false;
+
+  // Close() has been called.
+  bool stopped_ = false;
+};
+
+using Http2ClientPtr = std::shared_ptr<Http2ClientBase>;
+
+// -----------------------------------------------------------------------------
+
+// HTTP/2 over plain TCP with prior knowledge (h2c).
+class Http2Client final : public Http2ClientBase {
+public:
+  Http2Client() : Http2ClientBase("80"), socket_(io_context_) {
+  }
+
+  ~Http2Client() override = default;
+
+protected:
+  SocketType& GetSocket() override {
+    return socket_;
+  }
+
+  void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                  AsyncRWHandler&& handler) override;
+
+  void AsyncReadSome(boost::asio::mutable_buffer buffer,
+                     AsyncRWHandler&& handler) override;
+
+private:
+  boost::asio::ip::tcp::socket socket_;
+};
+
+// -----------------------------------------------------------------------------
+
+// HTTP/2 over TLS (h2), negotiated by ALPN during the handshake.
+class SslHttp2Client final : public Http2ClientBase {
+public:
+  SslHttp2Client(boost::asio::ssl::context& ssl_context, SslVerify ssl_verify);
+
+  ~SslHttp2Client() override = default;
+
+protected:
+  SocketType& GetSocket() override {
+    return ssl_stream_.lowest_layer();
+  }
+
+  void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                  AsyncRWHandler&& handler) override;
+
+  void AsyncReadSome(boost::asio::mutable_buffer buffer,
+                     AsyncRWHandler&& handler) override;
+
+  void OnConnected() override;
+
+private:
+  void OnHandshake(boost::system::error_code ec);
+
+  boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssl_stream_;
+
+  // SSL verification mode.
+  SslVerify ssl_verify_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_HTTP2_CLIENT_H_
@@ -0,0 +1,410 @@
+#include "webcc/http2_connection.h"
+
+#include <cassert>
+
+#include "boost/asio/dispatch.hpp"
+#include "boost/asio/post.hpp"
+
+#include "webcc/connection_pool.h"
+#include "webcc/internal/globals.h"
+#include "webcc/logger.h"
+
+namespace webcc {
+
+Http2Stream::Http2Stream(ConnectionPtr connection,
+                         std::weak_ptr<Http2Connection> http2_connection,
+                         std::uint32_t id, RequestHandler request_handler,
+                         ViewMatcher view_matcher)
+    : ConnectionBase(GetIoContext(connection->GetSocket()), nullptr,
+                     std::move(request_handler), std::move(view_matcher), 0),
+      connection_(std::move(connection)),
+      http2_connection_(std::move(http2_connection)),
+      id_(id) {
+}
+
+void Http2Stream::SendResponse(ResponsePtr response, bool /*no_keep_alive*/) {
+  assert(response != nullptr);
+
+  if (request_->IsCanceled()) {
+    LOG_INFO("The stream has been reset, drop the response");
+    return;
+  }
+
+  response->SetDate();
+
+  response->Prepare();
+
+  responded_ = true;
+
+  if (auto http2_connection = http2_connection_.lock()) {
+    http2_connection->PostResponse(id_, response);
+  }
+}
+
+void Http2Stream::PostClose() {
+  if (auto http2_connection = http2_connection_.lock()) {
+    http2_connection->PostReset(id_);
+  }
+}
+
+bool Http2Stream::OnHeaders(std::vector<Header>&& headers, bool end_stream) {
+  PrepareRequest();
+
+  std::string method;
+  std::string path;
+  std::string authority;
+  std::string cookie;
+
+  // The pseudo-header fields make the start line.
+  std::vector<Header> fields;
+  fields.reserve(headers.size() + 2);
+
+  for (Header& header : headers) {
+    if (header.first.empty()) {
+      return false;
+    }
+
+    if (header.first[0] == ':') {
+      if (header.first == ":method") {
+        method = std::move(header.second);
+      } else if (header.first == ":path") {
+        path = std::move(header.second);
+      } else if (header.first == ":authority") {
+        authority = std::move(header.second);
+      }  // else: :scheme is ignored.
+    } else if (header.first == "cookie") {
+      // The cookie might be split into several fields (RFC 9113 8.2.3).
+      if (!cookie.empty()) {
+        cookie += "; ";
+      }
+      cookie += header.second;
+    } else if (!http2::IsConnectionSpecific(header.first)) {
+      fields.push_back(std::move(header));
+    }
+  }
+
+  if (method.empty() || path.empty()) {
+    LOG_ERRO("Missing pseudo-header fields");
+    return false;
+  }
+
+  if (!authority.empty()) {
+    fields.push_back({ headers::kHost, std::move(authority) });
+  }
+  if (!cookie.empty()) {
+    fields.push_back({ "Cookie", std::move(cookie) });
+  }
+
+  if (!request_parser_.SetHeaders(method + " " + path + " HTTP/2",
+                                  std::move(fields), !end_stream)) {
+    return false;
+  }
+
+  return end_stream ? EndRequest() : true;
+}
+
+bool Http2Stream::OnData(const char* data, std::size_t length,
+                         bool end_stream) {
+  if (length > 0) {
+    if (!request_parser_.Parse(data, length)) {
+      return false;
+    }
+    if (request_parser_.consumed() < length) {
+      LOG_ERRO("More data than the Content-Length");
+      return false;
+    }
+  }
+
+  return end_stream ? EndRequest() : true;
+}
+
+void Http2Stream::AsyncWrite(
+    const std::vector<boost::asio::const_buffer>& /*buffers*/,
+    AsyncRWHandler&& handler) {
+  PostNotSupported(std::move(handler));
+}
+
+void Http2Stream::AsyncReadSome(boost::asio::mutable_buffer /*buffer*/,
+                                AsyncRWHandler&& handler) {
+  PostNotSupported(std::move(handler));
+}
+
+bool Http2Stream::EndRequest() {
+  if (!request_parser_.EndContent()) {
+    return false;
+  }
+
+  LOG_VERB("Request:\n%s",
+           request_->Dump(internal::log_prefix::kIncoming).c_str());
+
+  dispatched_ = true;
+  request_handler_(shared_from_this());
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+Http2Connection::Http2Connection(ConnectionBase* connection)
+    : Http2Session(true),
+      connection_(connection),
+      strand_(boost::asio::make_strand(
+          connection->GetSocket().get_executor())) {
+}
+
+void Http2Connection::Start(const std::string& data) {
+  LOG_INFO("Start HTTP/2");
+
+  // A frame is up to 16KB (plus the header), read more each time.
+  std::vector<char>& buffer = connection_->buffer_;
+  if (buffer.size() < http2::kDefaultMaxFrameSize) {
+    buffer.resize(http2::kDefaultMaxFrameSize);
+  }
+
+  Http2Session::Start();
+
+  if (!data.empty() && !Feed(data.data(), data.size())) {
+    closing_ = true;
+    Flush();
+    return;
+  }
+
+  Flush();
+  AsyncRead();
+}
+
+void Http2Connection::Close() {
+  closed_ = true;
+
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self]() { self->Abort(); });
+}
+
+void Http2Connection::PostResponse(std::uint32_t stream_id,
+                                   ResponsePtr response) {
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self, stream_id, response]() {
+    self->SendResponse(stream_id, response);
+  });
+}
+
+void Http2Connection::PostReset(std::uint32_t stream_id) {
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self, stream_id]() {
+    if (self->streams_.count(stream_id) != 0) {
+      self->ResetStream(stream_id, http2::error_codes::kCancel);
+      self->Flush();
+    }
+  });
+}
+
+void Http2Connection::OnHeaders(std::uint32_t stream_id,
+                                std::vector<Header>&& headers,
+                                bool end_stream) {
+  auto it = streams_.find(stream_id);
+
+  if (it == streams_.end()) {
+    auto stream = std::make_shared<Http2Stream>(
+        connection_->shared_from_this(), weak_from_this(), stream_id,
+        RequestHandler{ connection_->request_handler_ },
+        ViewMatcher{ connection_->view_matcher_ });
+    stream->set_max_body_size(connection_->max_body_size());
+
+    streams_[stream_id] = stream;
+
+    if (!stream->OnHeaders(std::move(headers), end_stream)) {
+      SendBadRequest(stream_id);
+    }
+    return;
+  }
+
+  // The trailer, which must end the stream.
+  if (!end_stream || !it->second->OnData(nullptr, 0, true)) {
+    SendBadRequest(stream_id);
+  }
+}
+
+void Http2Connection::OnData(std::uint32_t stream_id, const char* data,
+                             std::size_t length, bool end_stream) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    return;  // The request has failed.
+  }
+
+  if (!it->second->OnData(data, length, end_stream)) {
+    SendBadRequest(stream_id);
+  }
+}
+
+void Http2Connection::OnStreamClosed(std::uint32_t stream_id,
+                                     std::uint32_t error_code) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    return;
+  }
+
+  if (error_code != http2::error_codes::kNoError) {
+    LOG_INFO("Stream %u has been reset, cancel the request", stream_id);
+    it->second->Cancel();
+  }
+
+  streams_.erase(it);
+}
+
+bool Http2Connection::WaitData(std::uint32_t stream_id, Body* body) {
+  // The connection is kept alive by the pool, not by the body.
+  std::weak_ptr<Http2Connection> weak = shared_from_this();
+
+  return body->WaitPayload(strand_, [weak, stream_id]() {
+    if (auto self = weak.lock()) {
+      boost::asio::post(self->strand_, [self, stream_id]() {
+        if (!self->closed_) {
+          self->ResumeData(stream_id);
+          self->Flush();
+        }
+      });
+    }
+  });
+}
+
+void Http2Connection::SendResponse(std::uint32_t stream_id,
+                                   ResponsePtr response) {
+  if (closed_) {
+    return;
+  }
+
+  LOG_VERB("Response:\n%s",
+           response->Dump(internal::log_prefix::kOutgoing).c_str());
+
+  std::string block;
+  encoder().Encode(":status", std::to_string(response->status()), &block);
+
+  for (const HeaderView& header : response->headers().data()) {
+    if (!http2::IsConnectionSpecific(header.first)) {
+      encoder().Encode(header.first, header.second, &block);
+    }
+  }
+
+  Submit(stream_id, block, response->body());
+
+  Flush();
+}
+
+void Http2Connection::SendBadRequest(std::uint32_t stream_id) {
+  LOG_ERRO("Failed to parse request of stream %u", stream_id);
+
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    return;
+  }
+
+  // The rest of the request, if any, is ignored.
+  Http2StreamPtr stream = it->second;
+  streams_.erase(it);
+
+  stream->SendResponse(stream->request_parser_.body_too_large()
+                           ? status_codes::kPayloadTooLarge
+                           : status_codes::kBadRequest);
+}
+
+void Http2Connection::AsyncRead() {
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  connection_->AsyncReadSome(
+      boost::asio::buffer(connection_->buffer_),
+      [self, connection](boost::system::error_code ec, std::size_t length) {
+        boost::asio::dispatch(self->strand_, [self, ec, length]() {
+          self->OnRead(ec, length);
+        });
+      });
+}
+
+void Http2Connection::OnRead(boost::system::error_code ec,
+                             std::size_t length) {
+  if (ec) {
+    if (ec == boost::asio::error::eof) {
+      LOG_INFO("Socket read EOF (%s)", ec.message().c_str());
+    } else if (ec != boost::asio::error::operation_aborted) {
+      LOG_ERRO("Socket read error (%s)", ec.message().c_str());
+    }
+
+    Abort();
+
+    if (ec != boost::asio::error::operation_aborted && !closed_) {
+      connection_->pool_->Close(connection_->shared_from_this());
+    }
+    return;
+  }
+
+  if (!Feed(connection_->buffer_.data(), length)) {
+    // Close after the GOAWAY has been written.
+    closing_ = true;
+    Abort();
+    Flush();
+    return;
+  }
+
+  Flush();
+  AsyncRead();
+}
+
+void Http2Connection::Flush() {
+  if (is_writing_ || closed_) {
+    return;
+  }
+
+  if (!HasOutput()) {
+    if (closing_) {
+      closed_ = true;
+      connection_->pool_->Close(connection_->shared_from_this());
+    }
+    return;
+  }
+
+  TakeOutput(&writing_);
+  is_writing_ = true;
+
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  connection_->AsyncWrite(
+      { boost::asio::buffer(writing_) },
+      [self, connection](boost::system::error_code ec, std::size_t length) {
+        boost::asio::dispatch(self->strand_, [self, ec, length]() {
+          self->OnWrite(ec, length);
+        });
+      });
+}
+
+void Http2Connection::OnWrite(boost::system::error_code ec,
+                              std::size_t /*length*/) {
+  is_writing_ = false;
+
+  if (ec) {
+    LOG_ERRO("Socket write error (%s)", ec.message().c_str());
+
+    Abort();
+
+    if (ec != boost::asio::error::operation_aborted && !closed_) {
+      closed_ = true;
+      connection_->pool_->Close(connection_->shared_from_this());
+    }
+    return;
+  }
+
+  // Go on with the bodies being sent.
+  WriteData();
+
+  Flush();
+}
+
+void Http2Connection::Abort() {
+  for (auto& pair : streams_) {
+    pair.second->Cancel();
+  }
+  streams_.clear();
+
+  DetachBodies();
+}
+
+}  // namespace webcc
@@ -0,0 +1,172 @@
+#ifndef WEBCC_HTTP2_CONNECTION_H_
+#define WEBCC_HTTP2_CONNECTION_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "boost/asio/strand.hpp"
+
+#include "webcc/connection_base.h"
+#include "webcc/http2_session.h"
+
+namespace webcc {
+
+class Http2Connection;
+
+// A stream of an HTTP/2 connection, which the server handles as a connection
+// with a single request. So the views, the workers and the executors work
+// with it the same way. The response is sent by the HTTP/2 connection.
+class Http2Stream : public ConnectionBase {
+public:
+  Http2Stream(ConnectionPtr connection,
+              std::weak_ptr<Http2Connection> http2_connection,
+              std::uint32_t id, RequestHandler request_handler,
+              ViewMatcher view_matcher);
+
+  ~Http2Stream() override = default;
+
+  std::uint32_t id() const {
+    return id_;
+  }
+
+  // The socket of the connection.
+  SocketType& GetSocket() override {
+    return connection_->GetSocket();
+  }
+
+  // The stream starts with the headers (see OnHeaders()).
+  void Start() override {
+  }
+
+  // Nothing to close, the stream is reset instead (see PostClose()).
+  void Close() override {
+  }
+
+  using ConnectionBase::SendResponse;
+
+  // Override to send the response through the HTTP/2 connection. The
+  // connection is always kept alive, so `no_keep_alive` is ignored.
+  void SendResponse(ResponsePtr response, bool no_keep_alive) override;
+
+  // Override to reset the stream instead of closing the connection.
+  void PostClose() override;
+
+  // Override to do nothing, the request is canceled once the stream is reset
+  // by the client (see Cancel()).
+  void WatchPeer() override {
+  }
+
+  // Start the request with the decoded headers.
+  // Return false if the request is malformed.
+  bool OnHeaders(std::vector<Header>&& headers, bool end_stream);
+
+  // Continue the request with the data, or end it.
+  // Return false if the request is malformed.
+  bool OnData(const char* data, std::size_t length, bool end_stream);
+
+  // Cancel the request, e.g., the stream has been reset by the client.
+  void Cancel() {
+    *peer_closed_ = true;
+  }
+
+protected:
+  // The I/O is done by the HTTP/2 connection, these only fail the handler.
+  void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                  AsyncRWHandler&& handler) override;
+
+  void AsyncReadSome(boost::asio::mutable_buffer buffer,
+                     AsyncRWHandler&& handler) override;
+
+private:
+  // Let the handler (the server) handle the request which has been read.
+  bool EndRequest();
+
+  // The connection of the stream.
+  ConnectionPtr connection_;
+
+  std::weak_ptr<Http2Connection> http2_connection_;
+
+  std::uint32_t id_;
+};
+
+using Http2StreamPtr = std::shared_ptr<Http2Stream>;
+
+// -----------------------------------------------------------------------------
+
+// The HTTP/2 layer of a server connection, after the connection has switched
+// to HTTP/2. It takes over the reading and the writing of the connection.
+// All the operations are serialized by a strand.
+class Http2Connection : public Http2Session,
+                        public std::enable_shared_from_this<Http2Connection> {
+public:
+  // The connection holds this object, see ConnectionBase::StartHttp2().
+  explicit Http2Connection(ConnectionBase* connection);
+
+  ~Http2Connection() override = default;
+
+  // Start with the data read so far, including the connection preface if it
+  // has been read.
+  void Start(const std::string& data);
+
+  // Stop writing to the connection, which has been closed.
+  // Called from the loop of the connection.
+  void Close();
+
+  // Send the response of a stream from any thread.
+  void PostResponse(std::uint32_t stream_id, ResponsePtr response);
+
+  // Reset a stream from any thread.
+  void PostReset(std::uint32_t stream_id);
+
+private:
+  void OnHeaders(std::uint32_t stream_id, std::vector<Header>&& headers,
+                 bool end_stream) override;
+
+  void OnData(std::uint32_t stream_id, const char* data, std::size_t length,
+              bool end_stream) override;
+
+  void OnStreamClosed(std::uint32_t stream_id,
+                      std::uint32_t error_code) override;
+
+  bool WaitData(std::uint32_t stream_id, Body* body) override;
+
+  void SendResponse(std::uint32_t stream_id, ResponsePtr response);
+
+  // Answer a malformed request with Bad Request (400), or Payload Too Large
+  // (413) if the body is larger than allowed.
+  void SendBadRequest(std::uint32_t stream_id);
+
+  void AsyncRead();
+  void OnRead(boost::system::error_code ec, std::size_t length);
+
+  // Write the output of the session, unless a write is in progress.
+  void Flush();
+  void OnWrite(boost::system::error_code ec, std::size_t length);
+
+  // Cancel all the streams, the connection is broken or closed.
+  void Abort();
+
+  ConnectionBase* connection_;
+
+  boost::asio::strand<boost::asio::any_io_executor> strand_;
+
+  // The streams of the requests being read or handled.
+  std::unordered_map<std::uint32_t, Http2StreamPtr> streams_;
+
+  // The output being written.
+  std::string writing_;
+  bool is_writing_ = false;
+
+  // Close the connection once the output has been written.
+  bool closing_ = false;
+
+  // Set once the connection has been closed, maybe from another thread.
+  std::atomic_bool closed_{ false };
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_HTTP2_CONNECTION_H_
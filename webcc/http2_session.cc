@@ -0,0 +1,804 @@
+#include "webcc/http2_session.h"
+
+#include <algorithm>
+
+#include "boost/algorithm/string.hpp"
+
+#include "webcc/logger.h"
+
+namespace webcc {
+
+namespace {
+
+// The limit of the output produced by WriteData() each time, so that a large
+// body is not read into memory at once.
+constexpr std::size_t kMaxOutputSize = 256 * 1024;
+
+std::uint32_t ReadUint32(const char* data) {
+  auto p = reinterpret_cast<const unsigned char*>(data);
+  return (static_cast<std::uint32_t>(p[0]) << 24) |
+         (static_cast<std::uint32_t>(p[1]) << 16) |
+         (static_cast<std::uint32_t>(p[2]) << 8) |
+         static_cast<std::uint32_t>(p[3]);
+}
+
+void AppendUint32(std::uint32_t value, std::string* output) {
+  output->push_back(static_cast<char>((value >> 24) & 0xff));
+  output->push_back(static_cast<char>((value >> 16) & 0xff));
+  output->push_back(static_cast<char>((value >> 8) & 0xff));
+  output->push_back(static_cast<char>(value & 0xff));
+}
+
+}  // namespace
+
+namespace frame_types = http2::frame_types;
+
+// -----------------------------------------------------------------------------
+
+bool http2::IsConnectionSpecific(std::string_view name) {
+  static const char* const kNames[] = {
+    "Connection", "Keep-Alive", "Proxy-Connection", "Transfer-Encoding",
+    "Upgrade",
+  };
+  for (const char* n : kNames) {
+    if (boost::iequals(name, n)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+
+void Http2Session::Start() {
+  if (!server_) {
+    output_.append(http2::kClientPreface, http2::kClientPrefaceLength);
+  }
+
+  AppendFrameHeader(12, frame_types::kSettings, 0, 0);
+  if (server_) {
+    AppendSetting(http2::settings::kMaxConcurrentStreams,
+                  http2::kMaxConcurrentStreams);
+  } else {
+    AppendSetting(http2::settings::kEnablePush, 0);
+  }
+  AppendSetting(http2::settings::kInitialWindowSize,
+                static_cast<std::uint32_t>(http2::kStreamWindowSize));
+
+  AppendWindowUpdate(0, static_cast<std::uint32_t>(
+                            http2::kConnectionWindowSize -
+                            http2::kDefaultWindowSize));
+}
+
+bool Http2Session::Feed(const char* data, std::size_t length) {
+  // Process the data in place unless some is left from last time.
+  const char* begin = data;
+  const char* end = data + length;
+  if (!input_.empty()) {
+    input_.append(data, length);
+    begin = input_.data();
+    end = begin + input_.size();
+  }
+
+  const char* p = begin;
+
+  if (server_ && !preface_received_) {
+    std::size_t size = std::min(static_cast<std::size_t>(end - p),
+                                http2::kClientPrefaceLength);
+    if (std::string_view{ p, size } !=
+        std::string_view{ http2::kClientPreface, size }) {
+      return ConnectionError(http2::error_codes::kProtocolError,
+                             "Invalid preface");
+    }
+    if (size == http2::kClientPrefaceLength) {
+      preface_received_ = true;
+      p += size;
+    }
+  }
+
+  while (preface_received_ || !server_) {
+    if (static_cast<std::size_t>(end - p) < http2::kFrameHeaderLength) {
+      break;
+    }
+
+    auto h = reinterpret_cast<const unsigned char*>(p);
+    std::size_t frame_length = (static_cast<std::size_t>(h[0]) << 16) |
+                               (static_cast<std::size_t>(h[1]) << 8) | h[2];
+    if (frame_length > http2::kDefaultMaxFrameSize) {
+      input_.clear();
+      return ConnectionError(http2::error_codes::kFrameSizeError,
+                             "Frame too large");
+    }
+
+    if (static_cast<std::size_t>(end - p) <
+        http2::kFrameHeaderLength + frame_length) {
+      break;
+    }
+
+    std::uint32_t stream_id = ReadUint32(p + 5) & 0x7fffffff;
+    if (!HandleFrame(h[3], h[4], stream_id, p + http2::kFrameHeaderLength,
+                     frame_length)) {
+      input_.clear();
+      return false;
+    }
+
+    p += http2::kFrameHeaderLength + frame_length;
+  }
+
+  // Keep the incomplete frame, if any.
+  if (input_.empty()) {
+    input_.assign(p, end);
+  } else {
+    input_.erase(0, p - begin);
+  }
+
+  return true;
+}
+
+void Http2Session::WriteData() {
+  bool progress = true;
+
+  // Round-robin the streams a frame each time.
+  while (progress && send_window_ > 0 && output_.size() < kMaxOutputSize) {
+    progress = false;
+
+    for (auto it = streams_.begin();
+         it != streams_.end() && send_window_ > 0;) {
+      auto curr = it++;
+      Stream& stream = curr->second;
+      if (stream.body && !stream.waiting && stream.send_window > 0) {
+        WriteDataFrame(curr->first, &stream);
+        progress = true;
+        if (stream.local_closed) {
+          CloseIfDone(curr);
+        }
+      }
+    }
+  }
+}
+
+std::uint32_t Http2Session::OpenStream() {
+  std::uint32_t stream_id = next_stream_id_;
+  next_stream_id_ += 2;
+
+  Stream& stream = streams_[stream_id];
+  stream.send_window = peer_initial_window_;
+  stream.recv_window = http2::kStreamWindowSize;
+
+  return stream_id;
+}
+
+void Http2Session::Submit(std::uint32_t stream_id, const std::string& block,
+                          BodyPtr body) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    LOG_INFO("Stream %u has been closed, drop the message", stream_id);
+    return;
+  }
+
+  bool end_stream = !body || body->IsEmpty();
+
+  // Split the header block into HEADERS and CONTINUATION frames.
+  std::size_t pos = 0;
+  std::uint8_t type = frame_types::kHeaders;
+  do {
+    std::size_t size = std::min(block.size() - pos, peer_max_frame_size_);
+
+    std::uint8_t frame_flags = 0;
+    if (type == frame_types::kHeaders && end_stream) {
+      frame_flags |= http2::flags::kEndStream;
+    }
+    if (pos + size == block.size()) {
+      frame_flags |= http2::flags::kEndHeaders;
+    }
+
+    AppendFrameHeader(size, type, frame_flags, stream_id);
+    output_.append(block, pos, size);
+
+    pos += size;
+    type = frame_types::kContinuation;
+  } while (pos < block.size());
+
+  Stream& stream = it->second;
+
+  if (end_stream) {
+    stream.local_closed = true;
+    CloseIfDone(it);
+    return;
+  }
+
+  stream.body = body;
+  body->InitPayload();
+  stream.payload = body->NextPayload();
+  stream.index = 0;
+  stream.offset = 0;
+
+  WriteData();
+}
+
+void Http2Session::ResumeData(std::uint32_t stream_id) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) {
+    return;  // Reset meanwhile
+  }
+
+  it->second.waiting = false;
+  WriteData();
+}
+
+void Http2Session::ResetStream(std::uint32_t stream_id,
+                               std::uint32_t error_code) {
+  AppendFrameHeader(4, frame_types::kRstStream, 0, stream_id);
+  AppendUint32(error_code, &output_);
+
+  auto it = streams_.find(stream_id);
+  if (it != streams_.end()) {
+    CloseStream(it, error_code);
+  }
+}
+
+bool Http2Session::HandleFrame(std::uint8_t type, std::uint8_t flags,
+                               std::uint32_t stream_id, const char* payload,
+                               std::size_t length) {
+  // A header block must be continuous.
+  if (header_stream_id_ != 0 && type != frame_types::kContinuation) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "CONTINUATION expected");
+  }
+
+  switch (type) {
+    case frame_types::kData:
+      return HandleData(flags, stream_id, payload, length);
+
+    case frame_types::kHeaders:
+      return HandleHeaders(flags, stream_id, payload, length);
+
+    case frame_types::kPriority:
+      // Priority is not supported (deprecated by RFC 9113).
+      if (stream_id == 0) {
+        return ConnectionError(http2::error_codes::kProtocolError,
+                               "PRIORITY on stream 0");
+      }
+      return true;
+
+    case frame_types::kRstStream: {
+      if (stream_id == 0) {
+        return ConnectionError(http2::error_codes::kProtocolError,
+                               "RST_STREAM on stream 0");
+      }
+      if (length != 4) {
+        return ConnectionError(http2::error_codes::kFrameSizeError,
+                               "Invalid RST_STREAM");
+      }
+      auto it = streams_.find(stream_id);
+      if (it != streams_.end()) {
+        std::uint32_t error_code = ReadUint32(payload);
+        LOG_INFO("Stream %u reset by peer (error code: %u)", stream_id,
+                 error_code);
+        // The stream is ended abruptly anyway.
+        if (error_code == http2::error_codes::kNoError) {
+          error_code = http2::error_codes::kCancel;
+        }
+        CloseStream(it, error_code);
+      }
+      return true;
+    }
+
+    case frame_types::kSettings:
+      return HandleSettings(flags, stream_id, payload, length);
+
+    case frame_types::kPushPromise:
+      // Push is disabled by the client, and never sent by a client.
+      return ConnectionError(http2::error_codes::kProtocolError,
+                             "Unexpected PUSH_PROMISE");
+
+    case frame_types::kPing:
+      if (stream_id != 0) {
+        return ConnectionError(http2::error_codes::kProtocolError,
+                               "PING on a stream");
+      }
+      if (length != 8) {
+        return ConnectionError(http2::error_codes::kFrameSizeError,
+                               "Invalid PING");
+      }
+      if ((flags & http2::flags::kAck) == 0) {
+        AppendFrameHeader(8, frame_types::kPing, http2::flags::kAck, 0);
+        output_.append(payload, 8);
+      }
+      return true;
+
+    case frame_types::kGoAway:
+      if (stream_id != 0) {
+        return ConnectionError(http2::error_codes::kProtocolError,
+                               "GOAWAY on a stream");
+      }
+      if (length < 8) {
+        return ConnectionError(http2::error_codes::kFrameSizeError,
+                               "Invalid GOAWAY");
+      }
+      LOG_INFO("GOAWAY received (error code: %u)", ReadUint32(payload + 4));
+      going_away_ = true;
+      if (!server_) {
+        // The streams after the last one processed by the server can be
+        // retried on another connection.
+        std::uint32_t last_stream_id = ReadUint32(payload) & 0x7fffffff;
+        auto it = streams_.upper_bound(last_stream_id);
+        while (it != streams_.end()) {
+          CloseStream(it++, http2::error_codes::kRefusedStream);
+        }
+      }
+      return true;
+
+    case frame_types::kWindowUpdate:
+      return HandleWindowUpdate(stream_id, payload, length);
+
+    case frame_types::kContinuation:
+      return HandleContinuation(flags, stream_id, payload, length);
+
+    default:
+      // Unknown frames must be ignored.
+      return true;
+  }
+}
+
+bool Http2Session::HandleData(std::uint8_t flags, std::uint32_t stream_id,
+                              const char* payload, std::size_t length) {
+  if (stream_id == 0) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "DATA on stream 0");
+  }
+
+  // The flow control covers the entire frame, including the padding.
+  const std::int64_t frame_length = static_cast<std::int64_t>(length);
+
+  recv_window_ -= frame_length;
+  if (recv_window_ < 0) {
+    return ConnectionError(http2::error_codes::kFlowControlError,
+                           "Connection window exceeded");
+  }
+  if (recv_window_ < http2::kConnectionWindowSize / 2) {
+    AppendWindowUpdate(0, static_cast<std::uint32_t>(
+                              http2::kConnectionWindowSize - recv_window_));
+    recv_window_ = http2::kConnectionWindowSize;
+  }
+
+  if (!RemovePadding(flags, &payload, &length)) {
+    return false;
+  }
+
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end() || it->second.remote_closed) {
+    ResetStream(stream_id, http2::error_codes::kStreamClosed);
+    return true;
+  }
+
+  Stream& stream = it->second;
+
+  stream.recv_window -= frame_length;
+  if (stream.recv_window < 0) {
+    ResetStream(stream_id, http2::error_codes::kFlowControlError);
+    return true;
+  }
+
+  const bool end_stream = (flags & http2::flags::kEndStream) != 0;
+  if (end_stream) {
+    stream.remote_closed = true;
+  } else if (stream.recv_window < http2::kStreamWindowSize / 2) {
+    AppendWindowUpdate(stream_id, static_cast<std::uint32_t>(
+                                      http2::kStreamWindowSize -
+                                      stream.recv_window));
+    stream.recv_window = http2::kStreamWindowSize;
+  }
+
+  // NOTE: The stream might be reset during the call.
+  OnData(stream_id, payload, length, end_stream);
+
+  if (end_stream) {
+    it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+      CloseIfDone(it);
+    }
+  }
+
+  return true;
+}
+
+bool Http2Session::HandleHeaders(std::uint8_t flags, std::uint32_t stream_id,
+                                 const char* payload, std::size_t length) {
+  if (stream_id == 0) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "HEADERS on stream 0");
+  }
+
+  if (!RemovePadding(flags, &payload, &length)) {
+    return false;
+  }
+
+  if ((flags & http2::flags::kPriority) != 0) {
+    // Skip the stream dependency and the weight.
+    if (length < 5) {
+      return ConnectionError(http2::error_codes::kFrameSizeError,
+                             "Invalid HEADERS");
+    }
+    payload += 5;
+    length -= 5;
+  }
+
+  const bool end_stream = (flags & http2::flags::kEndStream) != 0;
+
+  if ((flags & http2::flags::kEndHeaders) != 0) {
+    return HandleHeaderBlock(stream_id, payload, length, end_stream);
+  }
+
+  // Wait for the CONTINUATION frames.
+  header_block_.assign(payload, length);
+  header_stream_id_ = stream_id;
+  header_end_stream_ = end_stream;
+  return true;
+}
+
+bool Http2Session::HandleContinuation(std::uint8_t flags,
+                                      std::uint32_t stream_id,
+                                      const char* payload,
+                                      std::size_t length) {
+  if (header_stream_id_ == 0 || stream_id != header_stream_id_) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "Unexpected CONTINUATION");
+  }
+
+  if (header_block_.size() + length > http2::kMaxHeaderBlockSize) {
+    return ConnectionError(http2::error_codes::kEnhanceYourCalm,
+                           "Header block too large");
+  }
+
+  header_block_.append(payload, length);
+
+  if ((flags & http2::flags::kEndHeaders) == 0) {
+    return true;
+  }
+
+  header_stream_id_ = 0;
+  std::string block = std::move(header_block_);
+  header_block_.clear();
+  return HandleHeaderBlock(stream_id, block.data(), block.size(),
+                           header_end_stream_);
+}
+
+bool Http2Session::HandleHeaderBlock(std::uint32_t stream_id,
+                                     const char* block, std::size_t length,
+                                     bool end_stream) {
+  // The block must be decoded even if the stream is refused, to keep the
+  // dynamic table in sync.
+  std::vector<Header> headers;
+  if (!decoder_.Decode(block, length, &headers)) {
+    return ConnectionError(http2::error_codes::kCompressionError,
+                           "Header block decoding error");
+  }
+
+  auto it = streams_.find(stream_id);
+
+  if (it == streams_.end()) {
+    if (!server_) {
+      // The stream has been reset by this side.
+      return true;
+    }
+
+    if (stream_id % 2 == 0 || stream_id <= last_peer_stream_id_) {
+      return ConnectionError(http2::error_codes::kProtocolError,
+                             "Invalid stream ID");
+    }
+    last_peer_stream_id_ = stream_id;
+
+    if (going_away_) {
+      return true;
+    }
+
+    if (streams_.size() >= http2::kMaxConcurrentStreams) {
+      LOG_WARN("Too many concurrent streams, refuse stream %u", stream_id);
+      ResetStream(stream_id, http2::error_codes::kRefusedStream);
+      return true;
+    }
+
+    it = streams_.emplace(stream_id, Stream{}).first;
+    it->second.send_window = peer_initial_window_;
+    it->second.recv_window = http2::kStreamWindowSize;
+
+  } else if (it->second.remote_closed) {
+    ResetStream(stream_id, http2::error_codes::kStreamClosed);
+    return true;
+  }
+
+  if (end_stream) {
+    it->second.remote_closed = true;
+  }
+
+  // NOTE: The stream might be reset during the call.
+  OnHeaders(stream_id, std::move(headers), end_stream);
+
+  if (end_stream) {
+    it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+      CloseIfDone(it);
+    }
+  }
+
+  return true;
+}
+
+bool Http2Session::HandleSettings(std::uint8_t flags, std::uint32_t stream_id,
+                                  const char* payload, std::size_t length) {
+  if (stream_id != 0) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "SETTINGS on a stream");
+  }
+
+  if ((flags & http2::flags::kAck) != 0) {
+    if (length != 0) {
+      return ConnectionError(http2::error_codes::kFrameSizeError,
+                             "Invalid SETTINGS ACK");
+    }
+    return true;
+  }
+
+  if (length % 6 != 0) {
+    return ConnectionError(http2::error_codes::kFrameSizeError,
+                           "Invalid SETTINGS");
+  }
+
+  for (std::size_t i = 0; i < length; i += 6) {
+    auto p = reinterpret_cast<const unsigned char*>(payload + i);
+    std::uint16_t id = static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+    std::uint32_t value = ReadUint32(payload + i + 2);
+
+    switch (id) {
+      case http2::settings::kHeaderTableSize:
+        encoder_.set_max_table_size(value);
+        break;
+
+      case http2::settings::kEnablePush:
+        if (value > 1) {
+          return ConnectionError(http2::error_codes::kProtocolError,
+                                 "Invalid SETTINGS_ENABLE_PUSH");
+        }
+        break;
+
+      case http2::settings::kInitialWindowSize: {
+        if (value > http2::kMaxWindowSize) {
+          return ConnectionError(http2::error_codes::kFlowControlError,
+                                 "Invalid SETTINGS_INITIAL_WINDOW_SIZE");
+        }
+        // Adjust the windows of the open streams by the difference.
+        std::int64_t delta = value - peer_initial_window_;
+        for (auto& pair : streams_) {
+          pair.second.send_window += delta;
+          if (pair.second.send_window > http2::kMaxWindowSize) {
+            return ConnectionError(http2::error_codes::kFlowControlError,
+                                   "Stream window overflow");
+          }
+        }
+        peer_initial_window_ = value;
+        break;
+      }
+
+      case http2::settings::kMaxConcurrentStreams:
+        peer_max_concurrent_streams_ = value;
+        break;
+
+      case http2::settings::kMaxFrameSize:
+        if (value < http2::kDefaultMaxFrameSize || value > 0xffffff) {
+          return ConnectionError(http2::error_codes::kProtocolError,
+                                 "Invalid SETTINGS_MAX_FRAME_SIZE");
+        }
+        peer_max_frame_size_ = value;
+        break;
+
+      default:
+        // Unknown or unused settings.
+        break;
+    }
+  }
+
+  AppendFrameHeader(0, frame_types::kSettings, http2::flags::kAck, 0);
+
+  // The windows might have grown.
+  WriteData();
+
+  return true;
+}
+
+bool Http2Session::HandleWindowUpdate(std::uint32_t stream_id,
+                                      const char* payload,
+                                      std::size_t length) {
+  if (length != 4) {
+    return ConnectionError(http2::error_codes::kFrameSizeError,
+                           "Invalid WINDOW_UPDATE");
+  }
+
+  std::uint32_t increment = ReadUint32(payload) & 0x7fffffff;
+
+  if (stream_id == 0) {
+    if (increment == 0) {
+      return ConnectionError(http2::error_codes::kProtocolError,
+                             "Invalid WINDOW_UPDATE");
+    }
+    send_window_ += increment;
+    if (send_window_ > http2::kMaxWindowSize) {
+      return ConnectionError(http2::error_codes::kFlowControlError,
+                             "Connection window overflow");
+    }
+  } else {
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+      return true;
+    }
+    if (increment == 0) {
+      ResetStream(stream_id, http2::error_codes::kProtocolError);
+      return true;
+    }
+    it->second.send_window += increment;
+    if (it->second.send_window > http2::kMaxWindowSize) {
+      ResetStream(stream_id, http2::error_codes::kFlowControlError);
+      return true;
+    }
+  }
+
+  WriteData();
+
+  return true;
+}
+
+bool Http2Session::RemovePadding(std::uint8_t flags, const char** payload,
+                                 std::size_t* length) {
+  if ((flags & http2::flags::kPadded) == 0) {
+    return true;
+  }
+
+  if (*length == 0) {
+    return ConnectionError(http2::error_codes::kFrameSizeError,
+                           "Invalid padding");
+  }
+
+  std::size_t pad_length = static_cast<unsigned char>((*payload)[0]);
+  if (pad_length >= *length) {
+    return ConnectionError(http2::error_codes::kProtocolError,
+                           "Invalid padding");
+  }
+
+  *payload += 1;
+  *length -= 1 + pad_length;
+  return true;
+}
+
+void Http2Session::WriteDataFrame(std::uint32_t stream_id, Stream* stream) {
+  const std::size_t max_length = static_cast<std::size_t>(std::min(
+      { static_cast<std::int64_t>(peer_max_frame_size_), stream->send_window,
+        send_window_ }));
+
+  // The length and the flags are fixed after the data is copied.
+  const std::size_t header_pos = output_.size();
+  AppendFrameHeader(0, frame_types::kData, 0, stream_id);
+
+  std::size_t length = 0;
+  bool more = NextBuffer(stream_id, stream);
+  while (more && length < max_length) {
+    const auto& buffer = stream->payload[stream->index];
+    std::size_t size =
+        std::min(buffer.size() - stream->offset, max_length - length);
+    output_.append(static_cast<const char*>(buffer.data()) + stream->offset,
+                   size);
+    stream->offset += size;
+    length += size;
+
+    // NOTE: The buffer copied might be freed by the body.
+    more = NextBuffer(stream_id, stream);
+  }
+
+  output_[header_pos] = static_cast<char>((length >> 16) & 0xff);
+  output_[header_pos + 1] = static_cast<char>((length >> 8) & 0xff);
+  output_[header_pos + 2] = static_cast<char>(length & 0xff);
+
+  if (!more) {
+    if (stream->waiting) {
+      // Nothing more for now, go on later (see ResumeData()).
+      if (length == 0) {
+        output_.resize(header_pos);
+        return;
+      }
+    } else {
+      output_[header_pos + 4] = static_cast<char>(http2::flags::kEndStream);
+      stream->local_closed = true;
+      stream->body.reset();
+      stream->payload.clear();
+    }
+  }
+
+  stream->send_window -= length;
+  send_window_ -= length;
+}
+
+bool Http2Session::NextBuffer(std::uint32_t stream_id, Stream* stream) {
+  while (true) {
+    for (; stream->index < stream->payload.size(); ++stream->index) {
+      if (stream->offset < stream->payload[stream->index].size()) {
+        return true;
+      }
+      stream->offset = 0;
+    }
+
+    stream->payload = stream->body->NextPayload(true);
+    stream->index = 0;
+    stream->offset = 0;
+
+    if (stream->payload.empty()) {
+      stream->waiting = WaitData(stream_id, stream->body.get());
+      return false;
+    }
+  }
+}
+
+void Http2Session::CloseIfDone(StreamMap::iterator it) {
+  if (!it->second.local_closed) {
+    return;
+  }
+
+  if (it->second.remote_closed) {
+    CloseStream(it, http2::error_codes::kNoError);
+  } else if (server_) {
+    // The response is complete before the request, e.g., an error response,
+    // stop the client from sending the rest of the request.
+    ResetStream(it->first, http2::error_codes::kNoError);
+  }
+}
+
+void Http2Session::DetachBodies() {
+  for (auto& pair : streams_) {
+    if (pair.second.body != nullptr) {
+      pair.second.body->Detach();
+    }
+  }
+}
+
+void Http2Session::CloseStream(StreamMap::iterator it,
+                               std::uint32_t error_code) {
+  std::uint32_t stream_id = it->first;
+  streams_.erase(it);
+  OnStreamClosed(stream_id, error_code);
+}
+
+bool Http2Session::ConnectionError(std::uint32_t error_code,
+                                   const char* reason) {
+  LOG_WARN("HTTP/2 connection error: %s", reason);
+
+  going_away_ = true;
+
+  AppendFrameHeader(8, frame_types::kGoAway, 0, 0);
+  AppendUint32(last_peer_stream_id_, &output_);
+  AppendUint32(error_code, &output_);
+
+  return false;
+}
+
+void Http2Session::AppendFrameHeader(std::size_t length, std::uint8_t type,
+                                     std::uint8_t flags,
+                                     std::uint32_t stream_id) {
+  output_.push_back(static_cast<char>((length >> 16) & 0xff));
+  output_.push_back(static_cast<char>((length >> 8) & 0xff));
+  output_.push_back(static_cast<char>(length & 0xff));
+  output_.push_back(static_cast<char>(type));
+  output_.push_back(static_cast<char>(flags));
+  AppendUint32(stream_id & 0x7fffffff, &output_);
+}
+
+void Http2Session::AppendSetting(std::uint16_t id, std::uint32_t value) {
+  output_.push_back(static_cast<char>((id >> 8) & 0xff));
+  output_.push_back(static_cast<char>(id & 0xff));
+  AppendUint32(value, &output_);
+}
+
+void Http2Session::AppendWindowUpdate(std::uint32_t stream_id,
+                                      std::uint32_t increment) {
+  AppendFrameHeader(4, frame_types::kWindowUpdate, 0, stream_id);
+  AppendUint32(increment, &output_);
+}
+
+}  // namespace webcc
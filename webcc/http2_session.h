@@ -0,0 +1,314 @@
+#ifndef WEBCC_HTTP2_SESSION_H_
+#define WEBCC_HTTP2_SESSION_H_
+
+// The protocol engine of HTTP/2 (RFC 9113), shared by the server and the
+// client. It does no I/O: the received data is fed to it, and the frames it
+// produces are taken out by the owner to write to the socket.
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "webcc/body.h"
+#include "webcc/common.h"
+#include "webcc/hpack.h"
+
+namespace webcc {
+
+namespace http2 {
+
+// The connection preface sent by the client.
+const char* const kClientPreface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr std::size_t kClientPrefaceLength = 24;
+
+// The first line of the preface, parsed as the start line of an HTTP/1 request
+// by the server.
+const char* const kPrefaceStartLine = "PRI * HTTP/2.0";
+
+// The identifier of HTTP/2 over TLS for ALPN.
+const char* const kAlpnId = "h2";
+
+constexpr std::size_t kFrameHeaderLength = 9;
+
+namespace frame_types {
+
+constexpr std::uint8_t kData = 0x0;
+constexpr std::uint8_t kHeaders = 0x1;
+constexpr std::uint8_t kPriority = 0x2;
+constexpr std::uint8_t kRstStream = 0x3;
+constexpr std::uint8_t kSettings = 0x4;
+constexpr std::uint8_t kPushPromise = 0x5;
+constexpr std::uint8_t kPing = 0x6;
+constexpr std::uint8_t kGoAway = 0x7;
+constexpr std::uint8_t kWindowUpdate = 0x8;
+constexpr std::uint8_t kContinuation = 0x9;
+
+}  // namespace frame_types
+
+namespace flags {
+
+constexpr std::uint8_t kEndStream = 0x1;
+constexpr std::uint8_t kAck = 0x1;
+constexpr std::uint8_t kEndHeaders = 0x4;
+constexpr std::uint8_t kPadded = 0x8;
+constexpr std::uint8_t kPriority = 0x20;
+
+}  // namespace flags
+
+namespace settings {
+
+constexpr std::uint16_t kHeaderTableSize = 0x1;
+constexpr std::uint16_t kEnablePush = 0x2;
+constexpr std::uint16_t kMaxConcurrentStreams = 0x3;
+constexpr std::uint16_t kInitialWindowSize = 0x4;
+constexpr std::uint16_t kMaxFrameSize = 0x5;
+constexpr std::uint16_t kMaxHeaderListSize = 0x6;
+
+}  // namespace settings
+
+namespace error_codes {
+
+constexpr std::uint32_t kNoError = 0x0;
+constexpr std::uint32_t kProtocolError = 0x1;
+constexpr std::uint32_t kInternalError = 0x2;
+constexpr std::uint32_t kFlowControlError = 0x3;
+constexpr std::uint32_t kStreamClosed = 0x5;
+constexpr std::uint32_t kFrameSizeError = 0x6;
+constexpr std::uint32_t kRefusedStream = 0x7;
+constexpr std::uint32_t kCancel = 0x8;
+constexpr std::uint32_t kCompressionError = 0x9;
+constexpr std::uint32_t kEnhanceYourCalm = 0xb;
+
+}  // namespace error_codes
+
+// The initial flow-control window and the maximum frame size of the protocol.
+constexpr std::int64_t kDefaultWindowSize = 65535;
+constexpr std::size_t kDefaultMaxFrameSize = 16384;
+
+constexpr std::int64_t kMaxWindowSize = 0x7fffffff;
+
+// The windows advertised for receiving, larger than the default to not slow
+// down the uploads.
+constexpr std::int64_t kStreamWindowSize = 1024 * 1024;
+constexpr std::int64_t kConnectionWindowSize = 16 * 1024 * 1024;
+
+// The maximum number of concurrent streams the peer can open.
+constexpr std::uint32_t kMaxConcurrentStreams = 100;
+
+// The maximum size of a header block (HEADERS and CONTINUATION).
+constexpr std::size_t kMaxHeaderBlockSize = 64 * 1024;
+
+// Is the header specific to an HTTP/1 connection, which is not allowed in
+// HTTP/2 (e.g., Connection, Transfer-Encoding)?
+bool IsConnectionSpecific(std::string_view name);
+
+}  // namespace http2
+
+// -----------------------------------------------------------------------------
+
+class Http2Session {
+public:
+  explicit Http2Session(bool server) : server_(server) {
+  }
+
+  Http2Session(const Http2Session&) = delete;
+  Http2Session& operator=(const Http2Session&) = delete;
+
+  virtual ~Http2Session() = default;
+
+  // The number of open streams.
+  std::size_t stream_count() const {
+    return streams_.size();
+  }
+
+  // The maximum number of concurrent streams this side can open, as set by the
+  // peer. Unlimited until the peer tells.
+  std::uint32_t peer_max_concurrent_streams() const {
+    return peer_max_concurrent_streams_;
+  }
+
+  // Has the peer sent a GOAWAY, or has a connection error occurred?
+  bool going_away() const {
+    return going_away_;
+  }
+
+  // Is there any output to write?
+  bool HasOutput() const {
+    return !output_.empty();
+  }
+
+  // Take the frames produced so far to write.
+  void TakeOutput(std::string* output) {
+    output->clear();
+    output->swap(output_);
+  }
+
+  // Produce the connection preface (client only) and the settings.
+  void Start();
+
+  // Process the data received.
+  // Return false on a connection error, with a GOAWAY in the output. The
+  // connection should be closed once the output has been written.
+  bool Feed(const char* data, std::size_t length);
+
+  // Produce the DATA frames of the bodies being sent, as far as the
+  // flow-control windows allow. Call it again once the output has been
+  // written, since the output is limited in size each time.
+  void WriteData();
+
+protected:
+  // Called when the header block of a stream has been received.
+  // On the server, a new stream is opened by the peer (a request).
+  virtual void OnHeaders(std::uint32_t stream_id,
+                         std::vector<Header>&& headers, bool end_stream) = 0;
+
+  // Called when some data of a stream has been received.
+  virtual void OnData(std::uint32_t stream_id, const char* data,
+                      std::size_t length, bool end_stream) = 0;
+
+  // Called when a stream has been closed. The error code is not kNoError if
+  // it was reset, by either side.
+  virtual void OnStreamClosed(std::uint32_t stream_id,
+                              std::uint32_t error_code) = 0;
+
+  // Open a new stream (client only) and return its ID.
+  std::uint32_t OpenStream();
+
+  // Send a header block and then the body, if any, on a stream.
+  // The header block is encoded with encoder().
+  void Submit(std::uint32_t stream_id, const std::string& block,
+              BodyPtr body);
+
+  // Reset a stream with the given error code.
+  void ResetStream(std::uint32_t stream_id, std::uint32_t error_code);
+
+  // Called when the body being sent on a stream has nothing for now (see
+  // Body::WaitPayload()). Return true if it's waited for, then ResumeData()
+  // should be called once there's more.
+  virtual bool WaitData(std::uint32_t stream_id, Body* body) {
+    return false;
+  }
+
+  // Go on with sending the body of a stream which has been waited for.
+  void ResumeData(std::uint32_t stream_id);
+
+  // Detach the bodies being sent, which won't be sent any more since the
+  // connection has been closed (see Body::Detach()).
+  void DetachBodies();
+
+  HpackEncoder& encoder() {
+    return encoder_;
+  }
+
+private:
+  struct Stream {
+    // The flow-control windows.
+    std::int64_t send_window = 0;
+    std::int64_t recv_window = 0;
+
+    // END_STREAM received or sent.
+    bool remote_closed = false;
+    bool local_closed = false;
+
+    // The body being sent and the position in its current payload.
+    BodyPtr body;
+    Payload payload;
+    std::size_t index = 0;
+    std::size_t offset = 0;
+
+    // The body has nothing to send for now (see WaitData()).
+    bool waiting = false;
+  };
+
+  using StreamMap = std::map<std::uint32_t, Stream>;
+
+  bool HandleFrame(std::uint8_t type, std::uint8_t flags,
+                   std::uint32_t stream_id, const char* payload,
+                   std::size_t length);
+
+  bool HandleData(std::uint8_t flags, std::uint32_t stream_id,
+                  const char* payload, std::size_t length);
+
+  bool HandleHeaders(std::uint8_t flags, std::uint32_t stream_id,
+                     const char* payload, std::size_t length);
+
+  bool HandleContinuation(std::uint8_t flags, std::uint32_t stream_id,
+                          const char* payload, std::size_t length);
+
+  bool HandleHeaderBlock(std::uint32_t stream_id, const char* block,
+                         std::size_t length, bool end_stream);
+
+  bool HandleSettings(std::uint8_t flags, std::uint32_t stream_id,
+                      const char* payload, std::size_t length);
+
+  bool HandleWindowUpdate(std::uint32_t stream_id, const char* payload,
+                          std::size_t length);
+
+  // Remove the padding of a padded frame.
+  bool RemovePadding(std::uint8_t flags, const char** payload,
+                     std::size_t* length);
+
+  // Write a DATA frame of a stream with a body.
+  void WriteDataFrame(std::uint32_t stream_id, Stream* stream);
+
+  // Move to the next non-empty buffer of the body. Return false at the end,
+  // or if the body is waited for (see WaitData()).
+  bool NextBuffer(std::uint32_t stream_id, Stream* stream);
+
+  // Close the stream if both sides have ended it.
+  void CloseIfDone(StreamMap::iterator it);
+
+  void CloseStream(StreamMap::iterator it, std::uint32_t error_code);
+
+  // Produce a GOAWAY and return false for the convenience of the handlers.
+  bool ConnectionError(std::uint32_t error_code, const char* reason);
+
+  void AppendFrameHeader(std::size_t length, std::uint8_t type,
+                         std::uint8_t flags, std::uint32_t stream_id);
+
+  void AppendSetting(std::uint16_t id, std::uint32_t value);
+
+  void AppendWindowUpdate(std::uint32_t stream_id, std::uint32_t increment);
+
+private:
+  bool server_;
+
+  // The streams open, by ID.
+  StreamMap streams_;
+
+  // The ID of the last stream opened by the peer, and the next one to open by
+  // this side.
+  std::uint32_t last_peer_stream_id_ = 0;
+  std::uint32_t next_stream_id_ = 1;
+
+  bool preface_received_ = false;
+  bool going_away_ = false;
+
+  // The data received but not processed yet (incomplete frames).
+  std::string input_;
+
+  // The frames to write.
+  std::string output_;
+
+  // The header block being received, maybe in several frames.
+  std::string header_block_;
+  std::uint32_t header_stream_id_ = 0;
+  bool header_end_stream_ = false;
+
+  // The settings of the peer.
+  std::int64_t peer_initial_window_ = http2::kDefaultWindowSize;
+  std::size_t peer_max_frame_size_ = http2::kDefaultMaxFrameSize;
+  std::uint32_t peer_max_concurrent_streams_ = 0xffffffff;
+
+  // The flow-control windows of the connection.
+  std::int64_t send_window_ = http2::kDefaultWindowSize;
+  std::int64_t recv_window_ = http2::kConnectionWindowSize;
+
+  HpackEncoder encoder_;
+  HpackDecoder decoder_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_HTTP2_SESSION_H_
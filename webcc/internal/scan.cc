@@ -0,0 +1,297 @@
+#include "webcc/internal/scan.h"
+
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define WEBCC_SCAN_X86 1
+#include <immintrin.h>
+#else
+#define WEBCC_SCAN_X86 0
+#endif
+
+namespace webcc {
+namespace internal {
+
+namespace {
+
+constexpr std::size_t npos = std::string_view::npos;
+
+// Find `p` of length `k` in `s` of length `n`, where 0 < k <= n.
+using FindFunc = std::size_t (*)(const char* s, std::size_t n, const char* p,
+                                 std::size_t k);
+
+std::size_t FindScalar(const char* s, std::size_t n, const char* p,
+                       std::size_t k) {
+  return std::string_view{ s, n }.find(std::string_view{ p, k });
+}
+
+#if WEBCC_SCAN_X86
+
+// The blocks of data are skipped as long as the first char of the pattern,
+// which is CR for all the delimiters and rare in the data, is not found.
+// Otherwise the candidates are the positions matching both the first and the
+// last char of the pattern, which are then verified one by one.
+// See http://0x80.pl/articles/simd-strfind.html
+
+// Verify the candidates in the mask, a bit for each position from `s`.
+// Return the position of the first match, or npos.
+// The chars are compared without calling memcmp(), which would make the
+// vectors be spilled to the stack in the loops.
+inline std::size_t Verify(const char* s, std::uint64_t mask, const char* p,
+                          std::size_t k) {
+  while (mask != 0) {
+    std::size_t pos = __builtin_ctzll(mask);
+    std::size_t j = 1;
+    while (j + 1 < k && s[pos + j] == p[j]) {
+      ++j;
+    }
+    if (j + 1 >= k) {
+      return pos;
+    }
+    mask &= mask - 1;
+  }
+  return npos;
+}
+
+__attribute__((target("sse2")))
+inline __m128i Load16(const char* s) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+}
+
+// The mask of the candidates in the 16 positions from `s`.
+__attribute__((target("sse2")))
+inline std::uint64_t Candidates16(const char* s, std::size_t k, __m128i first,
+                                  __m128i last) {
+  const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, Load16(s)),
+                                   _mm_cmpeq_epi8(last, Load16(s + k - 1)));
+  return static_cast<std::uint16_t>(_mm_movemask_epi8(eq));
+}
+
+__attribute__((target("sse2")))
+std::size_t FindSse2(const char* s, std::size_t n, const char* p,
+                     std::size_t k) {
+  const __m128i first = _mm_set1_epi8(p[0]);
+  const __m128i last = _mm_set1_epi8(p[k - 1]);
+
+  std::size_t i = 0;
+
+  for (; i + k - 1 + 64 <= n; i += 64) {
+    const __m128i any = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(first, Load16(s + i)),
+                     _mm_cmpeq_epi8(first, Load16(s + i + 16))),
+        _mm_or_si128(_mm_cmpeq_epi8(first, Load16(s + i + 32)),
+                     _mm_cmpeq_epi8(first, Load16(s + i + 48))));
+    if (_mm_movemask_epi8(any) == 0) {
+      continue;
+    }
+
+    std::uint64_t mask = Candidates16(s + i, k, first, last) |
+                         Candidates16(s + i + 16, k, first, last) << 16 |
+                         Candidates16(s + i + 32, k, first, last) << 32 |
+                         Candidates16(s + i + 48, k, first, last) << 48;
+
+    std::size_t pos = Verify(s + i, mask, p, k);
+    if (pos != npos) {
+      return i + pos;
+    }
+  }
+
+  for (; i + k - 1 + 16 <= n; i += 16) {
+    std::size_t pos = Verify(s + i, Candidates16(s + i, k, first, last), p, k);
+    if (pos != npos) {
+      return i + pos;
+    }
+  }
+
+  // The rest is shorter than a vector.
+  std::size_t pos = FindScalar(s + i, n - i, p, k);
+  return pos == npos ? npos : i + pos;
+}
+
+__attribute__((target("avx2")))
+inline __m256i Load32(const char* s) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+}
+
+// The mask of the candidates in the 32 positions from `s`.
+__attribute__((target("avx2")))
+inline std::uint64_t Candidates32(const char* s, std::size_t k, __m256i first,
+                                  __m256i last) {
+  const __m256i eq =
+      _mm256_and_si256(_mm256_cmpeq_epi8(first, Load32(s)),
+                       _mm256_cmpeq_epi8(last, Load32(s + k - 1)));
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+}
+
+__attribute__((target("avx2")))
+std::size_t FindAvx2(const char* s, std::size_t n, const char* p,
+                     std::size_t k) {
+  const __m256i first = _mm256_set1_epi8(p[0]);
+  const __m256i last = _mm256_set1_epi8(p[k - 1]);
+
+  std::size_t i = 0;
+
+  for (; i + k - 1 + 128 <= n; i += 128) {
+    const __m256i any = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(first, Load32(s + i)),
+                        _mm256_cmpeq_epi8(first, Load32(s + i + 32))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(first, Load32(s + i + 64)),
+                        _mm256_cmpeq_epi8(first, Load32(s + i + 96))));
+    if (_mm256_testz_si256(any, any)) {
+      continue;
+    }
+
+    for (std::size_t j = 0; j < 128; j += 64) {
+      std::uint64_t mask = Candidates32(s + i + j, k, first, last) |
+                           Candidates32(s + i + j + 32, k, first, last) << 32;
+
+      std::size_t pos = Verify(s + i + j, mask, p, k);
+      if (pos != npos) {
+        return i + j + pos;
+      }
+    }
+  }
+
+  // The rest is shorter than a block, go on with the shorter vectors.
+  std::size_t pos = FindSse2(s + i, n - i, p, k);
+  return pos == npos ? npos : i + pos;
+}
+
+#endif  // WEBCC_SCAN_X86
+
+ScanLevel DetectScanLevel() {
+#if WEBCC_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return ScanLevel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return ScanLevel::kSse2;
+  }
+#endif  // WEBCC_SCAN_X86
+  return ScanLevel::kScalar;
+}
+
+FindFunc GetFindFunc(ScanLevel level) {
+#if WEBCC_SCAN_X86
+  switch (level) {
+    case ScanLevel::kAvx2:
+      return &FindAvx2;
+    case ScanLevel::kSse2:
+      return &FindSse2;
+    default:
+      break;
+  }
+#endif  // WEBCC_SCAN_X86
+  return &FindScalar;
+}
+
+struct Scanner {
+  Scanner() : supported(DetectScanLevel()) {
+#if defined(__GLIBC__)
+    level = ScanLevel::kScalar;
+#else
+    level = supported;
+#endif
+    find = GetFindFunc(level);
+  }
+
+  const ScanLevel supported;
+  ScanLevel level;
+  FindFunc find;
+};
+
+Scanner& GetScanner() {
+  static Scanner scanner;
+  return scanner;
+}
+
+}  // namespace
+
+ScanLevel GetScanLevel() {
+  return GetScanner().level;
+}
+
+ScanLevel GetSupportedScanLevel() {
+  return GetScanner().supported;
+}
+
+const char* GetScanLevelName(ScanLevel level) {
+  switch (level) {
+    case ScanLevel::kAvx2:
+      return "AVX2";
+    case ScanLevel::kSse2:
+      return "SSE2";
+    default:
+      return "Scalar";
+  }
+}
+
+void SetScanLevel(ScanLevel level) {
+  Scanner& scanner = GetScanner();
+  scanner.level = level < scanner.supported ? level : scanner.supported;
+  scanner.find = GetFindFunc(scanner.level);
+}
+
+std::size_t Find(std::string_view str, std::string_view pattern,
+                 std::size_t off) {
+  if (off > str.size()) {
+    return npos;
+  }
+  if (pattern.empty()) {
+    return off;
+  }
+  if (pattern.size() > str.size() - off) {
+    return npos;
+  }
+
+  std::size_t pos = GetScanner().find(str.data() + off, str.size() - off,
+                                      pattern.data(), pattern.size());
+  return pos == npos ? npos : off + pos;
+}
+
+// -----------------------------------------------------------------------------
+
+void Searcher::Reset(std::string_view pattern) {
+  pattern_ = pattern;
+
+  // The shift is the distance from the last occurrence of the char to the end
+  // of the pattern, the last char itself excluded.
+  shifts_.fill(pattern_.size());
+  for (std::size_t i = 0; i + 1 < pattern_.size(); ++i) {
+    shifts_[static_cast<unsigned char>(pattern_[i])] = pattern_.size() - 1 - i;
+  }
+}
+
+std::size_t Searcher::Find(std::string_view str, std::size_t off) const {
+  const std::size_t k = pattern_.size();
+  if (off > str.size()) {
+    return npos;
+  }
+  if (k == 0) {
+    return off;
+  }
+
+  const char* p = pattern_.data();
+  const char last = p[k - 1];
+
+  for (std::size_t i = off; i + k <= str.size();) {
+    const char c = str[i + k - 1];
+    if (c == last) {
+      std::size_t j = 0;
+      while (j + 1 < k && str[i + j] == p[j]) {
+        ++j;
+      }
+      if (j + 1 == k) {
+        return i;
+      }
+    }
+    i += shifts_[static_cast<unsigned char>(c)];
+  }
+
+  return npos;
+}
+
+}  // namespace internal
+}  // namespace webcc
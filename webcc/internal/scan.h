@@ -0,0 +1,85 @@
+#ifndef WEBCC_INTERNAL_SCAN_H_
+#define WEBCC_INTERNAL_SCAN_H_
+
+// Vectorized scanning of the data received for the delimiters (CRLF, the end
+// of the headers, the multipart boundaries, etc.).
+// The instructions are chosen at runtime: AVX2 if the CPU supports it, SSE2
+// (always there on x86-64), or the scalar code on the other platforms.
+// With glibc, the scalar code is used by default instead, which finds the
+// first char with memchr(), already vectorized (up to AVX-512) and chosen at
+// runtime by glibc, and faster than the vectors here (see parser_benchmark).
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace webcc {
+namespace internal {
+
+enum class ScanLevel {
+  // std::string_view::find().
+  kScalar,
+  kSse2,
+  kAvx2,
+};
+
+// The instructions used to scan.
+ScanLevel GetScanLevel();
+
+// The best instructions supported by the CPU.
+ScanLevel GetSupportedScanLevel();
+
+// The name of the level, e.g., "AVX2".
+const char* GetScanLevelName(ScanLevel level);
+
+// Scan with the given level, or the best one supported if it's higher.
+// Not thread-safe, call it before any scanning (e.g., in benchmarks).
+void SetScanLevel(ScanLevel level);
+
+// Find the first occurrence of `pattern` in `str` from `off`.
+// The same as std::string_view::find() but vectorized.
+std::size_t Find(std::string_view str, std::string_view pattern,
+                 std::size_t off = 0);
+
+inline std::size_t FindCRLF(std::string_view str, std::size_t off = 0) {
+  return Find(str, std::string_view{ "\r\n", 2 }, off);
+}
+
+// -----------------------------------------------------------------------------
+
+// Boyer-Moore-Horspool search for a pattern known in advance and searched for
+// again and again, e.g., the delimiter of the multipart form data. The longer
+// the pattern, the more data skipped at each step.
+class Searcher {
+public:
+  Searcher() = default;
+
+  explicit Searcher(std::string_view pattern) {
+    Reset(pattern);
+  }
+
+  void Reset(std::string_view pattern);
+
+  const std::string& pattern() const {
+    return pattern_;
+  }
+
+  std::size_t size() const {
+    return pattern_.size();
+  }
+
+  // Find the first occurrence of the pattern in `str` from `off`.
+  std::size_t Find(std::string_view str, std::size_t off = 0) const;
+
+private:
+  std::string pattern_;
+
+  // How far to shift the pattern by the last char of the window.
+  std::array<std::size_t, 256> shifts_{};
+};
+
+}  // namespace internal
+}  // namespace webcc
+
+#endif  // WEBCC_INTERNAL_SCAN_H_
@@ -1,6 +1,7 @@
 #include "webcc/message.h"
 
 #include <sstream>
+#include <typeinfo>
 
 #include "boost/algorithm/string.hpp"
 
@@ -13,6 +14,19 @@ namespace webcc {
 Message::Message() : body_(new Body{}) {
 }
 
+void Message::Clear() {
+  start_line_ = std::string_view{};
+  start_line_data_.clear();
+  header_block_.clear();
+  headers_.Clear();
+  content_length_ = kInvalidSize;
+
+  // The empty body has no state, keep it.
+  if (typeid(*body_) != typeid(Body)) {
+    body_.reset(new Body{});
+  }
+}
+
 void Message::SetBody(BodyPtr body, bool set_length) {
   if (body == body_) {
     return;
@@ -24,12 +38,23 @@ void Message::SetBody(BodyPtr body, bool set_length) {
     body_ = body;
   }
 
-  if (set_length) {
+  if (set_length && body_->GetSize() != kInvalidSize) {
     content_length_ = body_->GetSize();
     SetHeader(headers::kContentLength, std::to_string(content_length_));
   }
 }
 
+bool Message::SetChunked() {
+  auto stream_body = std::dynamic_pointer_cast<StreamBody>(body_);
+  if (stream_body == nullptr) {
+    return false;
+  }
+
+  stream_body->set_chunked(true);
+  SetHeader(headers::kTransferEncoding, "chunked");
+  return true;
+}
+
 const std::string& Message::data() const {
   static const std::string kEmptyData;
 
@@ -41,7 +66,7 @@ const std::string& Message::data() const {
 }
 
 bool Message::IsConnectionKeepAlive() const {
-  std::string_view value = GetHeader(headers::kConnection);
+  std::string_view value = GetHeader(HeaderId::kConnection);
   if (value.empty()) {
     // The Connection header doesn't exist.
     // Return true since keep-alive is by default for HTTP/1.1.
@@ -51,7 +76,7 @@ bool Message::IsConnectionKeepAlive() const {
 }
 
 ContentEncoding Message::GetContentEncoding() const {
-  std::string_view value = GetHeader(headers::kContentEncoding);
+  std::string_view value = GetHeader(HeaderId::kContentEncoding);
   if (value == "gzip") {
     return ContentEncoding::kGzip;
   } else if (value == "deflate") {
@@ -79,12 +104,14 @@ Payload Message::GetPayload() const {
   using boost::asio::buffer;
   namespace literal_buffers = internal::literal_buffers;
 
+  // The start line, four buffers for each header and the empty line.
   Payload payload;
+  payload.reserve(3 + headers_.size() * 4);
 
   payload.push_back(buffer(start_line_));
   payload.push_back(buffer(literal_buffers::CRLF));
 
-  for (const Header& h : headers_.data()) {
+  for (const HeaderView& h : headers_.data()) {
     payload.push_back(buffer(h.first));
     payload.push_back(buffer(literal_buffers::HEADER_SEPARATOR));
     payload.push_back(buffer(h.second));
@@ -99,7 +126,7 @@ Payload Message::GetPayload() const {
 void Message::Dump(std::ostream& os, std::string_view prefix) const {
   os << prefix << start_line_ << std::endl;
 
-  for (const Header& h : headers_.data()) {
+  for (const HeaderView& h : headers_.data()) {
     os << prefix << h.first << ": " << h.second << std::endl;
   }
 
@@ -21,30 +21,73 @@ public:
 
   virtual ~Message() = default;
 
-  const std::string& start_line() const {
+  // Clear the message so that it could be used again, e.g., for the next
+  // request of a keep-alive connection. The memory of the strings and the
+  // headers is kept for the next one.
+  virtual void Clear();
+
+  std::string_view start_line() const {
     return start_line_;
   }
 
+  // Set the start line with a copy of it.
   void set_start_line(std::string_view start_line) {
+    start_line_data_ = start_line;
+    start_line_ = start_line_data_;
+  }
+
+  // The header block (i.e., the start line and the headers, with the ending
+  // empty line) of a message received, which the start line and the headers
+  // refer to instead of the copies of them. See MessageParser.
+  const std::string& header_block() const {
+    return header_block_;
+  }
+
+  // Keep a copy of the header block received, and refer to it with the start
+  // line and the headers set later (see set_start_line_view() and
+  // SetHeaderView()). The capacity of the last one is reused.
+  void set_header_block(std::string_view header_block) {
+    header_block_ = header_block;
+  }
+
+  // Set the start line referring to the header block, or to any data which
+  // outlives the message (e.g., the shared start lines of the responses).
+  void set_start_line_view(std::string_view start_line) {
     start_line_ = start_line;
   }
 
-  void SetHeader(Header&& header) {
-    headers_.Set(std::move(header.first), std::move(header.second));
+  void SetHeader(const Header& header) {
+    headers_.Set(header.first, header.second);
   }
 
   void SetHeader(std::string_view key, std::string_view value) {
     headers_.Set(key, value);
   }
 
+  // Set a header referring to the header block, with the ID of the key got
+  // already.
+  void SetHeaderView(HeaderId id, std::string_view key,
+                     std::string_view value) {
+    headers_.SetView(id, key, value);
+  }
+
   std::string_view GetHeader(std::string_view key) const {
     return headers_.Get(key);
   }
 
+  // Get a well-known header by ID, e.g., GetHeader(HeaderId::kConnection).
+  std::string_view GetHeader(HeaderId id) const {
+    return headers_.Get(id);
+  }
+
   bool HeaderExist(std::string_view key) const {
     return !headers_.Get(key).empty();
   }
 
+  const Headers& headers() const {
+    return headers_;
+  }
+
   std::size_t content_length() const {
     return content_length_;
   }
@@ -53,8 +96,16 @@ public:
     content_length_ = content_length;
   }
 
+  // Set the body, and the Content-Length header if `set_length` is true and
+  // the size of the body is known.
   void SetBody(BodyPtr body, bool set_length);
 
+  // If the body is produced as it's being sent (see StreamBody), set the
+  // Transfer-Encoding header to chunked and let the body be encoded so.
+  // For HTTP/1.1 only, HTTP/2 has a framing of its own.
+  // Return false if the body is not such one.
+  bool SetChunked();
+
   BodyPtr body() const {
     return body_;
   }
@@ -79,7 +130,7 @@ public:
 
   // Check the Accept-Encoding header to see if it contains "gzip".
   bool AcceptEncodingGzip() const {
-    return GetHeader(headers::kAcceptEncoding).find("gzip") !=
+    return GetHeader(HeaderId::kAcceptEncoding).find("gzip") !=
            std::string_view::npos;
   }
 
@@ -107,7 +158,11 @@ public:
   std::string Dump(std::string_view prefix = "") const;
 
 protected:
-  std::string start_line_;
+  // Refers to either `start_line_data_` or `header_block_`.
+  std::string_view start_line_;
+  std::string start_line_data_;
+
+  std::string header_block_;
 
   Headers headers_;
 
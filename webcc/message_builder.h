@@ -91,6 +91,13 @@ public:
     return *sub_this_;
   }
 
+  // Use the data produced by the generator as the body, piece by piece as it's
+  // being sent (see StreamBody).
+  SubBuilder& Stream(StreamBody::Generator generator) {
+    body_.reset(new StreamBody{ std::move(generator) });
+    return *sub_this_;
+  }
+
 protected:
   MessageBuilder(SubBuilder* sub_this) : sub_this_(sub_this) {
   }
@@ -1,8 +1,11 @@
 #include "webcc/message_parser.h"
 
+#include <algorithm>
+
 #include "boost/algorithm/string.hpp"
 
 #include "webcc/internal/globals.h"
+#include "webcc/internal/scan.h"
 #include "webcc/logger.h"
 #include "webcc/message.h"
 #include "webcc/string.h"
@@ -22,13 +25,14 @@ bool BodyHandler::IsCompressed() const {
 
 // -----------------------------------------------------------------------------
 
-// TODO
-//  // Reserve memory to avoid frequent reallocation when append.
-//  try {
-//    content_.reserve(content_length_);
-//  } catch (const std::exception& e) {
-//    LOG_ERRO("Failed to reserve content memory: %s.", e.what());
-//  }
+void StringBodyHandler::Reserve(std::size_t size) {
+  // Reserve memory to avoid frequent reallocation when append.
+  try {
+    content_.reserve(size);
+  } catch (const std::exception& e) {
+    LOG_ERRO("Failed to reserve content memory: %s.", e.what());
+  }
+}
 
 void StringBodyHandler::AddContent(const char* data, std::size_t count) {
   content_.append(data, count);
@@ -69,28 +73,14 @@ bool StringBodyHandler::Finish() {
 // -----------------------------------------------------------------------------
 
 bool FileBodyHandler::OpenFile() {
-  try {
-    temp_path_ = sfs::temp_directory_path();
-
-    // Generate a random string as file name.
-    // A replacement of boost::filesystem::unique_path().
-    temp_path_ /= RandomAsciiString(10);
-
-    LOG_VERB("Generate a temp path for streaming: %s",
+  if (!utility::OpenTempFile(&ofstream_, &temp_path_)) {
+    LOG_ERRO("Failed to open a temp file for streaming: %s",
              temp_path_.string().c_str());
-
-  } catch (const sfs::filesystem_error&) {
-    LOG_ERRO("Failed to generate temp path for streaming");
-    return false;
-  }
-
-  ofstream_.open(temp_path_, std::ios::binary);
-
-  if (ofstream_.fail()) {
-    LOG_ERRO("Failed to open the temp file: %s", temp_path_.string().c_str());
     return false;
   }
 
+  LOG_VERB("Generate a temp path for streaming: %s",
+           temp_path_.string().c_str());
   return true;
 }
 
@@ -122,11 +112,25 @@ bool FileBodyHandler::Finish() {
 void MessageParser::Init(Message* message) {
   message_ = message;
 
-  body_handler_.reset();
+  // The string body handler, the one for most messages, is kept for the next.
+  auto string_body_handler =
+      dynamic_cast<StringBodyHandler*>(body_handler_.get());
+  if (string_body_handler != nullptr) {
+    string_body_handler->Reset(message);
+  } else {
+    body_handler_.reset();
+  }
+
   stream_ = false;
 
+  body_limit_ = max_body_size_;
+  body_too_large_ = false;
+
   pending_data_.clear();
+  scan_off_ = 0;
   header_length_ = 0;
+  consumed_ = 0;
+  content_parsed_ = 0;
 
   content_length_ = kInvalidSize;
   content_type_.Clear();
@@ -135,7 +139,10 @@ void MessageParser::Init(Message* message) {
   header_ended_ = false;
   header_just_ended_ = false;
   chunked_ = false;
+  content_until_end_ = false;
   chunk_size_ = kInvalidSize;
+  chunk_data_ended_ = false;
+  chunked_left_ = 0;
   finished_ = false;
 }
 
@@ -144,56 +151,136 @@ bool MessageParser::Parse(const char* data, std::size_t length) {
     if (header_just_ended_) {
       header_just_ended_ = false;
     }
-    return ParseContent(data, length);
+    return ParseBody(data, length, &consumed_);
   }
 
-  header_length_ += length;
-
-  // Append the new data to the pending data.
-  pending_data_.append(data, length);
+  consumed_ = length;
 
-  if (!ParseHeaders()) {
-    return false;
+  // Usually the headers come in one read and are parsed from the data given,
+  // otherwise the data is kept until the end of the headers.
+  if (!pending_data_.empty()) {
+    pending_data_.append(data, length);
+    data = pending_data_.data();
+    length = pending_data_.size();
   }
 
-  if (!header_ended_) {
+  std::size_t end = FindHeaderEnd(data, length);
+
+  if (end == std::string::npos) {
+    if (pending_data_.empty()) {
+      pending_data_.assign(data, length);
+    }
+    // Go on from where the ending empty line could start.
+    scan_off_ = length < 3 ? 0 : length - 3;
+
     LOG_INFO("HTTP headers will continue in next read");
     return true;
   }
 
   LOG_INFO("HTTP headers just ended");
 
-  header_length_ -= pending_data_.size();
+  header_length_ = end;
 
-  // Leave sub-classes a chance to do some check before reading the body.
-  // E.g., RequestParser determines data streaming or not from here.
-  if (!OnHeadersEnd()) {
+  // The one and only copy of the headers, kept by the message.
+  message_->set_header_block(std::string_view{ data, end });
+
+  if (!ParseHeaders()) {
     return false;
   }
 
-  CreateBodyHandler();
+  if (!BeginBody()) {
+    return false;
+  }
 
-  if (body_handler_ == nullptr) {
-    // The only reason to reach here is that it was failed to generate the temp
-    // file for streaming. Normally, it shouldn't happen.
+  // The data left after the headers, if any, is the start of the content.
+  // The pending data is reused by the chunked content.
+  std::string left;
+  if (!pending_data_.empty()) {
+    left.swap(pending_data_);
+    data = left.data();
+  }
+  data += end;
+  length -= end;
+
+  std::size_t left_consumed = 0;
+  if (!ParseBody(data, length, &left_consumed)) {
+    return false;
+  }
+
+  consumed_ -= length - left_consumed;
+  return true;
+}
+
+bool MessageParser::SetHeaders(const std::string& start_line,
+                               std::vector<Header>&& headers,
+                               bool has_content) {
+  start_line_parsed_ = true;
+  message_->set_start_line(start_line);
+
+  if (!ParseStartLine(start_line)) {
+    return false;
+  }
+
+  for (const Header& header : headers) {
+    if (!CheckHeader(GetHeaderId(header.first), header.second)) {
+      return false;
+    }
+    message_->SetHeader(header);
+  }
+
+  header_ended_ = true;
+  header_just_ended_ = true;
+
+  content_until_end_ = has_content && !content_length_parsed_ && !chunked_;
+
+  if (!BeginBody()) {
+    return false;
+  }
+
+  // Finish now if there's no content.
+  return ParseBody(nullptr, 0, &consumed_);
+}
+
+bool MessageParser::EndContent() {
+  if (finished_) {
+    return true;
+  }
+
+  if (!content_until_end_) {
+    LOG_ERRO("The content ends before the Content-Length");
     return false;
   }
 
-  // The left data, if any, is still in the pending data.
-  return ParseContent("", 0);
+  return Finish();
+}
+
+std::size_t MessageParser::FindHeaderEnd(const char* data,
+                                         std::size_t length) const {
+  std::string_view str{ data, length };
+
+  // An empty line without headers at all.
+  if (boost::starts_with(str, internal::kCRLF)) {
+    return 2;
+  }
+
+  std::size_t pos = internal::Find(str, "\r\n\r\n", scan_off_);
+  if (pos == std::string_view::npos) {
+    return std::string::npos;
+  }
+  return pos + 4;
 }
 
 bool MessageParser::ParseHeaders() {
+  // The start line and the headers refer to the header block of the message.
+  std::string_view block = message_->header_block();
+
   std::size_t off = 0;
 
   while (true) {
-    std::string line;
-    if (!GetNextLine(off, &line, false)) {
-      // Can't find a full header line, need more data from next read.
-      break;
-    }
+    std::size_t pos = internal::FindCRLF(block, off);
+    std::string_view line = block.substr(off, pos - off);
 
-    off = off + line.size() + 2;  // +2 for CRLF
+    off = pos + 2;  // +2 for CRLF
 
     if (line.empty()) {
       header_ended_ = true;
@@ -203,7 +290,7 @@ bool MessageParser::ParseHeaders() {
 
     if (!start_line_parsed_) {
       start_line_parsed_ = true;
-      message_->set_start_line(line);
+      message_->set_start_line_view(line);
 
       if (!ParseStartLine(line)) {
         return false;
@@ -215,8 +302,29 @@ bool MessageParser::ParseHeaders() {
     }
   }
 
-  // Remove the data which has just been parsed.
-  pending_data_.erase(0, off);
+  return true;
+}
+
+bool MessageParser::BeginBody() {
+  // Leave sub-classes a chance to do some check before reading the body.
+  // E.g., RequestParser determines data streaming or not from here.
+  if (!OnHeadersEnd()) {
+    return false;
+  }
+
+  // Reject the content known to be too large before any of it is read.
+  if (content_length_parsed_ && content_length_ != kInvalidSize &&
+      !CheckBodySize(content_length_)) {
+    return false;
+  }
+
+  CreateBodyHandler();
+
+  if (body_handler_ == nullptr) {
+    // The only reason to reach here is that it was failed to generate the temp
+    // file for streaming. Normally, it shouldn't happen.
+    return false;
+  }
 
   return true;
 }
@@ -231,13 +339,54 @@ void MessageParser::CreateBodyHandler() {
       body_handler_.reset(file_body_handler);
     }
   } else {
-    body_handler_.reset(new StringBodyHandler{ message_ });
+    auto string_body_handler =
+        dynamic_cast<StringBodyHandler*>(body_handler_.get());
+    if (string_body_handler == nullptr) {
+      string_body_handler = new StringBodyHandler{ message_ };
+      body_handler_.reset(string_body_handler);
+    }
+
+    // The multipart content is parsed into the form parts instead.
+    if (content_length_parsed_ && content_length_ != kInvalidSize &&
+        !content_type_.multipart()) {
+      string_body_handler->Reserve(
+          std::min(content_length_, max_reserve_size_));
+    }
+  }
+}
+
+bool MessageParser::ParseBody(const char* data, std::size_t length,
+                              std::size_t* consumed) {
+  if (chunked_) {
+    if (!ParseContent(data, length)) {
+      return false;
+    }
+    // The data after the last chunk isn't consumed.
+    *consumed = finished_ ? length - chunked_left_ : length;
+    return true;
+  }
+
+  if (content_until_end_) {
+    *consumed = length;
+    return ParseContent(data, length);
+  }
+
+  // The fixed-length content ends at the Content-Length. No Content-Length,
+  // no content.
+  std::size_t left = 0;
+  if (content_length_parsed_ && content_length_ != kInvalidSize) {
+    left = content_length_ - content_parsed_;
   }
+
+  *consumed = std::min(length, left);
+  content_parsed_ += *consumed;
+
+  return ParseContent(data, *consumed);
 }
 
 bool MessageParser::GetNextLine(std::size_t off, std::string* line,
                                 bool erase) {
-  std::size_t pos = pending_data_.find(internal::kCRLF, off);
+  std::size_t pos = internal::FindCRLF(pending_data_, off);
   if (pos == std::string::npos) {
     return false;
   }
@@ -254,39 +403,61 @@ bool MessageParser::GetNextLine(std::size_t off, std::string* line,
   return true;
 }
 
-bool MessageParser::ParseHeaderLine(const std::string& line) {
-  Header header;
-  if (!SplitKV(line, ':', true, &header.first, &header.second)) {
-    LOG_ERRO("Invalid header: %s", line.c_str());
+bool MessageParser::ParseHeaderLine(std::string_view line) {
+  std::string_view key;
+  std::string_view value;
+  if (!SplitKV(line, ':', true, &key, &value)) {
+    LOG_ERRO("Invalid header: %.*s", static_cast<int>(line.size()),
+             line.data());
     return false;
   }
 
-  if (boost::iequals(header.first, headers::kContentLength)) {
-    content_length_parsed_ = true;
+  HeaderId id = GetHeaderId(key);
 
-    std::size_t content_length = kInvalidSize;
-    if (!ToSizeT(header.second, 10, &content_length)) {
-      LOG_ERRO("Invalid content length: %s", header.second.c_str());
-      return false;
-    }
+  if (!CheckHeader(id, value)) {
+    return false;
+  }
+
+  message_->SetHeaderView(id, key, value);
+  return true;
+}
 
-    LOG_INFO("Content length: %u", content_length);
-    content_length_ = content_length;
+bool MessageParser::CheckHeader(HeaderId id, std::string_view value) {
+  switch (id) {
+    case HeaderId::kContentLength: {
+      content_length_parsed_ = true;
 
-  } else if (boost::iequals(header.first, headers::kContentType)) {
-    content_type_.Parse(header.second);
-    if (!content_type_.Valid()) {
-      LOG_ERRO("Invalid content-type header: %s", header.second.c_str());
-      return false;
-    }
-  } else if (boost::iequals(header.first, headers::kTransferEncoding)) {
-    if (header.second == "chunked") {
-      // The content is chunked.
-      chunked_ = true;
+      std::size_t content_length = kInvalidSize;
+      if (!ToSizeT(value, 10, &content_length)) {
+        LOG_ERRO("Invalid content length: %.*s",
+                 static_cast<int>(value.size()), value.data());
+        return false;
+      }
+
+      LOG_INFO("Content length: %u", content_length);
+      content_length_ = content_length;
+      break;
     }
-  }
 
-  message_->SetHeader(std::move(header));
+    case HeaderId::kContentType:
+      content_type_.Parse(value);
+      if (!content_type_.Valid()) {
+        LOG_ERRO("Invalid content-type header: %.*s",
+                 static_cast<int>(value.size()), value.data());
+        return false;
+      }
+      break;
+
+    case HeaderId::kTransferEncoding:
+      if (value == "chunked") {
+        // The content is chunked.
+        chunked_ = true;
+      }
+      break;
+
+    default:
+      break;
+  }
 
   return true;
 }
@@ -300,6 +471,15 @@ bool MessageParser::ParseContent(const char* data, std::size_t length) {
 }
 
 bool MessageParser::ParseFixedContent(const char* data, std::size_t length) {
+  if (content_until_end_) {
+    // The end is told by EndContent().
+    if (!CheckBodySize(length)) {
+      return false;
+    }
+    body_handler_->AddContent(data, length);
+    return true;
+  }
+
   if (!content_length_parsed_) {
     // No Content-Length, no content.
     Finish();
@@ -311,12 +491,6 @@ bool MessageParser::ParseFixedContent(const char* data, std::size_t length) {
     return false;
   }
 
-  if (!pending_data_.empty()) {
-    // This is the data left after the headers are parsed.
-    body_handler_->AddContent(pending_data_);
-    pending_data_.clear();
-  }
-
   // Don't have to firstly put the data to the pending data.
   body_handler_->AddContent(data, length);
 
@@ -329,91 +503,135 @@ bool MessageParser::ParseFixedContent(const char* data, std::size_t length) {
 }
 
 bool MessageParser::ParseChunkedContent(const char* data, std::size_t length) {
-  pending_data_.append(data, length);
+  // The data of the chunks is passed to the body handler right from the data
+  // given, only a line (e.g., the chunk size) split by the reads is kept in
+  // the pending data.
+  std::string_view input{ data, length };
+  std::size_t off = 0;
 
-  while (true) {
-    if (pending_data_.empty()) {
-      // Wait for more data from next read.
-      break;
+  while (off < input.size()) {
+    if (chunk_size_ != kInvalidSize && chunk_size_ > 0) {
+      std::size_t count = std::min(chunk_size_, input.size() - off);
+      body_handler_->AddContent(input.data() + off, count);
+      off += count;
+
+      chunk_size_ -= count;
+      if (chunk_size_ == 0) {
+        // The chunk data is followed by a CRLF.
+        chunk_size_ = kInvalidSize;
+        chunk_data_ended_ = true;
+      }
+      continue;
     }
 
-    // Read chunk-size if necessary.
-    if (chunk_size_ == kInvalidSize) {
-      std::string line;
-      if (!GetNextLine(0, &line, true)) {
-        // Need more data from next read.
-        // Normally, it shouldn't be here since the chunk size line is very
-        // short.
-        break;
+    std::string line;
+    if (!GetChunkLine(input, &off, &line)) {
+      break;  // Need more data from next read.
+    }
+
+    if (chunk_data_ended_) {
+      chunk_data_ended_ = false;
+      if (!line.empty()) {
+        LOG_ERRO("Invalid chunk data, not followed by CRLF");
+        return false;
       }
+      continue;
+    }
 
+    if (chunk_size_ == kInvalidSize) {
       if (!ParseChunkSize(line)) {
         // Invalid chunk size, stop the parsing.
         return false;
       }
 
       LOG_VERB("Chunk size: %u", chunk_size_);
+
+      if (!CheckBodySize(chunk_size_)) {
+        return false;
+      }
+      continue;
     }
 
-    if (chunk_size_ == 0) {
+    // The last chunk is followed by the trailer (ignored) and an empty line.
+    if (line.empty()) {
+      // The data left belongs to the next message.
+      chunked_left_ = input.size() - off;
       Finish();
       return true;
     }
 
-    if (chunk_size_ + 2 <= pending_data_.size()) {  // +2 for CRLF
-      body_handler_->AddContent(pending_data_.c_str(), chunk_size_);
-
-      // Pending data might become empty after erase. See the empty check at the
-      // beginning of the loop.
-      pending_data_.erase(0, chunk_size_ + 2);
-
-      // Reset chunk-size (NOT to 0).
-      chunk_size_ = kInvalidSize;
-
-      // Continue (explicitly) to parse next chunk.
-      continue;
-
-    } else if (chunk_size_ > pending_data_.size()) {
-      body_handler_->AddContent(pending_data_);
-
-      chunk_size_ -= pending_data_.size();
+    LOG_VERB("Chunked trailer: %s", line.c_str());
+  }
 
-      pending_data_.clear();
+  return true;
+}
 
-      // Wait for more data from next read.
-      break;
+bool MessageParser::GetChunkLine(std::string_view data, std::size_t* off,
+                                 std::string* line) {
+  if (pending_data_.empty()) {
+    std::size_t pos = internal::FindCRLF(data, *off);
+    if (pos == std::string_view::npos) {
+      pending_data_.assign(data.data() + *off, data.size() - *off);
+      *off = data.size();
+      return false;
+    }
+    line->assign(data.data() + *off, pos - *off);
+    *off = pos + 2;
+    return true;
+  }
 
-    } else {
-      // Wait for more data from next read.
-      // if (chunk_size_ == pending_data_.size()) {
-      //   <Also wait for CRLF from next read>
-      // }
-      break;
+  // The line is split by the reads, and so might be the CRLF.
+  if (pending_data_.back() == '\r' && data[*off] == '\n') {
+    pending_data_.pop_back();
+    *off += 1;
+  } else {
+    std::size_t pos = internal::FindCRLF(data, *off);
+    if (pos == std::string_view::npos) {
+      pending_data_.append(data.data() + *off, data.size() - *off);
+      *off = data.size();
+      return false;
     }
+    pending_data_.append(data.data() + *off, pos - *off);
+    *off = pos + 2;
   }
 
+  line->swap(pending_data_);
+  pending_data_.clear();
   return true;
 }
 
-bool MessageParser::ParseChunkSize(const std::string& line) {
-  LOG_VERB("Chunk size line: [%s]", line.c_str());
+bool MessageParser::ParseChunkSize(std::string_view line) {
+  LOG_VERB("Chunk size line: [%.*s]", static_cast<int>(line.size()),
+           line.data());
 
-  std::string hex_str;  // e.g., "cf0" (3312)
-  std::size_t pos = line.find(' ');
-  if (pos != std::string::npos) {
-    hex_str = line.substr(0, pos);
-  } else {
-    hex_str = line;
-  }
+  // E.g., "cf0" (3312), maybe followed by the chunk extensions.
+  std::string_view hex_str = line.substr(0, line.find(' '));
 
   if (!ToSizeT(hex_str, 16, &chunk_size_)) {
-    LOG_ERRO("Invalid chunk-size: %s", hex_str.c_str());
+    LOG_ERRO("Invalid chunk-size: %.*s", static_cast<int>(hex_str.size()),
+             hex_str.data());
     return false;
   }
 
   return true;
 }
 
+bool MessageParser::CheckBodySize(std::size_t size) {
+  if (body_limit_ == kInvalidSize) {
+    return true;
+  }
+
+  std::size_t parsed =
+      body_handler_ != nullptr ? body_handler_->GetContentLength() : 0;
+  if (size <= body_limit_ && parsed <= body_limit_ - size) {
+    return true;
+  }
+
+  LOG_WARN("The content exceeds the limit (%u bytes)", body_limit_);
+  body_too_large_ = true;
+  return false;
+}
+
 bool MessageParser::IsFixedContentFull() const {
   assert(content_length_ != kInvalidSize);
   return body_handler_->GetContentLength() >= content_length_;
@@ -47,6 +47,16 @@ public:
 
   ~StringBodyHandler() override = default;
 
+  // Start over for another message, e.g., the next request of a keep-alive
+  // connection.
+  void Reset(Message* message) {
+    message_ = message;
+    content_.clear();
+  }
+
+  // Reserve the memory for the content to be added.
+  void Reserve(std::size_t size);
+
   void AddContent(const char* data, std::size_t length) override;
   void AddContent(const std::string& data) override;
 
@@ -100,6 +110,28 @@ public:
 
   void Init(Message* message);
 
+  // Limit the size of the content, kInvalidSize (by default) for no limit.
+  // The parsing fails as soon as the content is known to exceed it, e.g., by
+  // the Content-Length (see body_too_large()). Kept by Init().
+  void set_max_body_size(std::size_t max_body_size) {
+    max_body_size_ = max_body_size;
+  }
+
+  std::size_t max_body_size() const {
+    return max_body_size_;
+  }
+
+  // Limit the memory reserved for the content by its Content-Length (see
+  // kMaxReserveSize). Kept by Init().
+  void set_max_reserve_size(std::size_t max_reserve_size) {
+    max_reserve_size_ = max_reserve_size;
+  }
+
+  // If the parsing has failed because the content is larger than allowed.
+  bool body_too_large() const {
+    return body_too_large_;
+  }
+
   bool finished() const {
     return finished_;
   }
@@ -134,8 +166,31 @@ public:
   // Return false if the parsing is failed.
   bool Parse(const char* data, std::size_t length);
 
+  // The number of bytes consumed by the last call to Parse().
+  // Less than the given length only if the message has finished and the rest
+  // of the data belongs to the next message (e.g., pipelined requests).
+  std::size_t consumed() const {
+    return consumed_;
+  }
+
+  // Set the start line and the headers which have been parsed in another way,
+  // e.g., decoded from an HTTP/2 header block, instead of Parse().
+  // If `has_content` and there's no Content-Length, the content continues
+  // with Parse() until EndContent() is called.
+  bool SetHeaders(const std::string& start_line, std::vector<Header>&& headers,
+                  bool has_content);
+
+  // Tell the end of the content (e.g., the END_STREAM flag of HTTP/2).
+  // Return false if the content is incomplete, or it can't be finished.
+  bool EndContent();
+
 protected:
-  // Parse headers from pending data.
+  // Find the end of the headers, i.e., the ending empty line, in the data.
+  // Return the length of the headers, or std::string::npos if not found.
+  std::size_t FindHeaderEnd(const char* data, std::size_t length) const;
+
+  // Parse the start line and the headers from the header block of the
+  // message, to which they refer without any copy.
   // Return false only on syntax errors.
   bool ParseHeaders();
 
@@ -143,7 +198,14 @@ protected:
   // Return false if something is wrong.
   virtual bool OnHeadersEnd() = 0;
 
-  void CreateBodyHandler();
+  // Called when the headers have been parsed, to get ready for the body.
+  bool BeginBody();
+
+  virtual void CreateBodyHandler();
+
+  // Parse the data of the content, but not beyond the end of the content.
+  // Save the number of bytes consumed to `consumed`.
+  bool ParseBody(const char* data, std::size_t length, std::size_t* consumed);
 
   // Get next line (using delimiter CRLF) from the pending data.
   // The line will not contain a trailing CRLF.
@@ -151,9 +213,12 @@ protected:
   // from the pending data.
   bool GetNextLine(std::size_t off, std::string* line, bool erase);
 
-  virtual bool ParseStartLine(const std::string& line) = 0;
+  virtual bool ParseStartLine(std::string_view line) = 0;
+
+  bool ParseHeaderLine(std::string_view line);
 
-  bool ParseHeaderLine(const std::string& line);
+  // Check the headers concerning the content.
+  bool CheckHeader(HeaderId id, std::string_view value);
 
   virtual bool ParseContent(const char* data, std::size_t length);
 
@@ -161,7 +226,17 @@ protected:
 
   bool ParseChunkedContent(const char* data, std::size_t length);
 
-  bool ParseChunkSize(const std::string& line);
+  // Get the next line of the chunked content from `off` of the data, or from
+  // the pending data kept by the last read if the line is split by the reads.
+  // Return false and keep the data in the pending data if the line is not
+  // complete yet.
+  bool GetChunkLine(std::string_view data, std::size_t* off,
+                    std::string* line);
+
+  bool ParseChunkSize(std::string_view line);
+
+  // Check if the content still fits in the limit with `size` more.
+  bool CheckBodySize(std::size_t size);
 
   bool IsFixedContentFull() const;
 
@@ -176,12 +251,30 @@ protected:
   // Data streaming or not.
   bool stream_ = false;
 
+  // See set_max_body_size() and set_max_reserve_size().
+  std::size_t max_body_size_ = kInvalidSize;
+  std::size_t max_reserve_size_ = kMaxReserveSize;
+
+  // The limit of the size of the content of this message, the max body size
+  // unless the sub-class knows better (e.g., by the route of the request).
+  std::size_t body_limit_ = kInvalidSize;
+  bool body_too_large_ = false;
+
   // The data to be parsed.
   std::string pending_data_;
 
+  // Where to go on finding the end of the headers in the pending data.
+  std::size_t scan_off_ = 0;
+
   // The length of the headers part.
   std::size_t header_length_ = 0;
 
+  // See consumed().
+  std::size_t consumed_ = 0;
+
+  // The length of the fixed-length content passed to ParseContent() so far.
+  std::size_t content_parsed_ = 0;
+
   // Temporary data and helper flags for parsing.
   std::size_t content_length_ = kInvalidSize;
   ContentType content_type_;
@@ -190,7 +283,14 @@ protected:
   bool header_ended_ = false;
   bool header_just_ended_ = false;
   bool chunked_ = false;
+  // The content has no length and ends as told (see SetHeaders()).
+  bool content_until_end_ = false;
+  // The size of the chunk data not parsed yet.
   std::size_t chunk_size_ = kInvalidSize;
+  // The chunk data has been parsed, and the CRLF after it is expected.
+  bool chunk_data_ended_ = false;
+  // The length of the data left after the last chunk and the trailer.
+  std::size_t chunked_left_ = 0;
   bool finished_ = false;
 };
 
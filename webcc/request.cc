@@ -2,6 +2,17 @@
 
 namespace webcc {
 
+void Request::Clear() {
+  Message::Clear();
+
+  method_.clear();
+  url_.Clear();
+  args_.clear();
+  address_.clear();
+  websocket_upgrade_ = false;
+  canceled_flag_.reset();
+}
+
 bool Request::IsForm() const {
   return std::dynamic_pointer_cast<FormBody>(body_) != nullptr;
 }
@@ -29,7 +40,7 @@ void Request::Prepare() {
     target += url_.query();
   }
 
-  start_line_ = method_ + " " + target + " HTTP/1.1";
+  set_start_line(method_ + " " + target + " HTTP/1.1");
 
   if (url_.port().empty()) {
     SetHeader(headers::kHost, url_.host());
@@ -1,6 +1,7 @@
 #ifndef WEBCC_REQUEST_H_
 #define WEBCC_REQUEST_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -19,6 +20,8 @@ public:
 
   ~Request() override = default;
 
+  void Clear() override;
+
   const std::string& method() const {
     return method_;
   }
@@ -39,6 +42,11 @@ public:
     url_ = std::move(url);
   }
 
+  // Parse the URL string in place of the current URL.
+  void set_url(std::string_view url) {
+    url_.Reset(url);
+  }
+
   const std::string& host() const {
     return url_.host();
   }
@@ -67,6 +75,31 @@ public:
     address_ = address;
   }
 
+  // The flag telling if the request has been canceled.
+  // Used by server only.
+  void set_canceled_flag(std::shared_ptr<const std::atomic_bool> flag) {
+    canceled_flag_ = std::move(flag);
+  }
+
+  // Check if the request has been canceled, i.e., the client has gone away
+  // (closed or reset the connection) while the request is waiting in the
+  // queue or being handled.
+  // A view doing heavy work could poll it and give up early. Nobody will
+  // receive its response anyway.
+  bool IsCanceled() const {
+    return canceled_flag_ && canceled_flag_->load(std::memory_order_relaxed);
+  }
+
+  // Is it the opening handshake of WebSocket, i.e., a GET request asking to
+  // upgrade the connection to WebSocket? Set by the request parser.
+  bool websocket_upgrade() const {
+    return websocket_upgrade_;
+  }
+
+  void set_websocket_upgrade(bool websocket_upgrade) {
+    websocket_upgrade_ = websocket_upgrade;
+  }
+
   // Check if the body is a multi-part form data.
   bool IsForm() const;
 
@@ -88,6 +121,11 @@ private:
 
   // Client IP address.
   std::string address_;
+
+  bool websocket_upgrade_ = false;
+
+  // Set by the connection when the client has gone away.
+  std::shared_ptr<const std::atomic_bool> canceled_flag_;
 };
 
 using RequestPtr = std::shared_ptr<Request>;
@@ -1,10 +1,12 @@
 #include "webcc/request_parser.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "boost/algorithm/string.hpp"
 
-#include "webcc/internal/globals.h"
+#include "webcc/body.h"
+#include "webcc/internal/scan.h"
 #include "webcc/logger.h"
 #include "webcc/request.h"
 #include "webcc/string.h"
@@ -19,36 +21,75 @@ void RequestParser::Init(Request* request, ViewMatcher view_matcher) {
 
   request_ = request;
   view_matcher_ = view_matcher;
+  route_ = nullptr;
 
   step_ = Step::kStart;
   part_.reset();
   form_parts_.clear();
+
+  DiscardPartFile();
+}
+
+RequestParser::~RequestParser() {
+  DiscardPartFile();
 }
 
 bool RequestParser::OnHeadersEnd() {
   // Decode the URL path before match.
-  std::string url_path = Url::DecodeUnsafe(request_->url().path());
-  if (view_matcher_(request_->method(), url_path, &stream_)) {
+  const std::string& path = request_->url().path();
+  url_path_.clear();
+  if (!Url::Decode(path, &url_path_)) {
+    url_path_ = path;
+  }
+  LOG_INFO("Request URL path: %s", url_path_.c_str());
+
+  UrlArgs args;
+  route_ = view_matcher_(request_->method(), url_path_, &args);
+
+  if (route_ != nullptr) {
+    // Save the (regex matched) URL args to the request object.
+    request_->set_args(std::move(args));
+
+    stream_ = route_->view->Stream(request_->method());
     if (stream_) {
       LOG_INFO("The URL path matches a view which askes for data streaming");
     }
+
+    if (route_->max_body_size != kInvalidSize) {
+      body_limit_ = route_->max_body_size;
+    }
   }  // else: Do nothing!
 
+  if (content_type_.multipart()) {
+    delimiter_.Reset("\r\n--" + content_type_.boundary());
+  }
+
+  // The opening handshake of WebSocket (RFC 6455 4.2.1), which the server
+  // answers once the request has been read. The Connection header might have
+  // other options, e.g., "keep-alive, Upgrade".
+  if (request_->method() == methods::kGet &&
+      boost::iequals(request_->GetHeader(HeaderId::kUpgrade), "websocket") &&
+      boost::icontains(
+          std::string{ request_->GetHeader(HeaderId::kConnection) },
+          "upgrade")) {
+    request_->set_websocket_upgrade(true);
+  }
+
   // Always return true, even if no view matches the URL path, so that the
   // request could be fully received.
   return true;
 }
 
-bool RequestParser::ParseStartLine(const std::string& line) {
-  std::vector<std::string_view> parts;
-  Split(line, ' ', true, &parts);
+bool RequestParser::ParseStartLine(std::string_view line) {
+  start_line_parts_.clear();
+  Split(line, ' ', true, &start_line_parts_);
 
-  if (parts.size() != 3) {
+  if (start_line_parts_.size() != 3) {
     return false;
   }
 
-  request_->set_method(parts[0]);
-  request_->set_url(Url{ parts[1] });
+  request_->set_method(start_line_parts_[0]);
+  request_->set_url(start_line_parts_[1]);
 
   // HTTP version is ignored.
 
@@ -65,147 +106,213 @@ bool RequestParser::ParseContent(const char* data, std::size_t length) {
 
 bool RequestParser::ParseMultipartContent(const char* data,
                                           std::size_t length) {
-  pending_data_.append(data, length);
-
   if (!content_length_parsed_ || content_length_ == kInvalidSize) {
     // Invalid Content-Length header (syntax error).
     return false;
   }
 
-  while (true) {
-    if (pending_data_.empty()) {
-      // Wait data from next read.
-      break;
+  // The data is parsed right from the data given, so that the data of a part
+  // is passed on without any copy. The data left by the last read (e.g., part
+  // headers split by the reads, or the end of the data which could be the
+  // start of a delimiter) is parsed first with some of the new data, as much
+  // as needed to get over it.
+  std::size_t used = 0;
+  while (!pending_data_.empty() && used < length && step_ != Step::kEnded) {
+    std::size_t count = length - used;
+    if (step_ == Step::kHeadersParsed) {
+      // Enough to find the delimiter and the two chars after it.
+      count = std::min(count, delimiter_.size() + 2);
+    }
+
+    std::size_t left = pending_data_.size();
+    pending_data_.append(data + used, count);
+    used += count;
+
+    std::size_t off = 0;
+    if (!ParseParts(pending_data_, &off)) {
+      return false;
     }
 
+    if (off >= left) {
+      // The data left has been parsed, go on with the new data.
+      used -= pending_data_.size() - off;
+      pending_data_.clear();
+    } else {
+      pending_data_.erase(0, off);
+    }
+  }
+
+  if (pending_data_.empty() && used < length && step_ != Step::kEnded) {
+    std::size_t off = used;
+    if (!ParseParts(std::string_view{ data, length }, &off)) {
+      return false;
+    }
+    pending_data_.assign(data + off, length - off);
+  }
+
+  if (step_ == Step::kEnded) {
+    // The epilogue, if any, is ignored. But it's consumed up to the
+    // Content-Length, so that the rest of it (e.g., the CRLF after the close
+    // boundary, in a later read) isn't taken as the next pipelined request.
+    pending_data_.clear();
+
+    if (content_parsed_ < content_length_) {
+      return true;
+    }
+
+    LOG_INFO("Multipart data has ended");
+
+    // Create a body and set to the request.
+
+    auto body = std::make_shared<FormBody>(form_parts_,
+                                           content_type_.boundary());
+
+    request_->SetBody(body, false);  // TODO: set_length?
+
+    Finish();
+  }
+
+  return true;
+}
+
+bool RequestParser::ParseParts(std::string_view data, std::size_t* off) {
+  while (step_ != Step::kEnded) {
     if (step_ == Step::kStart) {
-      std::string line;
-      if (!GetNextLine(0, &line, true)) {
+      std::size_t pos = internal::FindCRLF(data, *off);
+      if (pos == std::string_view::npos) {
         break;  // Not enough data
       }
-      if (!IsBoundary(line, 0, line.size())) {
-        LOG_ERRO("Invalid boundary: %s", line.c_str());
+
+      std::string_view line = data.substr(*off, pos - *off);
+      bool ended = false;
+      if (!IsBoundary(line, &ended) || ended) {
+        LOG_ERRO("Invalid boundary: %.*s", static_cast<int>(line.size()),
+                 line.data());
         return false;
       }
-      LOG_INFO("Boundary line: %s", line.c_str());
+      LOG_INFO("Boundary line: %.*s", static_cast<int>(line.size()),
+               line.data());
+
+      *off = pos + 2;
+      scan_off_ = 0;
+
       // Go to next step.
       step_ = Step::kBoundaryParsed;
       continue;
     }
 
     if (step_ == Step::kBoundaryParsed) {
-      if (part_ == nullptr) {
-        part_.reset(new FormPart{});
-      }
-      bool need_more_data = false;
-      if (ParsePartHeaders(&need_more_data)) {
-        // Go to next step.
-        step_ = Step::kHeadersParsed;
-        LOG_INFO("Part headers just ended");
-        continue;
+      std::string_view rest = data.substr(*off);
+
+      // The headers end with an empty line, or there's just the empty line.
+      std::size_t end = std::string_view::npos;
+      if (boost::starts_with(rest, "\r\n")) {
+        end = 2;
       } else {
-        if (need_more_data) {
-          // Need more data from next read.
-          break;
-        } else {
-          return false;
+        std::size_t pos = internal::Find(rest, "\r\n\r\n", scan_off_);
+        if (pos != std::string_view::npos) {
+          end = pos + 4;
         }
       }
-    }
 
-    if (step_ == Step::kHeadersParsed) {
-      // TODO: Remember last CRLF position.
-
-      std::size_t off = 0;
-      std::size_t count = 0;
-      bool ended = false;
-      if (!GetNextBoundaryLine(&off, &count, &ended)) {
-        break;
+      if (end == std::string_view::npos) {
+        // Go on from where the ending empty line could start.
+        scan_off_ = rest.size() < 3 ? 0 : rest.size() - 3;
+        break;  // Need more data from next read.
       }
 
-      // Next boundary found.
-      LOG_INFO("Next boundary found, off=%u", off);
-
-      // This part has ended.
-      if (off >= 2) {
-        // -2 for excluding the CRLF after the data.
-        part_->AppendData(pending_data_.data(), off - 2);
+      part_ = std::make_shared<FormPart>();
+      if (!ParsePartHeaders(rest.substr(0, end))) {
+        return false;
+      }
+      LOG_INFO("Part headers just ended");
 
-        // Erase the data of this part and the next boundary.
-        // +2 for including the CRLF after the boundary.
-        pending_data_.erase(0, off + count + 2);
-      } else {
-        LOG_ERRO("Invalid part data, off=%u", off);
+      if (!part_->file_name().empty() && !OpenPartFile()) {
         return false;
       }
 
-      // Save this part
-      form_parts_.push_back(part_);
+      *off += end;
 
-      // Reset for next part.
-      part_.reset();
+      // Go to next step.
+      step_ = Step::kHeadersParsed;
+      continue;
+    }
 
-      if (ended) {
-        // Go to the end step.
-        step_ = Step::kEnded;
+    if (step_ == Step::kHeadersParsed) {
+      std::size_t pos = delimiter_.Find(data, *off);
+      if (pos == std::string_view::npos) {
+        // The data of this part goes on, except the end which could be the
+        // start of the delimiter.
+        std::size_t keep = std::min(data.size() - *off, delimiter_.size() - 1);
+        std::size_t count = data.size() - *off - keep;
+        AppendPartData(data.data() + *off, count);
+        *off += count;
         break;
-      } else {
-        // Go to next step.
-        step_ = Step::kBoundaryParsed;
-        continue;
       }
-    }
-  }
 
-  if (step_ == Step::kEnded) {
-    LOG_INFO("Multipart data has ended");
+      AppendPartData(data.data() + *off, pos - *off);
+      *off = pos;
 
-    // Create a body and set to the request.
+      // The delimiter is followed by "--" for the close boundary, or CRLF.
+      std::size_t next = pos + delimiter_.size();
+      if (data.size() < next + 2) {
+        break;  // Need more data from next read.
+      }
 
-    auto body = std::make_shared<FormBody>(form_parts_,
-                                           content_type_.boundary());
+      bool ended = data.compare(next, 2, "--") == 0;
+      if (!ended && data.compare(next, 2, "\r\n") != 0) {
+        LOG_ERRO("Invalid boundary after the part data");
+        return false;
+      }
 
-    request_->SetBody(body, false);  // TODO: set_length?
+      // This part has ended.
+      LOG_INFO("Next boundary found, off=%u", pos);
+      if (!EndPart()) {
+        return false;
+      }
 
-    Finish();
+      *off = next + 2;
+      scan_off_ = 0;
+
+      // Go to next step.
+      step_ = ended ? Step::kEnded : Step::kBoundaryParsed;
+    }
   }
 
   return true;
 }
 
-bool RequestParser::ParsePartHeaders(bool* need_more_data) {
+bool RequestParser::ParsePartHeaders(std::string_view block) {
   std::size_t off = 0;
 
   while (true) {
-    std::string line;
-    if (!GetNextLine(off, &line, false)) {
-      // Need more data from next read.
-      *need_more_data = true;
-      return false;
-    }
+    std::size_t pos = internal::FindCRLF(block, off);
+    std::string_view line = block.substr(off, pos - off);
 
-    off = off + line.size() + 2;  // +2 for CRLF
+    off = pos + 2;  // +2 for CRLF
 
     if (line.empty()) {
       // Headers finished.
       break;
     }
 
-    Header header;
-    if (!SplitKV(line, ':', true, &header.first, &header.second)) {
-      LOG_ERRO("Invalid part header line: %s", line.c_str());
+    std::string_view key;
+    std::string_view value;
+    if (!SplitKV(line, ':', true, &key, &value)) {
+      LOG_ERRO("Invalid part header line: %.*s", static_cast<int>(line.size()),
+               line.data());
       return false;
     }
 
-    LOG_INFO("Part header (%s: %s)", header.first.c_str(),
-             header.second.c_str());
+    LOG_INFO("Part header (%.*s: %.*s)", static_cast<int>(key.size()),
+             key.data(), static_cast<int>(value.size()), value.data());
 
     // Parse Content-Disposition.
-    if (boost::iequals(header.first, headers::kContentDisposition)) {
-      ContentDisposition content_disposition{ header.second };
+    if (GetHeaderId(key) == HeaderId::kContentDisposition) {
+      ContentDisposition content_disposition{ value };
       if (!content_disposition.valid()) {
-        LOG_ERRO("Invalid content-disposition header: %s",
-                 header.second.c_str());
+        LOG_ERRO("Invalid content-disposition header: %.*s",
+                 static_cast<int>(value.size()), value.data());
         return false;
       }
       part_->set_name(content_disposition.name());
@@ -217,62 +324,85 @@ bool RequestParser::ParsePartHeaders(bool* need_more_data) {
     // TODO: Parse other headers.
   }
 
-  // Remove the data which has just been parsed.
-  pending_data_.erase(0, off);
+  return true;
+}
+
+bool RequestParser::OpenPartFile() {
+  if (!utility::OpenTempFile(&part_file_, &part_path_)) {
+    LOG_ERRO("Failed to open a temp file for the part: %s",
+             part_path_.string().c_str());
+    return false;
+  }
 
+  LOG_VERB("Stream the file part to: %s", part_path_.string().c_str());
   return true;
 }
 
-bool RequestParser::GetNextBoundaryLine(std::size_t* b_off,
-                                        std::size_t* b_count, bool* ended) {
-  std::size_t off = 0;
+void RequestParser::AppendPartData(const char* data, std::size_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (part_file_.is_open()) {
+    part_file_.write(data, count);
+  } else {
+    part_->AppendData(data, count);
+  }
+}
 
-  while (true) {
-    std::size_t pos = pending_data_.find(internal::kCRLF, off);
-    if (pos == std::string::npos) {
-      break;
-    }
+void RequestParser::DiscardPartFile() {
+  // The request has failed or been abandoned in the middle of a file part.
+  if (part_file_.is_open()) {
+    part_file_.close();
 
-    std::size_t count = pos - off;
-    if (count == 0) {
-      off = pos + 2;
-      continue;  // Empty line
-    }
+    std::error_code ec;
+    sfs::remove(part_path_, ec);
+  }
+}
 
-    if (IsBoundary(pending_data_, off, count, ended)) {
-      *b_off = off;
-      *b_count = count;
-      return true;
-    }
+bool RequestParser::EndPart() {
+  if (part_file_.is_open()) {
+    part_file_.close();
+
+    // The temp file is deleted with the body.
+    part_->set_file_body(std::make_shared<FileBody>(part_path_, true));
 
-    off = pos + 2;
+    if (part_file_.fail()) {
+      LOG_ERRO("Failed to write the temp file: %s",
+               part_path_.string().c_str());
+      return false;
+    }
   }
 
-  return false;
+  // Save this part
+  form_parts_.push_back(part_);
+
+  // Reset for next part.
+  part_.reset();
+
+  return true;
 }
 
-bool RequestParser::IsBoundary(const std::string& str, std::size_t off,
-                               std::size_t count, bool* end) const {
+bool RequestParser::IsBoundary(std::string_view line, bool* end) const {
   const std::string& boundary = content_type_.boundary();
 
-  if (count != boundary.size() + 2 && count != boundary.size() + 4) {
+  if (line.size() != boundary.size() + 2 &&
+      line.size() != boundary.size() + 4) {
     return false;
   }
 
-  if (str[off] != '-' || str[off + 1] != '-') {
+  if (!boost::starts_with(line, "--") ||
+      line.compare(2, boundary.size(), boundary) != 0) {
     return false;
   }
 
-  if (count == boundary.size() + 4) {
-    if (str[off + count - 1] != '-' || str[off + count - 2] != '-') {
+  if (line.size() == boundary.size() + 4) {
+    if (!boost::ends_with(line, "--")) {
       return false;
     }
-    if (end != nullptr) {
-      *end = true;
-    }
+    *end = true;
   }
 
-  return std::strncmp(boundary.c_str(), &str[off + 2], boundary.size()) == 0;
+  return true;
 }
 
 }  // namespace webcc
@@ -1,16 +1,21 @@
 #ifndef WEBCC_REQUEST_PARSER_H_
 #define WEBCC_REQUEST_PARSER_H_
 
+#include <fstream>
 #include <functional>
 #include <string>
+#include <vector>
 
+#include "webcc/internal/scan.h"
 #include "webcc/message_parser.h"
+#include "webcc/router.h"
 
 namespace webcc {
 
-// Parameters: http_method, url_path, [out]stream
-using ViewMatcher =
-    std::function<bool(const std::string&, const std::string&, bool*)>;
+// Parameters: http_method, url_path, [out]args
+// Return the route of the matched view, or null if no view matches.
+using ViewMatcher = std::function<const RouteInfo*(
+    const std::string&, const std::string&, UrlArgs*)>;
 
 class Request;
 
@@ -18,16 +23,27 @@ class RequestParser : public MessageParser {
 public:
   RequestParser() = default;
 
-  ~RequestParser() override = default;
+  ~RequestParser() override;
 
   void Init(Request* request, ViewMatcher view_matcher);
 
+  // The route matched once the headers have been parsed.
+  // Null if no view matches the URL path.
+  const RouteInfo* route() const {
+    return route_;
+  }
+
+  // The view of the matched route.
+  ViewPtr view() const {
+    return route_ != nullptr ? route_->view : ViewPtr{};
+  }
+
 private:
   // Override to match the URL against views and check if the matched view asks
   // for data streaming.
   bool OnHeadersEnd() override;
 
-  bool ParseStartLine(const std::string& line) override;
+  bool ParseStartLine(std::string_view line) override;
 
   // Override to handle multipart form data which is request only.
   bool ParseContent(const char* data, std::size_t length) override;
@@ -35,14 +51,28 @@ private:
   // Multipart specific parsing helpers.
 
   bool ParseMultipartContent(const char* data, std::size_t length);
-  bool ParsePartHeaders(bool* need_more_data);
 
-  bool GetNextBoundaryLine(std::size_t* b_off, std::size_t* b_count,
-                           bool* ended);
+  // Parse the parts from `off` of the data, as far as the data goes.
+  // Update `off` to where the data not parsed yet starts.
+  bool ParseParts(std::string_view data, std::size_t* off);
+
+  // Parse the part headers, i.e., the given lines ending with an empty line.
+  bool ParsePartHeaders(std::string_view block);
+
+  // Open a temp file for the data of a file part.
+  bool OpenPartFile();
+
+  void AppendPartData(const char* data, std::size_t count);
+
+  // Close and remove the temp file of the current part, if any.
+  void DiscardPartFile();
 
-  // Check if the str.substr(off, count) is a boundary.
-  bool IsBoundary(const std::string& str, std::size_t off,
-                  std::size_t count, bool* end = nullptr) const;
+  // The delimiter after the data of the part has been found.
+  bool EndPart();
+
+  // Check if the line is a boundary, e.g., "--xyz", or the close boundary,
+  // e.g., "--xyz--", of which `end` tells.
+  bool IsBoundary(std::string_view line, bool* end) const;
 
 private:
   // The result request message.
@@ -52,6 +82,14 @@ private:
   // received. The parsing will stop and fail if no view can be matched.
   ViewMatcher view_matcher_;
 
+  // The matched route.
+  const RouteInfo* route_ = nullptr;
+
+  // The parts of the start line and the decoded URL path, kept to reuse the
+  // memory for the next request.
+  std::vector<std::string_view> start_line_parts_;
+  std::string url_path_;
+
   // Form data parsing steps.
   enum class Step {
     kStart,
@@ -61,9 +99,18 @@ private:
   };
   Step step_ = Step::kStart;
 
+  // The delimiter before each boundary but the first, i.e., CRLF "--" and
+  // the boundary, searched for in the data of the parts.
+  internal::Searcher delimiter_;
+
   // The current form part being parsed.
   FormPartPtr part_;
 
+  // The temp file to which the data of the current part is streamed, if it's
+  // a file part.
+  std::ofstream part_file_;
+  sfs::path part_path_;
+
   // All form parts parsed.
   std::vector<FormPartPtr> form_parts_;
 };
@@ -1,5 +1,8 @@
 #include "webcc/response.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "webcc/utility.h"
 
 namespace webcc {
@@ -7,13 +10,17 @@ namespace webcc {
 using namespace status_codes;
 
 static const std::pair<int, const char*> kTable[] = {
+  { kSwitchingProtocols, "Switching Protocols" },
   { kOK, "OK" },
   { kCreated, "Created" },
   { kAccepted, "Accepted" },
   { kNoContent, "No Content" },
   { kNotModified, "Not Modified" },
   { kBadRequest, "Bad Request" },
+  { kForbidden, "Forbidden" },
   { kNotFound, "Not Found" },
+  { kPayloadTooLarge, "Payload Too Large" },
+  { kUpgradeRequired, "Upgrade Required" },
   { kInternalServerError, "Internal Server Error" },
   { kNotImplemented, "Not Implemented" },
   { kServiceUnavailable, "Service Unavailable" },
@@ -28,22 +35,58 @@ static const char* GetReason(int status) {
   return "";
 }
 
+// Get the start line of a status in the table, e.g., "HTTP/1.1 200 OK".
+// Return null if the status is not in the table.
+static const std::string* GetStartLine(int status) {
+  static const std::vector<std::string> s_start_lines = [] {
+    std::vector<std::string> start_lines;
+    for (auto& pair : kTable) {
+      start_lines.push_back("HTTP/1.1 " + std::to_string(pair.first) + " " +
+                            pair.second);
+    }
+    return start_lines;
+  }();
+
+  for (std::size_t i = 0; i < s_start_lines.size(); ++i) {
+    if (kTable[i].first == status) {
+      return &s_start_lines[i];
+    }
+  }
+  return nullptr;
+}
+
+void Response::SetDate() {
+  std::string_view date = utility::CurrentHttpDate();
+  std::copy(date.begin(), date.end(), date_);
+  SetHeaderView(HeaderId::kDate, headers::kDate,
+                std::string_view{ date_, sizeof(date_) });
+}
+
 void Response::Prepare() {
   if (!start_line_.empty()) {
     return;
   }
 
-  start_line_ = "HTTP/1.1 ";
-  start_line_ += std::to_string(status_);
-  start_line_ += " ";
+  const std::string* start_line =
+      reason_.empty() ? GetStartLine(status_) : nullptr;
 
-  if (reason_.empty()) {
-    start_line_ += GetReason(status_);
+  if (start_line != nullptr) {
+    set_start_line_view(*start_line);
   } else {
-    start_line_ += reason_;
+    start_line_data_ = "HTTP/1.1 ";
+    start_line_data_ += std::to_string(status_);
+    start_line_data_ += " ";
+
+    if (reason_.empty()) {
+      start_line_data_ += GetReason(status_);
+    } else {
+      start_line_data_ += reason_;
+    }
+
+    start_line_ = start_line_data_;
   }
 
-  SetHeader(headers::kServer, utility::UserAgent());
+  SetHeaderView(HeaderId::kServer, headers::kServer, utility::UserAgent());
 }
 
 }  // namespace webcc
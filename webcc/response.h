@@ -5,6 +5,7 @@
 #include <string>
 
 #include "webcc/message.h"
+#include "webcc/utility.h"
 
 namespace webcc {
 
@@ -31,11 +32,19 @@ public:
     reason_ = reason;
   }
 
+  // Set the Date header to the current date (see utility::CurrentHttpDate()),
+  // kept by the response itself instead of a copy in the headers.
+  void SetDate();
+
+  // The start line of a well-known status is built only once and shared by
+  // the responses, unless a reason phrase has been set.
   void Prepare() override;
 
 private:
   int status_;  // Status code
   std::string reason_;  // Reason phrase
+
+  char date_[utility::kHttpDateSize];
 };
 
 using ResponsePtr = std::shared_ptr<Response>;
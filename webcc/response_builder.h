@@ -1,6 +1,7 @@
 #ifndef WEBCC_RESPONSE_BUILDER_H_
 #define WEBCC_RESPONSE_BUILDER_H_
 
+#include "webcc/event_stream.h"
 #include "webcc/message_builder.h"
 #include "webcc/request.h"
 #include "webcc/response.h"
@@ -55,6 +56,13 @@ public:
     return Code(status_codes::kServiceUnavailable);
   }
 
+  // Respond with a stream of server-sent events, see EventStream.
+  ResponseBuilder& Events(EventStreamPtr events) {
+    body_.reset(new EventStreamBody{ events });
+    media_type_ = media_types::kTextEventStream;
+    return Header(headers::kCacheControl, "no-cache");
+  }
+
 private:
   RequestPtr request_;  // Optional
 
@@ -4,6 +4,7 @@
 
 #include "webcc/logger.h"
 #include "webcc/response.h"
+#include "webcc/string.h"
 
 namespace webcc {
 
@@ -12,14 +13,14 @@ namespace webcc {
 // Split HTTP response status line to three parts.
 // Don't use the general split function because the reason part might also
 // contain spaces.
-static void SplitStatusLine(const std::string& line,
-                            std::vector<std::string>* parts) {
+static void SplitStatusLine(std::string_view line,
+                            std::vector<std::string_view>* parts) {
   std::size_t off = 0;
   std::size_t pos = 0;
 
   for (std::size_t i = 0; i < 2; ++i) {
     pos = line.find(' ', off);
-    if (pos == std::string::npos) {
+    if (pos == std::string_view::npos) {
       break;
     }
 
@@ -46,26 +47,30 @@ void ResponseParser::Init(Response* response, bool stream) {
   stream_ = stream;
 }
 
-bool ResponseParser::ParseStartLine(const std::string& line) {
-  std::vector<std::string> parts;
+bool ResponseParser::ParseStartLine(std::string_view line) {
+  std::vector<std::string_view> parts;
   SplitStatusLine(line, &parts);
 
   if (parts.size() < 2) {
-    LOG_ERRO("Invalid HTTP response status line: %s", line.c_str());
+    LOG_ERRO("Invalid HTTP response status line: %.*s",
+             static_cast<int>(line.size()), line.data());
     return false;
   }
 
-  if (!boost::starts_with(parts[0], "HTTP/1.")) {
-    LOG_ERRO("Invalid HTTP version: %s", parts[0].c_str());
+  // "HTTP/2" is given by the HTTP/2 client (see Http2Client).
+  if (!boost::starts_with(parts[0], "HTTP/1.") && parts[0] != "HTTP/2") {
+    LOG_ERRO("Invalid HTTP version: %.*s", static_cast<int>(parts[0].size()),
+             parts[0].data());
     return false;
   }
 
-  try {
-    response_->set_status(std::stoi(parts[1]));
-  } catch (const std::exception&) {
-    LOG_ERRO("Invalid HTTP status code: %s", parts[1].c_str());
+  std::size_t status = 0;
+  if (!ToSizeT(parts[1], 10, &status)) {
+    LOG_ERRO("Invalid HTTP status code: %.*s",
+             static_cast<int>(parts[1].size()), parts[1].data());
     return false;
   }
+  response_->set_status(static_cast<int>(status));
 
   if (parts.size() > 2) {
     response_->set_reason(parts[2]);
@@ -26,7 +26,7 @@ private:
   }
 
   // Parse HTTP start line; E.g., "HTTP/1.1 200 OK".
-  bool ParseStartLine(const std::string& line) override;
+  bool ParseStartLine(std::string_view line) override;
 
   // Override to allow to ignore the body of the response for HEAD request.
   bool ParseContent(const char* data, std::size_t length) override;
@@ -0,0 +1,245 @@
+#ifndef WEBCC_RING_QUEUE_H_
+#define WEBCC_RING_QUEUE_H_
+
+// A bounded multi-producer multi-consumer queue based on a ring buffer.
+// Push and pop are lock-free (Dmitry Vyukov's algorithm); a mutex and a
+// condition variable are used only to park the consumers which have nothing
+// to pop after spinning for a while.
+// See: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace webcc {
+
+template <typename T>
+class RingQueue {
+public:
+  // The capacity will be rounded up to a power of 2.
+  explicit RingQueue(std::size_t capacity = 1024) {
+    Allocate(capacity);
+  }
+
+  RingQueue(const RingQueue&) = delete;
+  RingQueue& operator=(const RingQueue&) = delete;
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  // Reallocate the ring buffer with a new capacity.
+  // Pending messages are dropped.
+  // NOTE: Not thread safe, call it only when the queue is not in use.
+  void Reset(std::size_t capacity) {
+    Allocate(capacity);
+  }
+
+  // Pop a message, spin for a while and then wait if the queue is empty.
+  T PopOrWait() {
+    T message{};
+
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (TryPop(&message)) {
+        return message;
+      }
+      std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    sleepers_.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in WakeOne(), so that either this thread sees the
+    // message just pushed, or the producer sees this sleeper.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (!TryPop(&message)) {
+      not_empty_cv_.wait(lock);
+    }
+
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+    return message;
+  }
+
+  // Pop a message, spin for a while and then wait for at most `timeout` if the
+  // queue is empty. Return false on timeout.
+  template <typename Rep, typename Period>
+  bool PopOrWaitFor(T* message,
+                    const std::chrono::duration<Rep, Period>& timeout) {
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (TryPop(message)) {
+        return true;
+      }
+      std::this_thread::yield();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    sleepers_.fetch_add(1, std::memory_order_relaxed);
+    // See PopOrWait().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool popped = true;
+    while (!TryPop(message)) {
+      if (not_empty_cv_.wait_until(lock, deadline) ==
+          std::cv_status::timeout) {
+        popped = TryPop(message);
+        break;
+      }
+    }
+
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+    return popped;
+  }
+
+  // Pop a message, return a default constructed one if the queue is empty.
+  T Pop() {
+    T message{};
+    TryPop(&message);
+    return message;
+  }
+
+  bool TryPop(T* message) {
+    Cell* cell = nullptr;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+    while (true) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    *message = std::move(cell->message);
+
+    // Don't hold the message (e.g., a shared_ptr) any longer in the cell.
+    cell->message = T();
+
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  void Clear() {
+    T message{};
+    while (TryPop(&message)) {
+    }
+  }
+
+  // Push a message, yield until there's a free slot if the queue is full.
+  void Push(const T& message) {
+    while (!TryPush(message)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Push a message, return false if the queue is full.
+  bool TryPush(const T& message) {
+    Cell* cell = nullptr;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+    while (true) {
+      cell = &cells_[pos & mask_];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->message = message;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    WakeOne();
+    return true;
+  }
+
+  // The number of messages in the queue.
+  // Only an estimate when other threads are pushing or popping.
+  std::size_t Size() const {
+    std::size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    std::size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T message{};
+  };
+
+  // The number of tries to pop before a consumer is parked.
+  static constexpr int kSpinCount = 64;
+
+  void Allocate(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    cells_.reset(new Cell[size]);
+    mask_ = size - 1;
+
+    for (std::size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  // Wake up a parked consumer, if any.
+  void WakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleepers_.load(std::memory_order_relaxed) > 0) {
+      // Lock to make sure the consumer is either waiting or hasn't checked the
+      // queue yet.
+      { std::lock_guard<std::mutex> lock(mutex_); }
+      not_empty_cv_.notify_one();
+    }
+  }
+
+private:
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+
+  // Keep the positions in different cache lines to avoid false sharing
+  // between the producers and the consumers.
+  alignas(64) std::atomic<std::size_t> enqueue_pos_{ 0 };
+  alignas(64) std::atomic<std::size_t> dequeue_pos_{ 0 };
+
+  alignas(64) std::atomic<int> sleepers_{ 0 };
+  std::mutex mutex_;
+  std::condition_variable not_empty_cv_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_RING_QUEUE_H_
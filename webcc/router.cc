@@ -9,20 +9,24 @@
 namespace webcc {
 
 bool Router::Route(std::string_view url, ViewPtr view,
-                   std::vector<std::string>&& methods) {
+                   std::vector<std::string>&& methods,
+                   const std::string& executor, std::size_t max_body_size) {
   assert(view != nullptr);
 
-  routes_.emplace_back(url, view, std::move(methods));
+  routes_.emplace_back(url, view, std::move(methods), executor,
+                       max_body_size);
 
   return true;
 }
 
 bool Router::Route(const UrlRegex& regex_url, ViewPtr view,
-                   std::vector<std::string>&& methods) {
+                   std::vector<std::string>&& methods,
+                   const std::string& executor, std::size_t max_body_size) {
   assert(view != nullptr);
 
   try {
-    routes_.emplace_back(regex_url(), view, std::move(methods));
+    routes_.emplace_back(regex_url(), view, std::move(methods), executor,
+                         max_body_size);
 
   } catch (const std::regex_error& e) {
     LOG_ERRO("Not a valid regular expression: %s", e.what());
@@ -34,6 +38,23 @@ bool Router::Route(const UrlRegex& regex_url, ViewPtr view,
 
 ViewPtr Router::FindView(const std::string& method, const std::string& url_path,
                          UrlArgs* args) {
+  const RouteInfo* route = FindRoute(method, url_path, args);
+  return route != nullptr ? route->view : ViewPtr{};
+}
+
+bool Router::MatchView(const std::string& method, const std::string& url_path,
+                       bool* stream) {
+  assert(stream != nullptr);
+
+  UrlArgs args;
+  const RouteInfo* route = FindRoute(method, url_path, &args);
+  *stream = route != nullptr && route->view->Stream(method);
+  return route != nullptr;
+}
+
+const RouteInfo* Router::FindRoute(const std::string& method,
+                                   const std::string& url_path,
+                                   UrlArgs* args) {
   assert(args != nullptr);
 
   for (auto& route : routes_) {
@@ -50,44 +71,16 @@ ViewPtr Router::FindView(const std::string& method, const std::string& url_path,
         for (std::size_t i = 1; i < match.size(); ++i) {
           args->push_back(match[i].str());
         }
-        return route.view;
-      }
-    } else {
-      if (boost::iequals(route.url, url_path)) {
-        return route.view;
-      }
-    }
-  }
-
-  return {};
-}
-
-bool Router::MatchView(const std::string& method, const std::string& url_path,
-                       bool* stream) {
-  assert(stream != nullptr);
-  *stream = false;
-
-  for (auto& route : routes_) {
-    if (std::find(route.methods.begin(), route.methods.end(), method) ==
-        route.methods.end()) {
-      continue;
-    }
-
-    if (route.url.empty()) {
-      std::smatch match;
-      if (std::regex_match(url_path, match, route.url_regex)) {
-        *stream = route.view->Stream(method);
-        return true;
+        return &route;
       }
     } else {
       if (boost::iequals(route.url, url_path)) {
-        *stream = route.view->Stream(method);
-        return true;
+        return &route;
       }
     }
   }
 
-  return false;
+  return nullptr;
 }
 
 }  // namespace webcc
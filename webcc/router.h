@@ -11,21 +11,37 @@ namespace webcc {
 
 struct RouteInfo {
   RouteInfo(std::string_view _url, ViewPtr _view,
-            std::vector<std::string>&& _methods)
-      : url(_url), view(_view), methods(std::move(_methods)) {
+            std::vector<std::string>&& _methods, const std::string& _executor,
+            std::size_t _max_body_size)
+      : url(_url),
+        view(_view),
+        methods(std::move(_methods)),
+        executor(_executor),
+        max_body_size(_max_body_size) {
   }
 
   RouteInfo(std::regex&& _url_regex, ViewPtr _view,
-            std::vector<std::string>&& _methods)
+            std::vector<std::string>&& _methods, const std::string& _executor,
+            std::size_t _max_body_size)
       : url_regex(std::move(_url_regex)),
         view(_view),
-        methods(std::move(_methods)) {
+        methods(std::move(_methods)),
+        executor(_executor),
+        max_body_size(_max_body_size) {
   }
 
   std::string url;
   std::regex url_regex;
   ViewPtr view;
   std::vector<std::string> methods;
+
+  // The name of the executor to handle the requests of this route.
+  // Empty for the default one.
+  std::string executor;
+
+  // The max size of the request body, instead of the server's.
+  // kInvalidSize to follow the server (see Server::set_max_body_size()).
+  std::size_t max_body_size = kInvalidSize;
 };
 
 class Router {
@@ -34,17 +50,31 @@ public:
 
   // Route a URL to a view.
   // The URL should start with "/". E.g., "/instances".
+  // The requests will be handled by the workers of the named `executor`, or
+  // the default workers if it's empty (see Server::AddExecutor()).
+  // The requests with a body larger than `max_body_size`, if given, are
+  // answered with Payload Too Large (413), whatever the server allows (see
+  // Server::set_max_body_size()).
   bool Route(std::string_view url, ViewPtr view,
-             std::vector<std::string>&& methods = { "GET" });
+             std::vector<std::string>&& methods = { "GET" },
+             const std::string& executor = "",
+             std::size_t max_body_size = kInvalidSize);
 
   // Route a URL (as regular expression) to a view.
   // The URL should start with "/" and be a regular expression.
   // E.g., "/instances/(\\d+)".
   bool Route(const UrlRegex& regex_url, ViewPtr view,
-             std::vector<std::string>&& methods = { "GET" });
+             std::vector<std::string>&& methods = { "GET" },
+             const std::string& executor = "",
+             std::size_t max_body_size = kInvalidSize);
 
-  // Find the view by HTTP method and URL path.
+  // Find the route by HTTP method and URL path.
   // The `url_path` has already been decoded and is UTF8 encoded by itself.
+  // NOTE: The route returned is valid until more routes are added.
+  const RouteInfo* FindRoute(const std::string& method,
+                             const std::string& url_path, UrlArgs* args);
+
+  // Find the view by HTTP method and URL path.
   ViewPtr FindView(const std::string& method, const std::string& url_path,
                    UrlArgs* args);
 
@@ -5,13 +5,22 @@
 #include <utility>
 
 #include "boost/algorithm/string.hpp"
+#include "boost/asio/post.hpp"
 
 #include "webcc/body.h"
+#include "webcc/config.h"
 #include "webcc/logger.h"
 #include "webcc/request.h"
 #include "webcc/response.h"
 #include "webcc/string.h"
 #include "webcc/utility.h"
+#include "webcc/websocket.h"
+
+#if WEBCC_ENABLE_COROUTINE
+#include "boost/asio/co_spawn.hpp"
+
+#include "webcc/coroutine_view.h"
+#endif  // WEBCC_ENABLE_COROUTINE
 
 using namespace std::placeholders;
 using tcp = boost::asio::ip::tcp;
@@ -28,51 +37,80 @@ namespace webcc {
 //     acceptor_(strand_)
 // The same applies to the sockets.
 
+#if defined(SO_REUSEPORT)
+// Asio doesn't provide SO_REUSEPORT as a standard socket option.
+using ReusePort =
+    boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
 Server::Server(boost::asio::ip::tcp protocol, std::uint16_t port,
                const sfs::path& doc_root)
     : protocol_(protocol),
       port_(port),
       doc_root_(doc_root),
-      acceptor_(io_context_),
-      signals_(io_context_) {
+      shards_(1),
+      signals_(shards_.front().io_context) {
   CheckDocRoot();
   AddSignals();
 }
 
 void Server::Run(std::size_t workers, std::size_t loops) {
   assert(workers > 0);
+  assert(loops > 0);
 
 #if WEBCC_STUDY_SERVER_THREADING
   LOG_USER("Run(workers:%u, loops:%u)", workers, loops);
 #endif
 
+  bool sharded = sharded_ && loops > 1;
+
+#if !defined(SO_REUSEPORT)
+  if (sharded) {
+    LOG_WARN("SO_REUSEPORT is not supported, fall back to the normal mode");
+    sharded = false;
+  }
+#endif
+
   {
     std::lock_guard<std::mutex> lock{ state_mutex_ };
 
-    assert(worker_threads_.empty());
-
     if (IsRunning()) {
       LOG_WARN("Server is already running");
       return;
     }
 
     running_ = true;
-    io_context_.restart();
 
-    if (!Listen(port_)) {
-      LOG_ERRO("Server is NOT going to run");
-      return;
+    ResizeShards(sharded ? loops : 1);
+
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      Shard& shard = shards_[i];
+
+      shard.io_context.restart();
+
+      shard.workers.set_name("shard-" + std::to_string(i));
+      shard.workers.set_size(workers, max_workers_);
+      shard.workers.set_queue_capacity(queue_capacity_);
+
+      if (!Listen(&shard, port_, sharded)) {
+        LOG_ERRO("Server is NOT going to run");
+        return;
+      }
     }
 
     LOG_INFO("Server is going to run");
 
     AsyncWaitSignals();
 
-    AsyncAccept();
+    for (Shard& shard : shards_) {
+      AsyncAccept(&shard);
 
-    // Create worker threads.
-    for (std::size_t i = 0; i < workers; ++i) {
-      worker_threads_.emplace_back(&Server::WorkerRoutine, this);
+      // Create worker threads.
+      StartWorkers(&shard.workers);
+    }
+
+    for (auto& pair : executors_) {
+      StartWorkers(pair.second.get());
     }
   }
 
@@ -82,15 +120,36 @@ void Server::Run(std::size_t workers, std::size_t loops) {
   // asynchronous operation outstanding: the asynchronous accept call waiting
   // for new incoming connections.
 
+  if (sharded) {
+    LOG_INFO("Loop is running in %u shard(s)", shards_.size());
+
+    // Run the loop of the first shard in current thread and the others each
+    // in a separate thread.
+    std::vector<std::thread> loop_threads;
+    for (std::size_t i = 1; i < shards_.size(); ++i) {
+      loop_threads.emplace_back(&boost::asio::io_context::run,
+                                &shards_[i].io_context);
+    }
+
+    shards_.front().io_context.run();
+
+    for (auto& t : loop_threads) {
+      t.join();
+    }
+    return;
+  }
+
   LOG_INFO("Loop is running in %u thread(s)", loops);
 
+  boost::asio::io_context& io_context = shards_.front().io_context;
+
   if (loops == 1) {
     // Run the loop in current thread.
-    io_context_.run();
+    io_context.run();
   } else {
     std::vector<std::thread> loop_threads;
     for (std::size_t i = 0; i < loops; ++i) {
-      loop_threads.emplace_back(&boost::asio::io_context::run, &io_context_);
+      loop_threads.emplace_back(&boost::asio::io_context::run, &io_context);
     }
     // Join the threads for blocking.
     for (std::size_t i = 0; i < loops; ++i) {
@@ -106,14 +165,62 @@ void Server::Stop() {
 }
 
 bool Server::IsRunning() const {
-  return running_ && !io_context_.stopped();
+  return running_ && !shards_.front().io_context.stopped();
 }
 
-ConnectionPtr Server::NewConnection() {
-  auto view_matcher = std::bind(&Server::MatchView, this, _1, _2, _3);
+std::size_t Server::GetWorkerCount() const {
+  std::size_t count = 0;
+  for (const Shard& shard : shards_) {
+    count += shard.workers.size();
+  }
+  for (auto& pair : executors_) {
+    count += pair.second->size();
+  }
+  return count;
+}
+
+bool Server::AddExecutor(const std::string& name, std::size_t workers,
+                         std::size_t queue_capacity, std::size_t max_workers) {
+  assert(!name.empty());
+  assert(workers > 0);
+
+  if (executors_.find(name) != executors_.end()) {
+    LOG_WARN("Executor (%s) already exists", name.c_str());
+    return false;
+  }
+
+  auto pool = std::make_unique<WorkerPool>();
+  pool->set_name(name);
+  pool->set_size(workers, max_workers);
+  pool->set_queue_capacity(queue_capacity);
+
+  executors_[name] = std::move(pool);
+  return true;
+}
+
+ConnectionPtr Server::NewConnection(Shard* shard) {
+  // Reuse a released connection of the shard if possible.
+  auto connection = shard->pool.Reuse();
+  if (connection == nullptr) {
+    connection = shard->pool.Manage(
+        new Connection{ shard->io_context, &shard->pool,
+                        NewRequestHandler(shard), NewViewMatcher(),
+                        buffer_size_ });
+  }
+  return connection;
+}
 
-  return std::make_shared<Connection>(io_context_, &pool_, &queue_,
-                                      std::move(view_matcher), buffer_size_);
+RequestHandler Server::NewRequestHandler(Shard* shard) {
+  // NOTE: Lambdas capturing no more than two pointers fit in the small buffer
+  // of std::function, unlike std::bind.
+  return [this, shard](ConnectionPtr connection) {
+    OnRequest(shard, connection);
+  };
+}
+
+ViewMatcher Server::NewViewMatcher() {
+  return [this](const std::string& method, const std::string& url_path,
+                UrlArgs* args) { return FindRoute(method, url_path, args); };
 }
 
 void Server::CheckDocRoot() {
@@ -134,7 +241,7 @@ void Server::CheckDocRoot() {
 
     doc_root_ = sfs::canonical(doc_root_);
 
-    LOG_INFO("Doc root: %s", doc_root_.u8string().c_str());
+    LOG_INFO("Doc root: %s", utility::PathToUtf8(doc_root_).c_str());
 
   } catch (const sfs::filesystem_error& e) {
     LOG_ERRO("Invalid doc root: %s", e.what());
@@ -163,13 +270,27 @@ void Server::AsyncWaitSignals() {
       });
 }
 
-bool Server::Listen(std::uint16_t port) {
+void Server::ResizeShards(std::size_t count) {
+  assert(count > 0);
+
+  // The first shard is never removed, the signals are waited in its loop.
+  while (shards_.size() > count) {
+    shards_.pop_back();
+  }
+  while (shards_.size() < count) {
+    shards_.emplace_back();
+  }
+}
+
+bool Server::Listen(Shard* shard, std::uint16_t port, bool reuse_port) {
   boost::system::error_code ec;
 
   tcp::endpoint endpoint{ protocol_, port };
 
+  tcp::acceptor& acceptor = shard->acceptor;
+
   // Open the acceptor.
-  acceptor_.open(endpoint.protocol(), ec);
+  acceptor.open(endpoint.protocol(), ec);
   if (ec) {
     LOG_ERRO("Acceptor open error (%s)", ec.message().c_str());
     return false;
@@ -181,10 +302,23 @@ bool Server::Listen(std::uint16_t port) {
   // More details:
   // - https://stackoverflow.com/a/3233022
   // - http://www.andy-pearce.com/blog/posts/2013/Feb/so_reuseaddr-on-windows/
-  acceptor_.set_option(tcp::acceptor::reuse_address(true));
+  acceptor.set_option(tcp::acceptor::reuse_address(true));
+
+#if defined(SO_REUSEPORT)
+  // Set option SO_REUSEPORT on for the sharded mode.
+  // Each shard binds its own acceptor to the same port, and the kernel
+  // distributes the incoming connections among them.
+  if (reuse_port) {
+    acceptor.set_option(ReusePort(true), ec);
+    if (ec) {
+      LOG_ERRO("Acceptor set SO_REUSEPORT error (%s)", ec.message().c_str());
+      return false;
+    }
+  }
+#endif
 
   // Bind to the server address.
-  acceptor_.bind(endpoint, ec);
+  acceptor.bind(endpoint, ec);
   if (ec) {
     LOG_ERRO("Acceptor bind error (%s)", ec.message().c_str());
     return false;
@@ -193,7 +327,7 @@ bool Server::Listen(std::uint16_t port) {
   // Start listening for connections.
   // After listen, the client is able to connect to the server even the server
   // has not started to accept the connection yet.
-  acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
+  acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
   if (ec) {
     LOG_ERRO("Acceptor listen error (%s)", ec.message().c_str());
     return false;
@@ -202,119 +336,222 @@ bool Server::Listen(std::uint16_t port) {
   return true;
 }
 
-void Server::AsyncAccept() {
+void Server::AsyncAccept(Shard* shard) {
 #if WEBCC_STUDY_SERVER_THREADING
   LOG_USER("AsyncAccept()");
 #endif
 
-  auto connection = NewConnection();
+  auto connection = NewConnection(shard);
+  connection->set_max_body_size(max_body_size_);
 
-  acceptor_.async_accept(connection->GetSocket(),
-                         std::bind(&Server::OnAccept, this, connection, _1));
+  shard->acceptor.async_accept(
+      connection->GetSocket(),
+      std::bind(&Server::OnAccept, this, shard, connection, _1));
 }
 
-void Server::OnAccept(ConnectionPtr connection, boost::system::error_code ec) {
+void Server::OnAccept(Shard* shard, ConnectionPtr connection,
+                      boost::system::error_code ec) {
 #if WEBCC_STUDY_SERVER_THREADING
   LOG_USER("OnAccept()");
 #endif
 
   // Check whether the server was stopped by a signal before this completion
   // handler had a chance to run.
-  if (!acceptor_.is_open()) {
+  if (!shard->acceptor.is_open()) {
     return;
   }
 
   if (!ec) {
     LOG_INFO("Accepted a connection");
-    pool_.Start(connection);
+
+    // Disable Nagle's algorithm. The headers and the body of a response are
+    // written separately, the body would otherwise wait for the delayed ACK of
+    // the headers.
+    connection->GetSocket().set_option(tcp::no_delay(true), ec);
+
+    connection->set_http2_enabled(http2_);
+
+    shard->pool.Start(connection);
   }
 
-  AsyncAccept();
+  AsyncAccept(shard);
 }
 
 void Server::DoStop() {
-  // Stop accepting new connections.
-  acceptor_.close();
+  if (!running_) {
+    // Otherwise the handlers posted below would be left to the next Run().
+    return;
+  }
+
+  // The acceptor and the sockets of a shard are not thread-safe, they're
+  // closed in the loop of the shard, which might be running in another thread.
 
-  // Stop worker threads.
-  // This might take some time if the threads are still processing.
-  StopWorkers();
+  // Stop accepting new connections.
+  for (Shard& shard : shards_) {
+    boost::asio::post(shard.io_context, [&shard]() {
+      boost::system::error_code ec;
+      shard.acceptor.close(ec);
+    });
+  }
 
-  // Close all pending connections.
-  pool_.Clear();
+  for (Shard& shard : shards_) {
+    // Stop worker threads.
+    // This might take some time if the threads are still processing.
+    shard.workers.Stop();
+
+    boost::asio::post(shard.io_context, [&shard]() {
+      // Close all pending connections.
+      shard.pool.Clear();
+
+      // Finally, stop the event processing loop.
+      // This function does not block, but instead simply signals the
+      // io_context to stop. All invocations of its run() or run_one() member
+      // functions should return as soon as possible.
+      shard.io_context.stop();
+    });
+  }
 
-  // Finally, stop the event processing loop.
-  // This function does not block, but instead simply signals the io_context to
-  // stop. All invocations of its run() or run_one() member functions should
-  // return as soon as possible.
-  io_context_.stop();
+  for (auto& pair : executors_) {
+    pair.second->Stop();
+  }
 
   running_ = false;
 }
 
-void Server::WorkerRoutine() {
-  LOG_INFO("Worker is running");
+void Server::OnRequest(Shard* shard, ConnectionPtr connection) {
+  ViewPtr view = connection->view();
 
-  while (true) {
-    ConnectionPtr connection = queue_.PopOrWait();
+#if WEBCC_ENABLE_COROUTINE
+  if (auto coroutine_view = std::dynamic_pointer_cast<CoroutineView>(view)) {
+    connection->WatchPeer();
+    HandleCoroutine(coroutine_view, connection);
+    return;
+  }
+#endif  // WEBCC_ENABLE_COROUTINE
 
-    if (connection == nullptr) {
-      LOG_INFO("Worker is going to stop");
+  if (view != nullptr && view->NonBlocking(connection->request()->method())) {
+    // Handle the request right in the loop thread.
+    Handle(connection);
+    return;
+  }
 
-      // For stopping next worker.
-      queue_.Push({});
+  // Enqueue the connection.
+  // Some worker thread will handle the request later.
+  WorkerPool* pool = &shard->workers;
 
-      // Stop this worker.
-      break;
+  // Let the named executor of the route handle it.
+  const RouteInfo* route = connection->route();
+  if (route != nullptr && !route->executor.empty()) {
+    auto it = executors_.find(route->executor);
+    if (it != executors_.end()) {
+      pool = it->second.get();
     }
+  }
 
-    Handle(connection);
+  // Cancel the request if the client goes away while it's waiting in the
+  // queue or being handled.
+  connection->WatchPeer();
+
+  if (!pool->Push(connection)) {
+    // Shed the load, don't let the latency of all the requests climb.
+    LOG_WARN("The queue is full, drop the request");
+    SendServiceUnavailable(connection, false);
   }
 }
 
-void Server::StopWorkers() {
-  LOG_INFO("Stop workers");
+void Server::StartWorkers(WorkerPool* pool) {
+  pool->set_idle_timeout(worker_idle_timeout_);
+  pool->set_max_queue_delay(max_queue_delay_);
+  pool->set_codel(codel_target_delay_, codel_interval_);
+  pool->set_resize_handler(worker_resize_handler_);
 
-  // Clear/drop pending connections.
-  // The connections will be closed later (see DoStop).
-  // Alternatively, we can wait for the pending connections to be handled.
-  if (queue_.Size() != 0) {
-    LOG_INFO("Clear pending connections");
-    queue_.Clear();
-  }
+  pool->Start([this, pool](ConnectionPtr connection) {
+    HandleQueued(pool, connection);
+  });
+}
 
-  // Enqueue a null connection to trigger the first worker to stop.
-  queue_.Push(ConnectionPtr());
+void Server::SendServiceUnavailable(ConnectionPtr connection, bool post) {
+  auto response =
+      std::make_shared<Response>(status_codes::kServiceUnavailable);
+  response->SetHeader(headers::kRetryAfter, std::to_string(retry_after_));
+  response->SetBody(std::make_shared<Body>(), true);
 
-  // Wait for worker threads to finish.
-  for (auto& t : worker_threads_) {
-    if (t.joinable()) {
-      t.join();
-    }
+  if (post) {
+    connection->PostResponse(response);
+  } else {
+    connection->SendResponse(response);
+  }
+}
+
+void Server::HandleQueued(WorkerPool* pool, ConnectionPtr connection) {
+  if (connection->request()->IsCanceled()) {
+    LOG_INFO("The client has gone away, drop the request");
+    connection->PostClose();
+    return;
   }
 
-  // Cleanup worker threads.
-  worker_threads_.clear();
+  if (pool->ShouldDrop(connection)) {
+    LOG_WARN("The request has waited too long in the queue, drop it");
+    // Let the loop send the response, this worker moves on.
+    SendServiceUnavailable(connection, true);
+    return;
+  }
 
-  // Clear the queue because it has a remaining null connection pushed by the
-  // last worker thread.
-  queue_.Clear();
+  Handle(connection);
+}
 
-  LOG_INFO("Workers stopped");
+#if WEBCC_ENABLE_COROUTINE
+
+void Server::HandleCoroutine(std::shared_ptr<CoroutineView> view,
+                             ConnectionPtr connection) {
+  // Spawn the coroutine in the loop of the connection.
+  // The completion handler runs in the same loop, the response is sent from
+  // there as soon as the coroutine returns it.
+  boost::asio::co_spawn(
+      connection->GetSocket().get_executor(),
+      view->AsyncHandle(connection->request()),
+      [view, connection](std::exception_ptr e, ResponsePtr response) {
+        if (e) {
+          try {
+            std::rethrow_exception(e);
+          } catch (const std::exception& ex) {
+            LOG_ERRO("Coroutine view error (%s)", ex.what());
+          } catch (...) {
+            LOG_ERRO("Coroutine view error");
+          }
+          connection->SendResponse(status_codes::kInternalServerError);
+        } else if (response != nullptr) {
+          connection->SendResponse(response);
+        } else {
+          // Shouldn't be here!
+          // CoroutineView::AsyncHandle() should return a proper response.
+          connection->SendResponse(status_codes::kBadRequest);
+        }
+      });
 }
 
+#endif  // WEBCC_ENABLE_COROUTINE
+
 void Server::Handle(ConnectionPtr connection) {
   auto request = connection->request();
 
-  std::string url_path = Url::DecodeUnsafe(request->url().path());
-  LOG_INFO("Request URL path: %s", url_path.c_str());
-
-  UrlArgs args;
-  ViewPtr view = FindView(request->method(), url_path, &args);
+  // The view has been matched, and the URL args have been saved to the
+  // request, once the headers of the request were parsed.
+  ViewPtr view = connection->view();
 
   if (view != nullptr) {
-    // Save the (regex matched) URL args to the request object.
-    request->set_args(std::move(args));
+    if (auto websocket_view = std::dynamic_pointer_cast<WebSocketView>(view)) {
+      HandleWebSocket(websocket_view, connection);
+      return;
+    }
+
+    if (auto deferred_view = std::dynamic_pointer_cast<DeferredView>(view)) {
+      // The view will complete the response later, maybe from another thread.
+      deferred_view->AsyncHandle(request, [connection](ResponsePtr response) {
+        connection->PostResponse(response);
+      });
+      return;
+    }
 
     // Ask the matched view to process the request.
     ResponsePtr response = view->Handle(request);
@@ -345,6 +582,56 @@ void Server::Handle(ConnectionPtr connection) {
   }
 }
 
+void Server::HandleWebSocket(WebSocketViewPtr view, ConnectionPtr connection) {
+  if (auto message = std::dynamic_pointer_cast<WebSocketMessage>(connection)) {
+    view->OnMessage(message->socket(), message->data(), message->binary());
+    message->Done();
+    return;
+  }
+
+  // The opening handshake (RFC 6455 4.2.2).
+  auto request = connection->request();
+
+  if (!request->websocket_upgrade() ||
+      request->GetHeader(headers::kSecWebSocketVersion) != "13") {
+    auto response = std::make_shared<Response>(status_codes::kUpgradeRequired);
+    response->SetHeader(headers::kUpgrade, "websocket");
+    response->SetHeader(headers::kSecWebSocketVersion, "13");
+    response->SetBody(std::make_shared<Body>(), true);
+    connection->SendResponse(response);
+    return;
+  }
+
+  std::string_view key = request->GetHeader(headers::kSecWebSocketKey);
+  if (key.empty()) {
+    connection->SendResponse(status_codes::kBadRequest);
+    return;
+  }
+
+  if (!view->Accept(request)) {
+    connection->SendResponse(status_codes::kForbidden);
+    return;
+  }
+
+  auto response =
+      std::make_shared<Response>(status_codes::kSwitchingProtocols);
+  response->SetHeader(headers::kUpgrade, "websocket");
+  response->SetHeader(headers::kSecWebSocketAccept, websocket::AcceptKey(key));
+
+  std::string extensions;
+  if (websocket::NegotiateDeflate(
+          request->GetHeader(headers::kSecWebSocketExtensions),
+          &extensions) > 0) {
+    response->SetHeader(headers::kSecWebSocketExtensions, extensions);
+  }
+
+  // No Content-Length for an informational response.
+  response->SetBody(std::make_shared<Body>(), false);
+
+  // The connection switches to WebSocket once the response has been written.
+  connection->SendResponse(response);
+}
+
 ResponsePtr Server::ServeStatic(RequestPtr request) {
   assert(request->method() == methods::kGet);
 
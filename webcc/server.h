@@ -1,22 +1,29 @@
 #ifndef WEBCC_SERVER_H_
 #define WEBCC_SERVER_H_
 
+#include <deque>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "boost/asio/io_context.hpp"
 #include "boost/asio/ip/tcp.hpp"
 #include "boost/asio/signal_set.hpp"
 
+#include "webcc/config.h"
 #include "webcc/connection.h"
 #include "webcc/connection_pool.h"
-#include "webcc/queue.h"
 #include "webcc/router.h"
 #include "webcc/url.h"
+#include "webcc/worker_pool.h"
 
 namespace webcc {
 
+#if WEBCC_ENABLE_COROUTINE
+class CoroutineView;
+#endif  // WEBCC_ENABLE_COROUTINE
+
 class Server : public Router {
 public:
   Server(boost::asio::ip::tcp protocol, std::uint16_t port,
@@ -38,6 +45,108 @@ public:
     file_chunk_size_ = file_chunk_size;
   }
 
+  // Set the capacity of the queue of the connections waiting for the workers.
+  // When the queue is full, the requests are answered with Service Unavailable
+  // (503) right away by the loop, without entering a worker.
+  // Applied on next Run().
+  void set_queue_capacity(std::size_t queue_capacity) {
+    if (queue_capacity > 0) {
+      queue_capacity_ = queue_capacity;
+    }
+  }
+
+  // Set the maximum time (in milliseconds) a request can wait in the queue.
+  // The requests which have waited longer are answered with Service
+  // Unavailable (503) by the worker without being handled by the views, since
+  // the clients have probably given up. Default as 0 to disable it.
+  void set_max_queue_delay(int max_queue_delay) {
+    max_queue_delay_ = max_queue_delay;
+  }
+
+  // Enable the CoDel (Controlled Delay) load shedding with the given target
+  // delay and interval (in milliseconds), or disable it with a zero target
+  // delay. See class Codel for the details.
+  // Unlike a fixed maximum queue delay, CoDel only drops requests when the
+  // queue stays long, a short burst is still absorbed.
+  // Applied on next Run().
+  void set_codel(int target_delay, int interval = 100) {
+    codel_target_delay_ = target_delay;
+    if (interval > 0) {
+      codel_interval_ = interval;
+    }
+  }
+
+  // Set the maximum number of workers (of each shard) to make the worker pool
+  // elastic. The pool starts with `workers` threads (see Run()), grows when the
+  // requests keep waiting in the queue, and shrinks when the workers are idle
+  // for long (see set_worker_idle_timeout()). Applied on next Run().
+  void set_max_workers(std::size_t max_workers) {
+    max_workers_ = max_workers;
+  }
+
+  // Set the time (in seconds) after which an idle worker will be retired if the
+  // pool is elastic.
+  void set_worker_idle_timeout(int worker_idle_timeout) {
+    if (worker_idle_timeout > 0) {
+      worker_idle_timeout_ = worker_idle_timeout;
+    }
+  }
+
+  // Set the handler to be notified when a worker pool grows or shrinks.
+  // It's called from the thread which resizes the pool, with the name of the
+  // pool (e.g., "shard-0") and its new size.
+  void set_worker_resize_handler(WorkerPool::ResizeHandler handler) {
+    worker_resize_handler_ = std::move(handler);
+  }
+
+  // Add a named executor (a bulkhead) with its own workers and queue.
+  // The requests of the routes bound to it (see Router::Route()) are handled
+  // only by its workers, so that a slow endpoint can't fill all the workers and
+  // starve the others. The executor is shared by all shards, and the load
+  // shedding settings (e.g., set_max_queue_delay()) also apply to it.
+  // The routes bound to an unknown executor use the default workers.
+  // Return false if the executor already exists. Call it before Run().
+  bool AddExecutor(const std::string& name, std::size_t workers,
+                   std::size_t queue_capacity = kQueueCapacity,
+                   std::size_t max_workers = 0);
+
+  // Set the value (in seconds) of the Retry-After header of the Service
+  // Unavailable (503) responses for the dropped requests.
+  void set_retry_after(int retry_after) {
+    if (retry_after > 0) {
+      retry_after_ = retry_after;
+    }
+  }
+
+  // Limit the size of the request body, no limit (kInvalidSize) by default.
+  // The requests with a larger body are answered with Payload Too Large (413)
+  // as soon as it's known, e.g., by the Content-Length, and the connections
+  // are closed. A route could allow more or less (see Route()).
+  void set_max_body_size(std::size_t max_body_size) {
+    max_body_size_ = max_body_size;
+  }
+
+  // Enable or disable the sharded mode (see Run()).
+  // The sharded mode needs SO_REUSEPORT (e.g., Linux 3.9+, BSD, macOS). On
+  // other platforms, the server falls back to the normal mode.
+  void set_sharded(bool sharded) {
+    sharded_ = sharded;
+  }
+
+  // Enable or disable HTTP/2 (disabled by default).
+  // The plain server (h2c) expects the client to start HTTP/2 with prior
+  // knowledge, i.e., send the connection preface right away; the upgrade from
+  // HTTP/1.1 is not supported. SslServer negotiates it by ALPN (h2). Each
+  // stream of an HTTP/2 connection is handled as a connection with a single
+  // request, so the views work the same way.
+  void set_http2(bool http2) {
+    http2_ = http2;
+  }
+
+  bool http2() const {
+    return http2_;
+  }
+
   // Start and run the server.
   // This method is blocking so will not return until Stop() is called (from
   // another thread) or a signal like SIGINT is caught.
@@ -46,10 +155,17 @@ public:
   // `workers` you have, the more concurrency you gain (the concurrency also
   // depends on the number of CPU cores). The worker thread pops connections
   // from the queue one by one, prepares the response by the user provided View,
-  // then sends it back to the client.
+  // then sends it back to the client. The number of workers could also be
+  // elastic, between `workers` and a maximum (see set_max_workers()).
   // Meanwhile, the (event) loop, i.e., io_context, is also running in a number
   // (`loops`) of threads. Normally, one thread for the loop is good enough, but
   // it could be more than that.
+  // In the sharded mode (see set_sharded()), the server is split into `loops`
+  // shards instead. Each shard has its own io_context running in its own
+  // thread, its own acceptor listening on the same port with SO_REUSEPORT, its
+  // own connection pool and queue, and `workers` worker threads of its own.
+  // The kernel spreads the incoming connections among the acceptors, and a
+  // connection stays in its shard for its whole life.
   void Run(std::size_t workers = 1, std::size_t loops = 1);
 
   // Stop the server.
@@ -59,9 +175,44 @@ public:
   // Is the server running?
   bool IsRunning() const;
 
+  // The current number of workers of all shards and executors.
+  std::size_t GetWorkerCount() const;
+
 protected:
-  // Create a new connection.
-  virtual ConnectionPtr NewConnection();
+  // A shard owns an event loop and everything bound to it.
+  // In the normal mode, there's only one shard.
+  struct Shard {
+    Shard() : acceptor(io_context) {
+    }
+
+    ~Shard() {
+      // The released connections must be deleted before the io_context, and
+      // the ones released by the destruction of the io_context (i.e., its
+      // pending handlers) will be deleted directly.
+      pool.StopRecycling();
+    }
+
+    // The connection pool which owns all live connections of this shard, and
+    // recycles the released ones.
+    // NOTE: Declared before the io_context so that it outlives the handlers.
+    ConnectionPool pool;
+
+    // The io_context used to perform asynchronous operations.
+    boost::asio::io_context io_context;
+
+    // Acceptor used to listen for incoming connections.
+    boost::asio::ip::tcp::acceptor acceptor;
+
+    // The worker threads and the queue of the connections waiting for them.
+    WorkerPool workers;
+  };
+
+  // Create a new connection bound to the given shard.
+  virtual ConnectionPtr NewConnection(Shard* shard);
+
+  // Create the request handler and the view matcher for a new connection.
+  RequestHandler NewRequestHandler(Shard* shard);
+  ViewMatcher NewViewMatcher();
 
   // Check if doc root is valid.
   // Absolute it if necessary.
@@ -73,30 +224,57 @@ protected:
   // Wait for a signal to stop the server.
   void AsyncWaitSignals();
 
+  // Make the number of shards to be `count`.
+  void ResizeShards(std::size_t count);
+
   // Listen on the given port.
-  bool Listen(std::uint16_t port);
+  // If `reuse_port` is true, option SO_REUSEPORT will be set to the acceptor.
+  bool Listen(Shard* shard, std::uint16_t port, bool reuse_port);
 
   // Accept connections asynchronously.
-  void AsyncAccept();
-  void OnAccept(ConnectionPtr connection, boost::system::error_code ec);
+  void AsyncAccept(Shard* shard);
+  void OnAccept(Shard* shard, ConnectionPtr connection,
+                boost::system::error_code ec);
 
   // Stop acceptor and worker threads, close all pending connections, and
   // finally stop the event loop.
   void DoStop();
 
-  // Worker thread routine.
-  void WorkerRoutine();
+  // Called from the loop when the request of a connection has been read.
+  // Handle the request right away if the matched view is non-blocking,
+  // otherwise put the connection into the queue for the workers.
+  void OnRequest(Shard* shard, ConnectionPtr connection);
+
+#if WEBCC_ENABLE_COROUTINE
+  // Spawn the coroutine of the view in the loop of the connection and send the
+  // response back when it completes.
+  void HandleCoroutine(std::shared_ptr<CoroutineView> view,
+                       ConnectionPtr connection);
+#endif  // WEBCC_ENABLE_COROUTINE
 
-  // Clear pending connections from the queue and stop worker threads.
-  void StopWorkers();
+  // Start the workers of the pool.
+  void StartWorkers(WorkerPool* pool);
+
+  // Answer Service Unavailable (503) with a Retry-After header.
+  void SendServiceUnavailable(ConnectionPtr connection, bool post);
+
+  // Called in a worker thread of the pool for each connection popped from the
+  // queue. Drop the request if it has waited too long, otherwise handle it.
+  void HandleQueued(WorkerPool* pool, ConnectionPtr connection);
 
   // Handle a connection (or more precisely, the request inside it).
   // Get the request from the connection, process it, prepare the response,
   // then send the response back to the client.
   // The connection will keep alive if it's a persistent connection. When next
   // request comes, this connection will be put back to the queue again.
+  // Called from a worker thread, or from the loop thread for non-blocking views
+  // (see View::NonBlocking()).
   virtual void Handle(ConnectionPtr connection);
 
+  // Answer the opening handshake of WebSocket, or handle a message received
+  // (see WebSocketMessage).
+  void HandleWebSocket(WebSocketViewPtr view, ConnectionPtr connection);
+
   // Serve static files from the doc root.
   ResponsePtr ServeStatic(RequestPtr request);
 
@@ -129,29 +307,55 @@ protected:
   // The size of the chunk for serving static files.
   std::size_t file_chunk_size_ = 1024;
 
+  // The maximum number of workers of each shard.
+  // The worker pool is elastic if it's larger than the `workers` of Run().
+  std::size_t max_workers_ = 0;
+
+  // The time (seconds) after which an idle worker will be retired.
+  int worker_idle_timeout_ = 60;
+
+  WorkerPool::ResizeHandler worker_resize_handler_;
+
+  // The capacity of the queue of each shard.
+  std::size_t queue_capacity_ = kQueueCapacity;
+
+  // The maximum time (milliseconds) a request can wait in the queue.
+  // 0 means no limit.
+  int max_queue_delay_ = 0;
+
+  // The target delay and the interval (milliseconds) of CoDel.
+  // CoDel is disabled if the target delay is 0.
+  int codel_target_delay_ = 0;
+  int codel_interval_ = 100;
+
+  // The Retry-After (seconds) for the requests dropped.
+  int retry_after_ = 1;
+
+  // The max size of the request body.
+  std::size_t max_body_size_ = kInvalidSize;
+
+  // Run in the sharded mode or not.
+  bool sharded_ = false;
+
+  // Enable HTTP/2 or not.
+  bool http2_ = false;
+
   // Is the server running?
   bool running_ = false;
 
   // The mutex for guarding the state of the server.
   std::mutex state_mutex_;
 
-  // The io_context used to perform asynchronous operations.
-  boost::asio::io_context io_context_;
+  // The named executors.
+  std::unordered_map<std::string, std::unique_ptr<WorkerPool>> executors_;
 
-  // Acceptor used to listen for incoming connections.
-  boost::asio::ip::tcp::acceptor acceptor_;
-
-  // The connection pool which owns all live connections.
-  ConnectionPool pool_;
+  // The shards, at least one.
+  // A deque is used so that the shards never relocate when more are added.
+  std::deque<Shard> shards_;
 
   // The signals for processing termination notifications.
+  // Waited in the loop of the first shard.
   boost::asio::signal_set signals_;
-
-  // Worker threads.
-  std::vector<std::thread> worker_threads_;
-
-  // The queue with connection waiting for the workers to process.
-  Queue<ConnectionPtr> queue_;
 };
 
 }  // namespace webcc
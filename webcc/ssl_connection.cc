@@ -4,6 +4,7 @@
 #include "boost/asio/ssl.hpp"
 
 #include "webcc/connection_pool.h"
+#include "webcc/http2_session.h"
 #include "webcc/logger.h"
 
 namespace webcc {
@@ -12,7 +13,7 @@ using namespace std::placeholders;
 namespace ssl = boost::asio::ssl;
 
 void SslConnection::Start() {
-  ssl_stream_.async_handshake(ssl::stream_base::server,
+  ssl_stream_->async_handshake(ssl::stream_base::server,
                               std::bind(&SslConnection::OnHandshake, this, _1));
 }
 
@@ -21,7 +22,7 @@ void SslConnection::Close() {
   GetSocket().cancel(ec);
 
   // Shutdown SSL
-  ssl_stream_.shutdown(ec);
+  ssl_stream_->shutdown(ec);
   if (ec) {
     LOG_WARN("SSL shutdown error (%s)", ec.message().c_str());
     ec.clear();
@@ -30,15 +31,20 @@ void SslConnection::Close() {
   ConnectionBase::Close();
 }
 
+void SslConnection::Reset() {
+  ConnectionBase::Reset();
+  ssl_stream_.emplace(io_context_, ssl_context_);
+}
+
 void SslConnection::AsyncWrite(
     const std::vector<boost::asio::const_buffer>& buffers,
     AsyncRWHandler&& handler) {
-  boost::asio::async_write(ssl_stream_, buffers, std::move(handler));
+  boost::asio::async_write(*ssl_stream_, buffers, std::move(handler));
 }
 
 void SslConnection::AsyncReadSome(boost::asio::mutable_buffer buffer,
                                   AsyncRWHandler&& handler) {
-  ssl_stream_.async_read_some(buffer, std::move(handler));
+  ssl_stream_->async_read_some(buffer, std::move(handler));
 }
 
 void SslConnection::OnHandshake(boost::system::error_code ec) {
@@ -48,6 +54,19 @@ void SslConnection::OnHandshake(boost::system::error_code ec) {
     return;
   }
 
+  if (http2_enabled_) {
+    // The client has chosen HTTP/2 by ALPN (see SslServer).
+    const unsigned char* alpn = nullptr;
+    unsigned int alpn_length = 0;
+    SSL_get0_alpn_selected(ssl_stream_->native_handle(), &alpn, &alpn_length);
+
+    if (std::string_view(reinterpret_cast<const char*>(alpn), alpn_length) ==
+        http2::kAlpnId) {
+      StartHttp2({});
+      return;
+    }
+  }
+
   PrepareRequest();
   AsyncRead();
 }
@@ -1,6 +1,8 @@
 #ifndef WEBCC_SSL_CONNECTION_H_
 #define WEBCC_SSL_CONNECTION_H_
 
+#include <optional>
+
 #include "boost/asio/ssl/context.hpp"
 #include "boost/asio/ssl/stream.hpp"
 
@@ -12,17 +14,19 @@ class SslConnection : public ConnectionBase {
 public:
   SslConnection(boost::asio::io_context& io_context,
                 boost::asio::ssl::context& ssl_context, ConnectionPool* pool,
-                Queue<ConnectionPtr>* queue, ViewMatcher&& view_matcher,
+                RequestHandler&& request_handler, ViewMatcher&& view_matcher,
                 std::size_t buffer_size)
-      : ConnectionBase(io_context, pool, queue, std::move(view_matcher),
-                       buffer_size),
-        ssl_stream_(io_context, ssl_context) {
+      : ConnectionBase(io_context, pool, std::move(request_handler),
+                       std::move(view_matcher), buffer_size),
+        io_context_(io_context),
+        ssl_context_(ssl_context) {
+    ssl_stream_.emplace(io_context_, ssl_context_);
   }
 
   ~SslConnection() override = default;
 
   SocketType& GetSocket() override {
-    return ssl_stream_.lowest_layer();
+    return ssl_stream_->lowest_layer();
   }
 
   // Override to firstly handshake before read the client request.
@@ -31,6 +35,9 @@ public:
   // Override to firstly shut down SSL.
   void Close() override;
 
+  // Override to create a new SSL stream, which can't be reused.
+  void Reset() override;
+
 protected:
   void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
                   AsyncRWHandler&& handler) override;
@@ -41,7 +48,11 @@ protected:
 private:
   void OnHandshake(boost::system::error_code ec);
 
-  boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssl_stream_;
+  boost::asio::io_context& io_context_;
+  boost::asio::ssl::context& ssl_context_;
+
+  std::optional<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>
+      ssl_stream_;
 };
 
 }  // namespace webcc
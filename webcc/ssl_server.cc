@@ -1,22 +1,53 @@
 #include "webcc/ssl_server.h"
 
+#include "openssl/ssl.h"
+
+#include "webcc/logger.h"
 #include "webcc/ssl_connection.h"
 
 namespace webcc {
 
+namespace {
+
+// The protocols in the wire format of ALPN, in the order of preference.
+const unsigned char kAlpnHttp2[] = "\x02h2\x08http/1.1";
+const unsigned char kAlpnHttp1[] = "\x08http/1.1";
+
+// Select the protocol from the ones offered by the client.
+int SelectAlpn(SSL* /*ssl*/, const unsigned char** out, unsigned char* outlen,
+               const unsigned char* in, unsigned int inlen, void* arg) {
+  auto server = static_cast<const SslServer*>(arg);
+
+  const unsigned char* protos = server->http2() ? kAlpnHttp2 : kAlpnHttp1;
+  unsigned int protos_length = server->http2() ? sizeof(kAlpnHttp2) - 1
+                                               : sizeof(kAlpnHttp1) - 1;
+
+  unsigned char* selected = nullptr;
+  if (SSL_select_next_proto(&selected, outlen, protos, protos_length, in,
+                            inlen) != OPENSSL_NPN_NEGOTIATED) {
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+
+  *out = selected;
+  return SSL_TLSEXT_ERR_OK;
+}
+
+}  // namespace
+
 SslServer::SslServer(boost::asio::ip::tcp protocol, std::uint16_t port,
                      const sfs::path& doc_root, ssl::context::method method)
     : Server(protocol, port, doc_root), ssl_context_(method) {
+  SSL_CTX_set_alpn_select_cb(ssl_context_.native_handle(), &SelectAlpn, this);
 }
 
-ConnectionPtr SslServer::NewConnection() {
-  using namespace std::placeholders;
-
-  auto view_matcher = std::bind(&Server::MatchView, this, _1, _2, _3);
-
-  return std::make_shared<SslConnection>(io_context_, ssl_context_, &pool_,
-                                         &queue_, std::move(view_matcher),
-                                         buffer_size_);
+ConnectionPtr SslServer::NewConnection(Shard* shard) {
+  auto connection = shard->pool.Reuse();
+  if (connection == nullptr) {
+    connection = shard->pool.Manage(new SslConnection{
+        shard->io_context, ssl_context_, &shard->pool,
+        NewRequestHandler(shard), NewViewMatcher(), buffer_size_ });
+  }
+  return connection;
 }
 
 }  // namespace webcc
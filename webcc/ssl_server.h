@@ -33,7 +33,7 @@ public:
 
 private:
   // Override to create a SSL connection.
-  ConnectionPtr NewConnection() override;
+  ConnectionPtr NewConnection(Shard* shard) override;
 
   boost::asio::ssl::context ssl_context_;
 };
@@ -5,6 +5,7 @@
 #include <Windows.h>
 #endif
 
+#include <charconv>
 #include <random>
 
 namespace webcc {
@@ -30,12 +31,20 @@ std::string RandomAsciiString(std::size_t length) {
   return s;
 }
 
-bool ToSizeT(const std::string& str, int base, std::size_t* size) {
-  try {
-    *size = static_cast<std::size_t>(std::stoul(str, 0, base));
-  } catch (const std::exception&) {
+bool ToSizeT(std::string_view str, int base, std::size_t* size) {
+  std::size_t off = str.find_first_not_of(" \t");
+  if (off == std::string_view::npos) {
     return false;
   }
+
+  const char* end = str.data() + str.size();
+  unsigned long value = 0;
+  auto result = std::from_chars(str.data() + off, end, value, base);
+  if (result.ec != std::errc{}) {
+    return false;
+  }
+
+  *size = static_cast<std::size_t>(value);
   return true;
 }
 
@@ -68,6 +77,29 @@ void Split(std::string_view input, char delim, bool compress_token,
   }
 }
 
+bool IEquals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    char ca = a[i];
+    char cb = b[i];
+    if (ca != cb) {
+      if (ca >= 'A' && ca <= 'Z') {
+        ca += 'a' - 'A';
+      }
+      if (cb >= 'A' && cb <= 'Z') {
+        cb += 'a' - 'A';
+      }
+      if (ca != cb) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 void Trim(std::string_view& sv, const char* spaces) {
   sv.remove_prefix(std::min(sv.find_first_not_of(spaces), sv.size()));
 
@@ -11,8 +11,12 @@ namespace webcc {
 std::string RandomAsciiString(std::size_t length);
 
 // Convert string to size_t.
-// Just a wrapper of std::stoul.
-bool ToSizeT(const std::string& str, int base, std::size_t* size);
+// Like std::stoul, leading spaces and trailing non-digits are ignored.
+bool ToSizeT(std::string_view str, int base, std::size_t* size);
+
+// Compare two ASCII strings case-insensitively, e.g., the header names.
+// Unlike boost::iequals, the locale is not involved.
+bool IEquals(std::string_view a, std::string_view b);
 
 // Trim spaces (or any of the given chars).
 void Trim(std::string_view& sv, const char* spaces = " \t");
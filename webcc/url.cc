@@ -203,6 +203,11 @@ Url::Url(std::string_view str, bool encode) {
   }
 }
 
+void Url::Reset(std::string_view str) {
+  Clear();
+  Parse(str);
+}
+
 void Url::AppendPath(std::string_view piece, bool encode) {
   if (piece.empty() || piece == "/") {
     return;
@@ -33,6 +33,10 @@ public:
 
   explicit Url(std::string_view str, bool encode = false);
 
+  // Parse another URL string in place of this one, the memory of the
+  // components reused.
+  void Reset(std::string_view str);
+
   const std::string& scheme() const {
     return scheme_;
   }
@@ -65,11 +69,11 @@ public:
   void AppendQuery(const std::string& key, const std::string& value,
                    bool encode = false);
 
+  void Clear();
+
 private:
   void Parse(std::string_view str);
 
-  void Clear();
-
 private:
   std::string scheme_;
   std::string host_;
@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <ctime>
 #include <fstream>
-#include <iomanip>  // for put_time
 #include <iostream>
 #include <sstream>
 
@@ -18,17 +17,71 @@ const std::string& UserAgent() {
   return s_user_agent;
 }
 
+namespace {
+
+std::tm GmTime(std::time_t t) {
+  std::tm gmt{};
+#if defined(_WIN32)
+  gmtime_s(&gmt, &t);
+#else
+  gmtime_r(&t, &gmt);
+#endif
+  return gmt;
+}
+
+void Put2Digits(int n, char* p) {
+  p[0] = static_cast<char>('0' + n / 10 % 10);
+  p[1] = static_cast<char>('0' + n % 10);
+}
+
+// Format as "%a, %d %b %Y %H:%M:%S GMT" in the classic C locale, without the
+// streams or the locale.
+void FormatHttpDate(const std::tm& gmt, char* p) {
+  static const char kDays[] = "SunMonTueWedThuFriSat";
+  static const char kMonths[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+  std::copy_n(kDays + gmt.tm_wday % 7 * 3, 3, p);
+  p[3] = ',';
+  p[4] = ' ';
+  Put2Digits(gmt.tm_mday, p + 5);
+  p[7] = ' ';
+  std::copy_n(kMonths + gmt.tm_mon % 12 * 3, 3, p + 8);
+  p[11] = ' ';
+  int year = gmt.tm_year + 1900;
+  Put2Digits(year / 100, p + 12);
+  Put2Digits(year % 100, p + 14);
+  p[16] = ' ';
+  Put2Digits(gmt.tm_hour, p + 17);
+  p[19] = ':';
+  Put2Digits(gmt.tm_min, p + 20);
+  p[22] = ':';
+  Put2Digits(gmt.tm_sec, p + 23);
+  std::copy_n(" GMT", 4, p + 25);
+}
+
+}  // namespace
+
 std::string HttpDate() {
+  return std::string{ CurrentHttpDate() };
+}
+
+std::string_view CurrentHttpDate() {
+  // Cached by each thread instead of shared, so that no lock is needed.
+  thread_local std::time_t cached_time = -1;
+  thread_local char cached_date[kHttpDateSize];
+
   std::time_t t = std::time(nullptr);
-  std::tm gmt = *std::gmtime(&t);
-  return FormatHttpDate(gmt);
+  if (t != cached_time) {
+    FormatHttpDate(GmTime(t), cached_date);
+    cached_time = t;
+  }
+  return std::string_view{ cached_date, kHttpDateSize };
 }
 
 std::string FormatHttpDate(const std::tm& gmt) {
-  std::ostringstream date;
-  date.imbue(std::locale::classic());  // Use classic C locale
-  date << std::put_time(&gmt, "%a, %d %b %Y %H:%M:%S GMT");
-  return date.str();
+  char date[kHttpDateSize];
+  FormatHttpDate(gmt, date);
+  return std::string{ date, kHttpDateSize };
 }
 
 std::size_t TellSize(const sfs::path& path) {
@@ -40,6 +93,15 @@ std::size_t TellSize(const sfs::path& path) {
   return static_cast<std::size_t>(stream.tellg());
 }
 
+std::string PathToUtf8(const sfs::path& path) {
+#if defined(__cpp_char8_t)
+  auto utf8 = path.u8string();
+  return std::string{ utf8.begin(), utf8.end() };
+#else
+  return path.u8string();
+#endif
+}
+
 bool ReadFile(const sfs::path& path, std::string* bytes) {
   // Flag "ate": seek to the end of stream immediately after open.
   std::ifstream stream{ path, std::ios::binary | std::ios::ate };
@@ -67,6 +129,21 @@ bool WriteFile(const sfs::path& path, const std::string& bytes) {
   return !stream.fail();
 }
 
+bool OpenTempFile(std::ofstream* ofstream, sfs::path* path) {
+  std::error_code ec;
+  *path = sfs::temp_directory_path(ec);
+  if (ec) {
+    return false;
+  }
+
+  // Generate a random string as file name.
+  // A replacement of boost::filesystem::unique_path().
+  *path /= RandomAsciiString(10);
+
+  ofstream->open(*path, std::ios::binary);
+  return !ofstream->fail();
+}
+
 void DumpByLine(const std::string& data, std::ostream& os,
                 std::string_view prefix) {
   std::vector<std::string_view> lines;
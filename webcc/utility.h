@@ -1,8 +1,10 @@
 #ifndef WEBCC_UTILITY_H_
 #define WEBCC_UTILITY_H_
 
+#include <ctime>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 
 #include "webcc/globals.h"
 
@@ -17,6 +19,15 @@ const std::string& UserAgent();
 // See: https://tools.ietf.org/html/rfc7231#section-7.1.1.2
 std::string HttpDate();
 
+// The size of an HTTP date, e.g., "Wed, 21 Oct 2015 07:28:00 GMT".
+constexpr std::size_t kHttpDateSize = 29;
+
+// The same as HttpDate() but formatted only when the second changes, e.g.,
+// for the Date header of every response sent by the server.
+// The view refers to a buffer of the calling thread, valid until the next call
+// from the same thread.
+std::string_view CurrentHttpDate();
+
 // Format a given time as HTTP date.
 std::string FormatHttpDate(const std::tm& gmt);
 
@@ -24,12 +35,20 @@ std::string FormatHttpDate(const std::tm& gmt);
 // Return kInvalidSize on failure.
 std::size_t TellSize(const sfs::path& path);
 
+// Get the UTF-8 string of the path.
+// path::u8string() returns std::u8string instead of std::string since C++20.
+std::string PathToUtf8(const sfs::path& path);
+
 // Read the binary data of the file into an std::string.
 bool ReadFile(const sfs::path& path, std::string* bytes);
 
 // Write the binary data to the file.
 bool WriteFile(const sfs::path& path, const std::string& bytes);
 
+// Create a file with a random name in the temp directory and open it for
+// writing the binary data.
+bool OpenTempFile(std::ofstream* ofstream, sfs::path* path);
+
 // Dump the string data line by line to achieve more readability.
 // Also limit the maximum size of the data to be dumped.
 void DumpByLine(const std::string& data, std::ostream& os,
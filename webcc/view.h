@@ -1,7 +1,9 @@
 #ifndef WEBCC_VIEW_H_
 #define WEBCC_VIEW_H_
 
+#include <functional>
 #include <memory>
+#include <string_view>
 
 #include "webcc/request.h"
 #include "webcc/response.h"
@@ -25,10 +27,86 @@ public:
   virtual bool Stream(const std::string& method) {
     return false;  // No streaming by default
   }
+
+  // Return true if Handle() never blocks for the given method, so that the
+  // request can be handled right in the loop (io_context) thread without going
+  // through the queue and a worker thread. This saves the thread hop for cheap
+  // views like health checks, cached data or redirects.
+  // NOTE: A blocking view handled this way stalls all connections of the loop!
+  virtual bool NonBlocking(const std::string& method) {
+    return false;  // Handled by the workers by default
+  }
 };
 
 using ViewPtr = std::shared_ptr<View>;
 
+// -----------------------------------------------------------------------------
+
+// The callback to complete a deferred response.
+using ResponseCallback = std::function<void(ResponsePtr)>;
+
+// A view which doesn't return the response right away, but hands the request
+// over to something else (e.g., a batch processor of your own) and completes
+// the response later by calling the callback.
+// The worker (or the loop, see NonBlocking()) is released as soon as
+// AsyncHandle() returns.
+class DeferredView : public View {
+public:
+  // The callback must be called exactly once, and it can be called from any
+  // thread. Passing a null response sends back Internal Server Error (500).
+  virtual void AsyncHandle(RequestPtr request, ResponseCallback callback) = 0;
+
+private:
+  // Never called, the server calls AsyncHandle() instead.
+  ResponsePtr Handle(RequestPtr request) final {
+    return {};
+  }
+};
+
+// -----------------------------------------------------------------------------
+
+class WebSocket;
+using WebSocketPtr = std::shared_ptr<WebSocket>;
+
+// A view accepting WebSocket connections (RFC 6455) at its route, i.e., the
+// GET requests asking to upgrade the connection. Once upgraded, the messages
+// are exchanged without the overhead of HTTP.
+// Like the requests, the messages are handled in the loop of the connection
+// if NonBlocking() returns true for GET, or by the workers (of the executor of
+// the route, if any) otherwise. The messages of a connection are handled one
+// by one in order.
+class WebSocketView : public View {
+public:
+  // Accept or reject (with Forbidden) the opening handshake, e.g., by the
+  // authorization of the request.
+  virtual bool Accept(RequestPtr request) {
+    return true;
+  }
+
+  // Called in the loop of the connection once the connection is upgraded.
+  // The socket could be kept to send messages from any thread.
+  virtual void OnOpen(WebSocketPtr socket) {
+  }
+
+  // Called for each message received, text or binary.
+  // NOTE: The message refers to the buffer of the connection if possible, it
+  // is valid only during the call.
+  virtual void OnMessage(WebSocketPtr socket, std::string_view message,
+                         bool binary) = 0;
+
+  // Called in the loop of the connection once the connection is closed.
+  virtual void OnClose(WebSocketPtr socket) {
+  }
+
+private:
+  // Never called, the server answers the opening handshake instead.
+  ResponsePtr Handle(RequestPtr request) final {
+    return {};
+  }
+};
+
+using WebSocketViewPtr = std::shared_ptr<WebSocketView>;
+
 }  // namespace webcc
 
 #endif  // WEBCC_VIEW_H_
@@ -0,0 +1,655 @@
+#include "webcc/websocket.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "boost/asio/dispatch.hpp"
+#include "boost/asio/post.hpp"
+#include "openssl/sha.h"
+
+#include "webcc/base64.h"
+#include "webcc/connection_pool.h"
+#include "webcc/logger.h"
+#include "webcc/string.h"
+
+#if WEBCC_ENABLE_GZIP
+#include "webcc/gzip.h"
+#endif
+
+namespace webcc {
+namespace websocket {
+
+std::size_t ParseFrame(char* data, std::size_t size, Frame* frame) {
+  if (size < 2) {
+    return 0;
+  }
+
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+  // RSV2 and RSV3 are not used by any extension negotiated.
+  if ((bytes[0] & 0x30) != 0) {
+    return kInvalidSize;
+  }
+
+  // The frames from the client must be masked.
+  if ((bytes[1] & 0x80) == 0) {
+    return kInvalidSize;
+  }
+
+  frame->fin = (bytes[0] & 0x80) != 0;
+  frame->rsv1 = (bytes[0] & 0x40) != 0;
+  frame->opcode = bytes[0] & 0x0f;
+
+  std::uint64_t length = bytes[1] & 0x7f;
+  std::size_t pos = 2;
+
+  if (length == 126) {
+    if (size < 4) {
+      return 0;
+    }
+    length = (bytes[2] << 8) | bytes[3];
+    pos = 4;
+  } else if (length == 127) {
+    if (size < 10) {
+      return 0;
+    }
+    length = 0;
+    for (std::size_t i = 2; i < 10; ++i) {
+      length = (length << 8) | bytes[i];
+    }
+    pos = 10;
+  }
+
+  if (length > kMaxMessageSize) {
+    return kInvalidSize;
+  }
+
+  if (size < pos + 4 + length) {
+    return 0;
+  }
+
+  const unsigned char* mask = bytes + pos;
+  pos += 4;
+
+  char* payload = data + pos;
+
+  // Unmask eight bytes at a time, the mask repeats every four bytes.
+  std::uint32_t mask32 = 0;
+  std::memcpy(&mask32, mask, 4);
+  const std::uint64_t mask64 = (std::uint64_t{ mask32 } << 32) | mask32;
+
+  std::size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, payload + i, 8);
+    word ^= mask64;
+    std::memcpy(payload + i, &word, 8);
+  }
+  for (; i < length; ++i) {
+    payload[i] ^= mask[i % 4];
+  }
+
+  frame->payload = payload;
+  frame->length = static_cast<std::size_t>(length);
+
+  return pos + frame->length;
+}
+
+void AppendFrame(std::uint8_t opcode, bool rsv1, std::string_view payload,
+                 std::string* output) {
+  output->push_back(static_cast<char>(0x80 | (rsv1 ? 0x40 : 0) | opcode));
+
+  const std::size_t length = payload.size();
+  if (length < 126) {
+    output->push_back(static_cast<char>(length));
+  } else if (length <= 0xffff) {
+    output->push_back(static_cast<char>(126));
+    output->push_back(static_cast<char>((length >> 8) & 0xff));
+    output->push_back(static_cast<char>(length & 0xff));
+  } else {
+    output->push_back(static_cast<char>(127));
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      output->push_back(
+          static_cast<char>((std::uint64_t{ length } >> shift) & 0xff));
+    }
+  }
+
+  output->append(payload);
+}
+
+std::string AcceptKey(std::string_view key) {
+  // The GUID of RFC 6455.
+  std::string input{ key };
+  input += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+  unsigned char digest[SHA_DIGEST_LENGTH];
+  SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(),
+       digest);
+
+  return base64::Encode(digest, sizeof(digest));
+}
+
+int NegotiateDeflate(std::string_view extensions,
+                     std::string* response_extensions) {
+#if WEBCC_ENABLE_GZIP
+  // The offers are separated by commas, and the parameters of an offer by
+  // semicolons. Accept the first offer of permessage-deflate understood.
+  std::vector<std::string_view> offers;
+  Split(extensions, ',', false, &offers);
+
+  for (std::string_view offer : offers) {
+    std::vector<std::string_view> params;
+    Split(offer, ';', false, &params);
+
+    Trim(params[0]);
+    if (params[0] != "permessage-deflate") {
+      continue;
+    }
+
+    int window_bits = 15;
+    bool server_max_window_bits = false;
+    bool understood = true;
+
+    for (std::size_t i = 1; i < params.size(); ++i) {
+      std::string_view name = params[i];
+      std::string_view value;
+      if (!SplitKV(params[i], '=', true, &name, &value)) {
+        Trim(name);
+      }
+
+      if (name == "server_max_window_bits") {
+        // The compression with 8 bits is not supported by zlib.
+        std::size_t bits = 0;
+        if (!ToSizeT(Unquote(value), 10, &bits) || bits < 9 ||
+            bits > 15) {
+          understood = false;
+          break;
+        }
+        window_bits = static_cast<int>(bits);
+        server_max_window_bits = true;
+      } else if (name != "client_max_window_bits" &&
+                 name != "server_no_context_takeover" &&
+                 name != "client_no_context_takeover") {
+        understood = false;
+        break;
+      }
+    }
+
+    if (!understood) {
+      continue;
+    }
+
+    // Each message is compressed on its own, so that no context is kept for
+    // the connections.
+    *response_extensions =
+        "permessage-deflate; server_no_context_takeover; "
+        "client_no_context_takeover";
+    if (server_max_window_bits) {
+      *response_extensions +=
+          "; server_max_window_bits=" + std::to_string(window_bits);
+    }
+    return window_bits;
+  }
+#endif  // WEBCC_ENABLE_GZIP
+
+  return 0;
+}
+
+}  // namespace websocket
+
+// -----------------------------------------------------------------------------
+
+WebSocketMessage::WebSocketMessage(
+    ConnectionPtr connection, WebSocketPtr socket,
+    RequestHandler request_handler,
+    std::shared_ptr<std::atomic_bool> peer_closed, std::string_view data,
+    bool binary)
+    : ConnectionBase(GetIoContext(connection->GetSocket()), nullptr,
+                     std::move(request_handler), ViewMatcher{}, 0,
+                     std::move(peer_closed)),
+      connection_(std::move(connection)),
+      socket_(std::move(socket)),
+      route_(socket_->route_),
+      data_(data),
+      binary_(binary) {
+  request_ = socket_->request_;
+}
+
+WebSocketMessage::~WebSocketMessage() {
+  Done();
+}
+
+void WebSocketMessage::SendResponse(ResponsePtr response,
+                                    bool /*no_keep_alive*/) {
+  LOG_WARN("Drop the WebSocket message (%d)", response->status());
+  Done();
+}
+
+void WebSocketMessage::PostClose() {
+  Done();
+}
+
+void WebSocketMessage::Dispatch() {
+  dispatched_ = true;
+  request_handler_(shared_from_this());
+}
+
+void WebSocketMessage::Done() {
+  if (done_.exchange(true)) {
+    return;
+  }
+
+  boost::asio::post(socket_->strand_,
+                    [socket = socket_, connection = connection_]() {
+                      socket->OnHandled();
+                    });
+}
+
+void WebSocketMessage::AsyncWrite(
+    const std::vector<boost::asio::const_buffer>& /*buffers*/,
+    AsyncRWHandler&& handler) {
+  PostNotSupported(std::move(handler));
+}
+
+void WebSocketMessage::AsyncReadSome(boost::asio::mutable_buffer /*buffer*/,
+                                     AsyncRWHandler&& handler) {
+  PostNotSupported(std::move(handler));
+}
+
+// -----------------------------------------------------------------------------
+
+WebSocket::WebSocket(ConnectionBase* connection, int deflate_window_bits)
+    : connection_(connection),
+      weak_connection_(connection->shared_from_this()),
+      request_(connection->request()),
+      route_(connection->route()),
+      view_(std::dynamic_pointer_cast<WebSocketView>(connection->view())),
+      deflate_window_bits_(deflate_window_bits),
+      strand_(boost::asio::make_strand(
+          connection->GetSocket().get_executor())) {
+  assert(view_ != nullptr);
+}
+
+bool WebSocket::Send(std::string_view message, bool binary) {
+  using namespace websocket;
+
+  if (closed_) {
+    return false;
+  }
+
+  // The frame is made in the calling thread.
+  std::string frame;
+  const std::uint8_t opcode = binary ? opcodes::kBinary : opcodes::kText;
+  bool compressed = false;
+
+#if WEBCC_ENABLE_GZIP
+  if (deflate_window_bits_ > 0 && message.size() > kGzipThreshold) {
+    std::string data;
+    if (gzip::Deflate(message, deflate_window_bits_, &data) &&
+        data.size() >= 4) {
+      // Remove the empty block of the sync flush (RFC 7692 7.2.1).
+      data.resize(data.size() - 4);
+      AppendFrame(opcode, true, data, &frame);
+      compressed = true;
+    }
+  }
+#endif  // WEBCC_ENABLE_GZIP
+
+  if (!compressed) {
+    AppendFrame(opcode, false, message, &frame);
+  }
+
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self, frame = std::move(frame)]() {
+    auto connection = self->weak_connection_.lock();
+    if (connection == nullptr || self->aborted_ || self->close_sent_) {
+      return;
+    }
+    self->output_.append(frame);
+    self->Flush();
+  });
+
+  return true;
+}
+
+void WebSocket::Close(std::uint16_t code, std::string_view reason) {
+  closed_ = true;
+
+  // The status code and the reason, up to 125 bytes as a control frame.
+  std::string payload;
+  payload.push_back(static_cast<char>((code >> 8) & 0xff));
+  payload.push_back(static_cast<char>(code & 0xff));
+  payload.append(reason.substr(0, 123));
+
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self, payload = std::move(payload)]() {
+    auto connection = self->weak_connection_.lock();
+    if (connection == nullptr || self->aborted_ || self->close_sent_) {
+      return;
+    }
+
+    self->SendFrame(websocket::opcodes::kClose, payload);
+    self->close_sent_ = true;
+
+    if (self->close_received_) {
+      self->closing_ = true;
+      self->Flush();
+    }  // else: Wait for the answer of the client.
+  });
+}
+
+void WebSocket::Start(const std::string& data) {
+  LOG_INFO("Start WebSocket");
+
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  boost::asio::post(strand_, [self, connection, data]() {
+    // The frames sent right after the opening handshake, if any.
+    self->partial_ = data;
+
+    self->view_->OnOpen(self);
+    self->ParseFrames();
+  });
+}
+
+void WebSocket::PostAbort() {
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  boost::asio::post(strand_, [self, connection]() { self->Abort(); });
+}
+
+void WebSocket::AsyncRead() {
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  connection_->AsyncReadSome(
+      boost::asio::buffer(connection_->buffer_),
+      [self, connection](boost::system::error_code ec, std::size_t length) {
+        boost::asio::dispatch(self->strand_, [self, connection, ec, length]() {
+          self->OnRead(ec, length);
+        });
+      });
+}
+
+void WebSocket::OnRead(boost::system::error_code ec, std::size_t length) {
+  if (ec) {
+    if (ec != boost::asio::error::eof &&
+        ec != boost::asio::error::operation_aborted) {
+      LOG_ERRO("Socket read error (%s)", ec.message().c_str());
+    }
+    Abort();
+    return;
+  }
+
+  if (!partial_.empty()) {
+    partial_.append(connection_->buffer_.data(), length);
+  } else {
+    offset_ = 0;
+    length_ = length;
+  }
+
+  ParseFrames();
+}
+
+void WebSocket::ParseFrames() {
+  while (!handling_ && !closing_ && !aborted_) {
+    const bool carried = !partial_.empty();
+
+    char* data = nullptr;
+    std::size_t size = 0;
+    if (carried) {
+      data = &partial_[partial_offset_];
+      size = partial_.size() - partial_offset_;
+    } else {
+      data = connection_->buffer_.data() + offset_;
+      size = length_;
+    }
+
+    if (size == 0) {
+      partial_.clear();
+      partial_offset_ = 0;
+      AsyncRead();
+      return;
+    }
+
+    websocket::Frame frame;
+    std::size_t frame_size = websocket::ParseFrame(data, size, &frame);
+
+    if (frame_size == kInvalidSize) {
+      LOG_ERRO("Invalid WebSocket frame");
+      Fail(websocket::close_codes::kProtocolError);
+      return;
+    }
+
+    if (frame_size == 0) {
+      // Carry the incomplete frame to the next read.
+      if (carried) {
+        partial_.erase(0, partial_offset_);
+      } else {
+        partial_.assign(data, size);
+        length_ = 0;
+      }
+      partial_offset_ = 0;
+      AsyncRead();
+      return;
+    }
+
+    // NOTE: The payload of the frame stays in place until the message has
+    // been handled, no more data is read meanwhile.
+    if (carried) {
+      partial_offset_ += frame_size;
+    } else {
+      offset_ += frame_size;
+      length_ -= frame_size;
+    }
+
+    HandleFrame(frame);
+  }
+}
+
+void WebSocket::HandleFrame(const websocket::Frame& frame) {
+  using namespace websocket;
+
+  if ((frame.opcode & 0x08) != 0) {
+    HandleControlFrame(frame);
+    return;
+  }
+
+  std::string_view payload{ frame.payload, frame.length };
+
+  if (frame.opcode == opcodes::kContinuation) {
+    if (!in_message_ || frame.rsv1) {
+      Fail(close_codes::kProtocolError);
+      return;
+    }
+  } else if (frame.opcode == opcodes::kText ||
+             frame.opcode == opcodes::kBinary) {
+    if (in_message_ || (frame.rsv1 && deflate_window_bits_ == 0)) {
+      Fail(close_codes::kProtocolError);
+      return;
+    }
+
+    message_binary_ = frame.opcode == opcodes::kBinary;
+    message_compressed_ = frame.rsv1;
+
+    if (frame.fin && !frame.rsv1) {
+      // The whole message in a frame, handle it in place.
+      Dispatch(payload, message_binary_);
+      return;
+    }
+
+    in_message_ = true;
+  } else {
+    Fail(close_codes::kProtocolError);
+    return;
+  }
+
+  if (message_.size() + payload.size() > kMaxMessageSize) {
+    Fail(close_codes::kMessageTooBig);
+    return;
+  }
+
+  message_.append(payload);
+
+  if (!frame.fin) {
+    return;
+  }
+
+  in_message_ = false;
+
+#if WEBCC_ENABLE_GZIP
+  if (message_compressed_) {
+    // Add back the empty block removed by the client (RFC 7692 7.2.2).
+    message_.append("\x00\x00\xff\xff", 4);
+    if (!gzip::Inflate(message_, kMaxMessageSize, &inflated_)) {
+      Fail(close_codes::kInvalidData);
+      return;
+    }
+    Dispatch(inflated_, message_binary_);
+    return;
+  }
+#endif  // WEBCC_ENABLE_GZIP
+
+  Dispatch(message_, message_binary_);
+}
+
+void WebSocket::HandleControlFrame(const websocket::Frame& frame) {
+  using namespace websocket;
+
+  if (!frame.fin || frame.rsv1 || frame.length > 125) {
+    Fail(close_codes::kProtocolError);
+    return;
+  }
+
+  std::string_view payload{ frame.payload, frame.length };
+
+  if (frame.opcode == opcodes::kPing) {
+    SendFrame(opcodes::kPong, payload);
+
+  } else if (frame.opcode == opcodes::kClose) {
+    close_received_ = true;
+    closed_ = true;
+
+    if (!close_sent_) {
+      // Answer with the status code, if any.
+      SendFrame(opcodes::kClose, payload.substr(0, 2));
+      close_sent_ = true;
+    }
+
+    closing_ = true;
+    Flush();
+
+  } else if (frame.opcode != opcodes::kPong) {
+    Fail(close_codes::kProtocolError);
+  }
+}
+
+void WebSocket::Dispatch(std::string_view message, bool binary) {
+  handling_ = true;
+
+  auto carrier = std::make_shared<WebSocketMessage>(
+      connection_->shared_from_this(), shared_from_this(),
+      RequestHandler{ connection_->request_handler_ },
+      connection_->peer_closed_, message, binary);
+
+  carrier->Dispatch();
+}
+
+void WebSocket::OnHandled() {
+  handling_ = false;
+  message_.clear();
+  inflated_.clear();
+
+  if (!aborted_) {
+    ParseFrames();
+  }
+}
+
+void WebSocket::Fail(std::uint16_t code) {
+  LOG_WARN("Close WebSocket with error (%u)", (unsigned int)code);
+
+  closed_ = true;
+
+  if (!close_sent_) {
+    std::string payload;
+    payload.push_back(static_cast<char>((code >> 8) & 0xff));
+    payload.push_back(static_cast<char>(code & 0xff));
+    SendFrame(websocket::opcodes::kClose, payload);
+    close_sent_ = true;
+  }
+
+  closing_ = true;
+  Flush();
+}
+
+void WebSocket::SendFrame(std::uint8_t opcode, std::string_view payload) {
+  if (close_sent_ || aborted_) {
+    return;
+  }
+
+  websocket::AppendFrame(opcode, false, payload, &output_);
+  Flush();
+}
+
+void WebSocket::Flush() {
+  if (is_writing_ || aborted_) {
+    return;
+  }
+
+  if (output_.empty()) {
+    if (closing_) {
+      Abort();
+    }
+    return;
+  }
+
+  writing_.clear();
+  writing_.swap(output_);
+  is_writing_ = true;
+
+  auto self = shared_from_this();
+  auto connection = connection_->shared_from_this();
+
+  connection_->AsyncWrite(
+      { boost::asio::buffer(writing_) },
+      [self, connection](boost::system::error_code ec, std::size_t length) {
+        boost::asio::dispatch(self->strand_, [self, connection, ec, length]() {
+          self->OnWrite(ec, length);
+        });
+      });
+}
+
+void WebSocket::OnWrite(boost::system::error_code ec, std::size_t /*length*/) {
+  is_writing_ = false;
+
+  if (ec) {
+    if (!aborted_) {
+      LOG_ERRO("Socket write error (%s)", ec.message().c_str());
+    }
+    Abort();
+    return;
+  }
+
+  Flush();
+}
+
+void WebSocket::Abort() {
+  if (aborted_) {
+    return;
+  }
+
+  aborted_ = true;
+  closed_ = true;
+
+  // Drop the messages waiting for the workers.
+  *connection_->peer_closed_ = true;
+
+  view_->OnClose(shared_from_this());
+
+  connection_->pool_->Close(connection_->shared_from_this());
+}
+
+}  // namespace webcc
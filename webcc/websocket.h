@@ -0,0 +1,301 @@
+#ifndef WEBCC_WEBSOCKET_H_
+#define WEBCC_WEBSOCKET_H_
+
+// WebSocket (RFC 6455) on the server connections, with the permessage-deflate
+// extension (RFC 7692) if Gzip is enabled.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "boost/asio/strand.hpp"
+
+#include "webcc/connection_base.h"
+#include "webcc/view.h"
+
+namespace webcc {
+namespace websocket {
+
+namespace opcodes {
+
+constexpr std::uint8_t kContinuation = 0x0;
+constexpr std::uint8_t kText = 0x1;
+constexpr std::uint8_t kBinary = 0x2;
+constexpr std::uint8_t kClose = 0x8;
+constexpr std::uint8_t kPing = 0x9;
+constexpr std::uint8_t kPong = 0xa;
+
+}  // namespace opcodes
+
+namespace close_codes {
+
+constexpr std::uint16_t kNormal = 1000;
+constexpr std::uint16_t kGoingAway = 1001;
+constexpr std::uint16_t kProtocolError = 1002;
+constexpr std::uint16_t kNoStatus = 1005;
+constexpr std::uint16_t kInvalidData = 1007;
+constexpr std::uint16_t kMessageTooBig = 1009;
+
+}  // namespace close_codes
+
+// The maximum size of a message received, after decompression.
+constexpr std::size_t kMaxMessageSize = 16 * 1024 * 1024;
+
+// A frame received.
+struct Frame {
+  bool fin = false;
+
+  // Set on the first frame of a compressed message.
+  bool rsv1 = false;
+
+  std::uint8_t opcode = 0;
+
+  // The unmasked payload, in the data parsed.
+  char* payload = nullptr;
+  std::size_t length = 0;
+};
+
+// Parse a frame from the client, and unmask the payload in place.
+// Return the size of the frame, 0 if more data is needed, or kInvalidSize if
+// the frame is malformed (e.g., not masked, or too large).
+std::size_t ParseFrame(char* data, std::size_t size, Frame* frame);
+
+// Append a frame from the server (not masked) to the output.
+void AppendFrame(std::uint8_t opcode, bool rsv1, std::string_view payload,
+                 std::string* output);
+
+// Get the value of the Sec-WebSocket-Accept header for the key of the client.
+std::string AcceptKey(std::string_view key);
+
+// Negotiate the permessage-deflate extension offered by the client in the
+// Sec-WebSocket-Extensions header. Return the window bits to compress the
+// messages with, or 0 if not negotiated (or Gzip is not enabled). The value
+// of the header to answer with is set to `response_extensions`.
+int NegotiateDeflate(std::string_view extensions,
+                     std::string* response_extensions);
+
+}  // namespace websocket
+
+// -----------------------------------------------------------------------------
+
+// A message received on a WebSocket connection, which the server handles as a
+// connection with a single request (the opening handshake). So the views, the
+// workers and the executors work with it the same way as the requests.
+class WebSocketMessage : public ConnectionBase {
+public:
+  // No buffer or flag of its own is allocated, the message has been read by
+  // the socket and it's canceled with the connection.
+  WebSocketMessage(ConnectionPtr connection, WebSocketPtr socket,
+                   RequestHandler request_handler,
+                   std::shared_ptr<std::atomic_bool> peer_closed,
+                   std::string_view data, bool binary);
+
+  // Tell the socket if not done yet.
+  ~WebSocketMessage() override;
+
+  const RouteInfo* route() const override {
+    return route_;
+  }
+
+  ViewPtr view() const override {
+    return route_->view;
+  }
+
+  // The socket of the connection.
+  SocketType& GetSocket() override {
+    return connection_->GetSocket();
+  }
+
+  // The message is handed to the server by the socket instead.
+  void Start() override {
+  }
+
+  void Close() override {
+  }
+
+  const WebSocketPtr& socket() const {
+    return socket_;
+  }
+
+  std::string_view data() const {
+    return data_;
+  }
+
+  bool binary() const {
+    return binary_;
+  }
+
+  using ConnectionBase::SendResponse;
+
+  // Override to drop the message, e.g., the queue of the workers is full.
+  // There's no response to a message.
+  void SendResponse(ResponsePtr response, bool no_keep_alive) override;
+
+  // Override to drop the message, e.g., the connection has been closed.
+  void PostClose() override;
+
+  // Override to do nothing, the socket is read for the next message instead.
+  void WatchPeer() override {
+  }
+
+  // Let the server handle the message.
+  void Dispatch();
+
+  // Tell the socket that the message has been handled, so the next one could
+  // be read. Called once the view has returned.
+  void Done();
+
+protected:
+  // The I/O is done by the socket, these only fail the handler.
+  void AsyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                  AsyncRWHandler&& handler) override;
+
+  void AsyncReadSome(boost::asio::mutable_buffer buffer,
+                     AsyncRWHandler&& handler) override;
+
+private:
+  // The connection of the socket.
+  ConnectionPtr connection_;
+
+  WebSocketPtr socket_;
+
+  const RouteInfo* route_;
+
+  // The data refers to the buffer of the socket, which is kept until done.
+  std::string_view data_;
+  bool binary_;
+
+  std::atomic_bool done_{ false };
+};
+
+// -----------------------------------------------------------------------------
+
+// The WebSocket layer of a server connection, after the opening handshake has
+// been answered. It takes over the reading and the writing of the connection.
+// It's also the socket given to the view to send the messages, from any
+// thread.
+class WebSocket : public std::enable_shared_from_this<WebSocket> {
+public:
+  WebSocket(ConnectionBase* connection, int deflate_window_bits);
+
+  WebSocket(const WebSocket&) = delete;
+  WebSocket& operator=(const WebSocket&) = delete;
+
+  ~WebSocket() = default;
+
+  // The request of the opening handshake.
+  RequestPtr request() const {
+    return request_;
+  }
+
+  // Send a message, text or binary. It's compressed if the permessage-deflate
+  // extension has been negotiated and the message is large enough.
+  // Return false if the socket has been closed.
+  bool Send(std::string_view message, bool binary = false);
+
+  // Start the closing handshake. The connection is closed once the client has
+  // answered.
+  void Close(std::uint16_t code = websocket::close_codes::kNormal,
+             std::string_view reason = {});
+
+  // Has the socket been closed, by either side?
+  bool closed() const {
+    return closed_;
+  }
+
+  // Start with the data read after the opening handshake.
+  // Called by the connection in its loop.
+  void Start(const std::string& data);
+
+  // Close from any thread without the closing handshake, e.g., the server is
+  // being stopped. Called by the connection.
+  void PostAbort();
+
+private:
+  friend class WebSocketMessage;
+
+  void AsyncRead();
+  void OnRead(boost::system::error_code ec, std::size_t length);
+
+  // Parse the frames in the data read, until a message is being handled.
+  void ParseFrames();
+
+  void HandleFrame(const websocket::Frame& frame);
+  void HandleControlFrame(const websocket::Frame& frame);
+
+  // Hand the message to the server, and wait until it's handled.
+  void Dispatch(std::string_view message, bool binary);
+
+  // The message has been handled, go on with the next one.
+  void OnHandled();
+
+  // Close with the error, without waiting for the answer.
+  void Fail(std::uint16_t code);
+
+  void SendFrame(std::uint8_t opcode, std::string_view payload);
+
+  // Write the output, unless a write is in progress.
+  void Flush();
+  void OnWrite(boost::system::error_code ec, std::size_t length);
+
+  // Close the connection, tell the view.
+  void Abort();
+
+  ConnectionBase* connection_;
+
+  // Expired once the connection has been closed and released, e.g., when the
+  // view sends a message after that.
+  std::weak_ptr<ConnectionBase> weak_connection_;
+
+  RequestPtr request_;
+  const RouteInfo* route_;
+  WebSocketViewPtr view_;
+
+  // The window bits to compress the messages with, 0 for no compression.
+  const int deflate_window_bits_;
+
+  boost::asio::strand<boost::asio::any_io_executor> strand_;
+
+  // The data in the buffer of the connection which has been read but not
+  // parsed yet.
+  std::size_t offset_ = 0;
+  std::size_t length_ = 0;
+
+  // The data carried to the next read when a frame is not complete, and the
+  // part parsed of it.
+  std::string partial_;
+  std::size_t partial_offset_ = 0;
+
+  // The message being assembled from the fragments, and the decompressed one.
+  std::string message_;
+  std::string inflated_;
+  bool in_message_ = false;
+  bool message_binary_ = false;
+  bool message_compressed_ = false;
+
+  // Is a message being handled?
+  bool handling_ = false;
+
+  // The output being written and the output produced meanwhile.
+  std::string writing_;
+  std::string output_;
+  bool is_writing_ = false;
+
+  // The closing handshake.
+  bool close_sent_ = false;
+  bool close_received_ = false;
+
+  // Close the connection once the output has been written.
+  bool closing_ = false;
+
+  bool aborted_ = false;
+
+  // Set from the loop, read from any thread.
+  std::atomic_bool closed_{ false };
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_WEBSOCKET_H_
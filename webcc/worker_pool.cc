@@ -0,0 +1,220 @@
+#include "webcc/worker_pool.h"
+
+#include <algorithm>
+
+#include "webcc/logger.h"
+
+namespace webcc {
+
+WorkerPool::~WorkerPool() {
+  Stop();
+}
+
+void WorkerPool::Start(Handler handler) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+
+  assert(threads_.empty());
+
+  handler_ = std::move(handler);
+
+  queue_.Reset(queue_capacity_);
+  codel_.Reset(codel_target_delay_, codel_interval_);
+
+  stopped_ = false;
+
+  for (std::size_t i = 0; i < min_size_; ++i) {
+    AddWorker();
+  }
+
+  if (elastic()) {
+    manager_thread_ = std::thread{ &WorkerPool::ManagerRoutine, this };
+  }
+}
+
+void WorkerPool::Stop() {
+  std::vector<std::thread> threads;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+  }
+
+  LOG_INFO("Stop workers");
+
+  if (manager_thread_.joinable()) {
+    manager_cv_.notify_one();
+    manager_thread_.join();
+  }
+
+  // Clear/drop pending connections.
+  // The connections will be closed later (see Server::DoStop).
+  // Alternatively, we can wait for the pending connections to be handled.
+  if (queue_.Size() != 0) {
+    LOG_INFO("Clear pending connections");
+    queue_.Clear();
+  }
+
+  // Enqueue a null connection to trigger the first worker to stop.
+  queue_.Push(ConnectionPtr());
+
+  {
+    // Don't join with the lock held, a worker might be retiring.
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    threads.swap(threads_);
+    retired_.clear();
+  }
+
+  // Wait for worker threads to finish.
+  for (auto& t : threads) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+
+  size_ = 0;
+
+  // Clear the queue because it has a remaining null connection pushed by the
+  // last worker thread.
+  queue_.Clear();
+
+  LOG_INFO("Workers stopped");
+}
+
+bool WorkerPool::Push(ConnectionPtr connection) {
+  connection->set_queued_time(Codel::Clock::now());
+  return queue_.TryPush(connection);
+}
+
+bool WorkerPool::ShouldDrop(const ConnectionPtr& connection) {
+  if (max_queue_delay_ <= 0 && codel_target_delay_ <= 0) {
+    return false;
+  }
+
+  auto delay = Codel::Clock::now() - connection->queued_time();
+
+  if (max_queue_delay_ > 0 &&
+      delay > boost::asio::chrono::milliseconds(max_queue_delay_)) {
+    return true;
+  }
+
+  return codel_target_delay_ > 0 && codel_.Overloaded(delay);
+}
+
+void WorkerPool::AddWorker() {
+  threads_.emplace_back(&WorkerPool::WorkerRoutine, this);
+  ++size_;
+}
+
+bool WorkerPool::TryRetire() {
+  std::size_t size = 0;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+
+    if (stopped_ || size_ <= min_size_) {
+      return false;
+    }
+
+    size = --size_;
+    retired_.push_back(std::this_thread::get_id());
+  }
+
+  LOG_INFO("Worker pool (%s) shrinks to %u", name_.c_str(), size);
+  OnResized(size);
+  return true;
+}
+
+void WorkerPool::JoinRetired() {
+  for (auto id : retired_) {
+    auto it = std::find_if(threads_.begin(), threads_.end(),
+                           [id](const std::thread& t) {
+                             return t.get_id() == id;
+                           });
+    if (it != threads_.end()) {
+      it->join();
+      threads_.erase(it);
+    }
+  }
+  retired_.clear();
+}
+
+void WorkerPool::WorkerRoutine() {
+  LOG_INFO("Worker is running");
+
+  auto idle_timeout = std::chrono::seconds(idle_timeout_);
+
+  while (true) {
+    ConnectionPtr connection;
+
+    if (elastic()) {
+      if (!queue_.PopOrWaitFor(&connection, idle_timeout)) {
+        if (TryRetire()) {
+          LOG_INFO("Worker is retired");
+          break;
+        }
+        continue;
+      }
+    } else {
+      connection = queue_.PopOrWait();
+    }
+
+    if (connection == nullptr) {
+      LOG_INFO("Worker is going to stop");
+
+      // For stopping next worker.
+      queue_.Push({});
+
+      // Stop this worker.
+      break;
+    }
+
+    handler_(connection);
+  }
+}
+
+void WorkerPool::ManagerRoutine() {
+  auto check_interval = std::chrono::milliseconds(check_interval_);
+
+  // The number of checks in a row the queue is found non-empty.
+  int pressure = 0;
+
+  std::unique_lock<std::mutex> lock{ mutex_ };
+
+  while (!stopped_) {
+    manager_cv_.wait_for(lock, check_interval);
+    if (stopped_) {
+      break;
+    }
+
+    JoinRetired();
+
+    if (queue_.Size() > 0) {
+      ++pressure;
+    } else {
+      pressure = 0;
+    }
+
+    if (pressure >= 2 && size_ < max_size_) {
+      AddWorker();
+      pressure = 0;
+
+      std::size_t size = size_;
+      LOG_INFO("Worker pool (%s) grows to %u", name_.c_str(), size);
+
+      lock.unlock();
+      OnResized(size);
+      lock.lock();
+    }
+  }
+}
+
+void WorkerPool::OnResized(std::size_t size) {
+  if (resize_handler_) {
+    resize_handler_(name_, size);
+  }
+}
+
+}  // namespace webcc
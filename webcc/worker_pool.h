@@ -0,0 +1,187 @@
+#ifndef WEBCC_WORKER_POOL_H_
+#define WEBCC_WORKER_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "webcc/codel.h"
+#include "webcc/connection_base.h"
+#include "webcc/globals.h"
+
+namespace webcc {
+
+// A pool of worker threads and the queue of the connections waiting for them.
+// The pool is elastic if the maximum size is larger than the minimum size:
+// a worker is added when the queue stays non-empty for a while, and a worker
+// idle for long is retired, until the minimum size.
+class WorkerPool {
+public:
+  // The handler of the connections popped from the queue.
+  using Handler = std::function<void(ConnectionPtr)>;
+
+  // The handler of the resize events, with the name and the new size of the
+  // pool. Called from the thread which resizes the pool.
+  using ResizeHandler = std::function<void(const std::string&, std::size_t)>;
+
+  WorkerPool() = default;
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool();
+
+  const std::string& name() const {
+    return name_;
+  }
+
+  void set_name(const std::string& name) {
+    name_ = name;
+  }
+
+  // Set the minimum and maximum number of workers.
+  // The pool is fixed-size if they are the same. Applied on next Start().
+  void set_size(std::size_t min_size, std::size_t max_size) {
+    assert(min_size > 0);
+    min_size_ = min_size;
+    max_size_ = std::max(min_size, max_size);
+  }
+
+  // Set the time (in seconds) after which an idle worker will be retired.
+  void set_idle_timeout(int idle_timeout) {
+    if (idle_timeout > 0) {
+      idle_timeout_ = idle_timeout;
+    }
+  }
+
+  // Set the interval (in milliseconds) to check the queue. A worker is added if
+  // the queue is non-empty in two checks in a row, i.e., some requests have
+  // waited for about this long.
+  void set_check_interval(int check_interval) {
+    if (check_interval > 0) {
+      check_interval_ = check_interval;
+    }
+  }
+
+  // Set the capacity of the queue. Applied on next Start().
+  void set_queue_capacity(std::size_t queue_capacity) {
+    if (queue_capacity > 0) {
+      queue_capacity_ = queue_capacity;
+    }
+  }
+
+  // See Server::set_max_queue_delay().
+  void set_max_queue_delay(int max_queue_delay) {
+    max_queue_delay_ = max_queue_delay;
+  }
+
+  // See Server::set_codel(). Applied on next Start().
+  void set_codel(int target_delay, int interval) {
+    codel_target_delay_ = target_delay;
+    codel_interval_ = interval;
+  }
+
+  void set_resize_handler(ResizeHandler resize_handler) {
+    resize_handler_ = std::move(resize_handler);
+  }
+
+  // The current number of workers.
+  std::size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  // The number of connections waiting in the queue (an estimate).
+  std::size_t queue_size() const {
+    return queue_.Size();
+  }
+
+  // Start the workers (the minimum number of them).
+  void Start(Handler handler);
+
+  // Clear the pending connections from the queue and stop the workers.
+  // This might take some time if the workers are still processing.
+  void Stop();
+
+  // Put a connection into the queue.
+  // Return false if the queue is full.
+  bool Push(ConnectionPtr connection);
+
+  // Tell if the request of a connection just popped from the queue should be
+  // dropped (load shedding) because it has waited too long.
+  bool ShouldDrop(const ConnectionPtr& connection);
+
+private:
+  bool elastic() const {
+    return max_size_ > min_size_;
+  }
+
+  // Add a worker thread.
+  // NOTE: Lock `mutex_` before calling it.
+  void AddWorker();
+
+  // Retire the current worker if the pool is larger than the minimum size.
+  bool TryRetire();
+
+  // Join the threads of the retired workers.
+  // NOTE: Lock `mutex_` before calling it.
+  void JoinRetired();
+
+  void WorkerRoutine();
+
+  // The routine of the thread checking the queue for an elastic pool.
+  void ManagerRoutine();
+
+  void OnResized(std::size_t size);
+
+private:
+  std::string name_;
+
+  std::size_t min_size_ = 1;
+  std::size_t max_size_ = 1;
+
+  int idle_timeout_ = 60;
+  int check_interval_ = 50;
+
+  std::size_t queue_capacity_ = kQueueCapacity;
+
+  int max_queue_delay_ = 0;
+  int codel_target_delay_ = 0;
+  int codel_interval_ = 100;
+
+  ResizeHandler resize_handler_;
+
+  Handler handler_;
+
+  // The queue with connections waiting for the workers to process.
+  ConnectionQueue queue_;
+
+  // The CoDel load shedding policy of the queue.
+  Codel codel_;
+
+  // The current number of workers.
+  std::atomic_size_t size_{ 0 };
+
+  // Guard the threads and the state below.
+  std::mutex mutex_;
+
+  std::vector<std::thread> threads_;
+
+  // The IDs of the retired worker threads to be joined.
+  std::vector<std::thread::id> retired_;
+
+  bool stopped_ = true;
+
+  // The thread checking the queue, for an elastic pool only.
+  std::thread manager_thread_;
+  std::condition_variable manager_cv_;
+};
+
+}  // namespace webcc
+
+#endif  // WEBCC_WORKER_POOL_H_